@@ -0,0 +1,57 @@
+#include "arduino-adapters.h"
+
+/**
+ * 読み出し元のStreamを指定して初期化します。
+ */
+StreamByteStream::StreamByteStream(Stream& stream)
+: stream_(stream) {
+}
+
+/**
+ * 待たずに読み出せるバイト数を返します。
+ */
+int StreamByteStream::available() {
+  return stream_.available();
+}
+
+/**
+ * 最大lengthバイトを読み出し、読み出したバイト数を返します。
+ */
+size_t StreamByteStream::readBytes(uint8_t* buffer, const size_t length) {
+  return stream_.readBytes(buffer, length);
+}
+
+/**
+ * 経過時間をミリ秒で返します。
+ */
+uint32_t ArduinoClock::getMillis() const {
+  return millis();
+}
+
+/**
+ * 経過時間をマイクロ秒で返します。
+ */
+uint32_t ArduinoClock::getMicros() const {
+  return micros();
+}
+
+/**
+ * 計測に使う描画先を指定して初期化します。
+ */
+GfxTextMetrics::GfxTextMetrics(LovyanGFX& gfx)
+: gfx_(gfx) {
+}
+
+/**
+ * 現在のフォントでの文字列の表示幅を返します。
+ */
+int GfxTextMetrics::measureTextWidth(const char* text) {
+  return gfx_.textWidth(text);
+}
+
+/**
+ * 現在のフォントを識別する値を返します。
+ */
+const void* GfxTextMetrics::getFontKey() const {
+  return gfx_.getFont();
+}
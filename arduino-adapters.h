@@ -0,0 +1,51 @@
+#ifndef ARDUINO_ADAPTERS_H
+#define ARDUINO_ADAPTERS_H
+
+#include <M5Unified.h>
+
+#include "core-interfaces.h"
+
+/**
+ * ArduinoのStreamをByteStreamとして読みます。
+ */
+class StreamByteStream : public ByteStream {
+ public:
+  /**
+   * 読み出し元のStreamを指定して初期化します。
+   */
+  explicit StreamByteStream(Stream& stream);
+
+  int available() override;
+  size_t readBytes(uint8_t* buffer, size_t length) override;
+
+ private:
+  Stream& stream_;
+};
+
+/**
+ * millis/microsを返す時計です。
+ */
+class ArduinoClock : public MonotonicClock {
+ public:
+  uint32_t getMillis() const override;
+  uint32_t getMicros() const override;
+};
+
+/**
+ * LovyanGFXの描画先で文字列幅を測ります。
+ */
+class GfxTextMetrics : public TextMetrics {
+ public:
+  /**
+   * 計測に使う描画先を指定して初期化します。
+   */
+  explicit GfxTextMetrics(LovyanGFX& gfx);
+
+  int measureTextWidth(const char* text) override;
+  const void* getFontKey() const override;
+
+ private:
+  LovyanGFX& gfx_;
+};
+
+#endif
@@ -1,16 +1,80 @@
 #include "camera-mode.h"
 
+#include <esp_heap_caps.h>
+
 #include <algorithm>
 
-#include "register-config.h"
+#include "logger.h"
+#include "perf-stats.h"
 
 namespace {
 
-constexpr bool ENABLE_SERIAL_DEBUG = true;
+constexpr bool ENABLE_PIPELINED_CAPTURE = true;
+constexpr bool ENABLE_PHOTO_SAVE = true;
+constexpr uint32_t CAPTURE_TASK_STACK_SIZE = 4096;
+constexpr UBaseType_t CAPTURE_TASK_PRIORITY = 2;
+constexpr BaseType_t CAPTURE_TASK_CORE = 0;
+constexpr UBaseType_t FRAME_QUEUE_LENGTH = 1;
+constexpr TickType_t FRAME_HANDOFF_TIMEOUT_TICKS = pdMS_TO_TICKS(20);
+constexpr TickType_t STILL_FRAME_TIMEOUT_TICKS = pdMS_TO_TICKS(200);
+constexpr uint32_t CAPTURE_RETRY_DELAY_MS = 10;
+constexpr uint32_t FPS_WINDOW_MS = 1000;
+// 転送完了と次フレームの到着を確認する間隔です。取得自体は取得タスクが待つため、短くても空回りしません。
+constexpr uint32_t LIVE_VIEW_POLL_INTERVAL_MS = 1;
+// 休止時にドライバとPSRAM上のフレームバッファを残し、再入時の初期化を省きます。
+// ※DRAMにバッファを置く縮小構成では、他の処理に空きを返すため常に解放します。
+constexpr bool ENABLE_CAMERA_WARM_RESUME = true;
+// GC0308のパッド出力有効レジスタと、画像データ・同期信号をすべて出力する値です。
+constexpr int SENSOR_OUTPUT_ENABLE_REG = 0x25;
+constexpr int SENSOR_OUTPUT_ENABLE_VALUE = 0x0F;
+// ライブ表示中は画像効果を、静止画表示中は表示する静止画を、左右端のこの幅のタップで切り替えます。
+constexpr int EDGE_TAP_ZONE_W = 80;
+constexpr int GALLERY_POSITION_MARGIN_BOTTOM = 14;
 constexpr int STILL_FRAME_THICKNESS = 5;
 constexpr int STILL_FRAME_INNER_LINE_OFFSET = 8;
 constexpr const lgfx::U8g2font* BODY_FONT = &fonts::lgfxJapanGothic_24;
 
+/**
+ * カメラの取得設定1件を保持します。
+ */
+struct CameraProfile {
+  const char* name;
+  framesize_t frameSize;
+  int width;
+  int height;
+  int xclkHz;
+  size_t fbCount;
+  camera_fb_location_t fbLocation;
+  camera_grab_mode_t grabMode;
+};
+
+// 計測したFPSに応じてライブ表示中に取得設定を切り替えます。
+constexpr bool ENABLE_ADAPTIVE_CAMERA_PROFILE = true;
+// 重い順に並べた取得設定です。目標FPSを下回り続けると1段ずつ軽い側へ、上回り続けると重い側へ移ります。
+// ※最後の設定はPSRAMを使わない縮小構成で、初期化に失敗した場合の退避先も兼ねます。
+constexpr CameraProfile CAMERA_PROFILES[] = {
+  {"qvga-psram-x2", FRAMESIZE_QVGA, 320, 240, 20000000, 2, CAMERA_FB_IN_PSRAM, CAMERA_GRAB_LATEST},
+  {"hqvga-psram-x2", FRAMESIZE_HQVGA, 240, 176, 20000000, 2, CAMERA_FB_IN_PSRAM, CAMERA_GRAB_LATEST},
+  {"hqvga-psram-x2-slow", FRAMESIZE_HQVGA, 240, 176, 10000000, 2, CAMERA_FB_IN_PSRAM, CAMERA_GRAB_WHEN_EMPTY},
+  {"qvga-dram-x1", FRAMESIZE_QVGA, 320, 240, 20000000, 1, CAMERA_FB_IN_DRAM, CAMERA_GRAB_LATEST},
+};
+constexpr size_t CAMERA_PROFILE_COUNT = sizeof(CAMERA_PROFILES) / sizeof(CAMERA_PROFILES[0]);
+constexpr size_t COMPACT_CAMERA_PROFILE_INDEX = CAMERA_PROFILE_COUNT - 1;
+constexpr CameraProfileGovernor::Config CAMERA_PROFILE_GOVERNOR_CONFIG = {15.0f, 1.3f, 3, 10, 80};
+// PSRAMの空きがこれを下回るとFPSに関わらず軽い側へ移り、重い側へ戻す際もこれだけの空きを残します。
+constexpr size_t CAMERA_MIN_FREE_PSRAM_BYTES = 128 * 1024;
+
+/**
+ * 取得設定がPSRAMに確保するフレームバッファの容量を返します。
+ */
+size_t getProfilePsramBytes(const CameraProfile& profile) {
+  if (profile.fbLocation != CAMERA_FB_IN_PSRAM) {
+    return 0;
+  }
+
+  return profile.fbCount * static_cast<size_t>(profile.width) * profile.height * sizeof(uint16_t);
+}
+
 }  // namespace
 
 /**
@@ -18,9 +82,30 @@ constexpr const lgfx::U8g2font* BODY_FONT = &fonts::lgfxJapanGothic_24;
  */
 CameraMode::CameraMode()
 : cameraConfig_(),
+  frameQueue_(nullptr),
+  captureTaskHandle_(nullptr),
+  displayingFrame_(nullptr),
+  isCaptureRunning_(false),
+  isCaptureIdle_(true),
+  hasCaptureFailed_(false),
+  capturedFrameCount_(0),
+  displayedFrameCount_(0),
+  fpsWindowStartedAtMs_(0),
+  fpsWindowCapturedFrameCount_(0),
+  liveViewJobId_(DeadlineScheduler::INVALID_JOB_ID),
+  liveViewFps_(0.0f),
+  captureFps_(0.0f),
   isCameraInitialized_(false),
   isCameraReady_(false),
-  viewState_(ViewState::LIVE) {
+  isCameraSuspended_(false),
+  viewState_(ViewState::LIVE),
+  stillFramePool_(),
+  photoSaver_(),
+  galleryOffset_(0),
+  liveFilter_(ImageFilter::NONE),
+  profileGovernor_(CAMERA_PROFILE_GOVERNOR_CONFIG, CAMERA_PROFILE_COUNT),
+  pendingProfileIndex_(0),
+  hasPendingProfile_(false) {
 }
 
 /**
@@ -34,15 +119,50 @@ void CameraMode::enter() {
     return;
   }
 
-  updateCameraLiveScreen();
+  // 合成描画が無効な場合は画面へ直接描くためSPIバスを占有できず、SDカードへの書き出しと衝突します。
+  if (!stillFramePool_.begin()) {
+    LOG_WARN(CAM, "still pool alloc failed bytes=%u", static_cast<unsigned>(StillFramePool::FRAME_BYTES * StillFramePool::SLOT_CAPACITY));
+  } else if (ENABLE_PHOTO_SAVE && !frameCompositor().isEnabled()) {
+    LOG_WARN(CAM, "compositor disabled, photo save skipped");
+  } else if (ENABLE_PHOTO_SAVE && !photoSaver_.begin(stillFramePool_, frameCompositor())) {
+    LOG_WARN(CAM, "photo saver start failed");
+  }
+
+  startLiveView();
+}
+
+/**
+ * モードから離れる際にライブ表示を止め、カメラを休止または解放します。
+ */
+void CameraMode::exit() {
+  stopLiveViewJob();
+  stopCapturePipeline();
+
+  if (!isCameraReady_) {
+    releaseCameraModule();
+    return;
+  }
+
+  const bool canKeepBuffers = cameraConfig_.fb_location == CAMERA_FB_IN_PSRAM;
+  if (ENABLE_CAMERA_WARM_RESUME && canKeepBuffers && setSensorOutputEnabled(false)) {
+    isCameraSuspended_ = true;
+    LOG_INFO(CAM, "suspended");
+    return;
+  }
+
+  releaseCameraModule();
 }
 
 /**
  * タップ入力を処理します。
+ * ※左上の角はどの表示中でもモード選択画面へ戻ります。
  */
 void CameraMode::onTouch(const int touchX, const int touchY) {
-  static_cast<void>(touchX);
-  static_cast<void>(touchY);
+  // ライブ表示中はボタンを重ねないため、左上の角を押下範囲として扱います。
+  if (isBackButtonTouched(touchX, touchY)) {
+    requestModeSelection();
+    return;
+  }
 
   if (!isCameraReady_) {
     enter();
@@ -50,56 +170,95 @@ void CameraMode::onTouch(const int touchX, const int touchY) {
   }
 
   if (viewState_ == ViewState::LIVE) {
+    if (touchX < EDGE_TAP_ZONE_W || touchX >= M5.Display.width() - EDGE_TAP_ZONE_W) {
+      liveFilter_ = getNextImageFilter(liveFilter_, touchX < EDGE_TAP_ZONE_W ? -1 : 1);
+      LOG_INFO(CAM, "filter=%s", getImageFilterName(liveFilter_));
+      return;
+    }
+
     playShutterTone();
     viewState_ = ViewState::STILL;
-    drawStillPhotoFrame();
+    stopLiveViewJob();
+    renderStillPhoto();
+    return;
+  }
+
+  // 保存済みの静止画は取り直さずに、プールから直接表示して送ります。
+  if (touchX < EDGE_TAP_ZONE_W) {
+    renderGalleryPhoto(galleryOffset_ + 1);
+    return;
+  }
+
+  if (touchX >= surface().width() - EDGE_TAP_ZONE_W) {
+    if (galleryOffset_ > 0) {
+      renderGalleryPhoto(galleryOffset_ - 1);
+    }
     return;
   }
 
   viewState_ = ViewState::LIVE;
-  updateCameraLiveScreen();
+  startLiveView();
 }
 
 /**
- * モードの定期更新を処理します。
+ * タッチ操作を処理します。
+ * ※指を右へ払うと静止画は古い写真へ、画像効果は前の効果へ戻ります。
  */
-void CameraMode::update() {
-  if (viewState_ != ViewState::LIVE) {
+void CameraMode::onTouchEvent(const TouchEvent& event) {
+  const bool isHorizontalSwipe = event.gesture == TouchGesture::SWIPE
+    && (event.direction == SwipeDirection::LEFT || event.direction == SwipeDirection::RIGHT);
+  if (!isCameraReady_ || !isHorizontalSwipe) {
+    ModeBase::onTouchEvent(event);
     return;
   }
 
-  updateCameraLiveScreen();
+  const bool isRightSwipe = event.direction == SwipeDirection::RIGHT;
+  if (viewState_ == ViewState::LIVE) {
+    liveFilter_ = getNextImageFilter(liveFilter_, isRightSwipe ? -1 : 1);
+    LOG_INFO(CAM, "filter=%s", getImageFilterName(liveFilter_));
+    return;
+  }
+
+  if (isRightSwipe) {
+    renderGalleryPhoto(galleryOffset_ + 1);
+  } else if (galleryOffset_ > 0) {
+    renderGalleryPhoto(galleryOffset_ - 1);
+  }
 }
 
 /**
  * モード選択時の起動音を鳴らします。
  */
 void CameraMode::playStartupTone() const {
-  playToneSteps(STARTUP_TONE_STEPS);
+  playTone(Tone::STARTUP);
 }
 
 /**
- * デバッグログをUSBシリアルへ出力します。
+ * 直近に計測したライブ表示の画面更新FPSを返します。
  */
-void CameraMode::logDebug(const String& message) const {
-  if (!ENABLE_SERIAL_DEBUG) {
-    return;
-  }
+float CameraMode::getLiveViewFps() const {
+  return liveViewFps_;
+}
 
-  Serial.println(message);
+/**
+ * 直近に計測したカメラ取得FPSを返します。
+ */
+float CameraMode::getCaptureFps() const {
+  return captureFps_;
 }
 
 /**
  * シャッター音を鳴らします。
  */
 void CameraMode::playShutterTone() const {
-  playToneSteps(SHUTTER_TONE_STEPS);
+  playTone(Tone::SHUTTER);
 }
 
 /**
- * カメラ設定を初期化します。
+ * 指定した取得設定でカメラ設定を初期化します。
  */
-void CameraMode::initializeCameraConfig(const bool useCompactProfile) {
+void CameraMode::initializeCameraConfig(const size_t profileIndex) {
+  const CameraProfile& profile = CAMERA_PROFILES[profileIndex];
   cameraConfig_.pin_pwdn = -1;
   cameraConfig_.pin_reset = -1;
   cameraConfig_.pin_xclk = -1;
@@ -116,15 +275,15 @@ void CameraMode::initializeCameraConfig(const bool useCompactProfile) {
   cameraConfig_.pin_vsync = 46;
   cameraConfig_.pin_href = 38;
   cameraConfig_.pin_pclk = 45;
-  cameraConfig_.xclk_freq_hz = 20000000;
+  cameraConfig_.xclk_freq_hz = profile.xclkHz;
   cameraConfig_.ledc_timer = LEDC_TIMER_0;
   cameraConfig_.ledc_channel = LEDC_CHANNEL_0;
   cameraConfig_.pixel_format = PIXFORMAT_RGB565;
-  cameraConfig_.frame_size = FRAMESIZE_QVGA;
+  cameraConfig_.frame_size = profile.frameSize;
   cameraConfig_.jpeg_quality = 0;
-  cameraConfig_.fb_count = useCompactProfile ? 1 : 2;
-  cameraConfig_.fb_location = useCompactProfile ? CAMERA_FB_IN_DRAM : CAMERA_FB_IN_PSRAM;
-  cameraConfig_.grab_mode = CAMERA_GRAB_LATEST;
+  cameraConfig_.fb_count = profile.fbCount;
+  cameraConfig_.fb_location = profile.fbLocation;
+  cameraConfig_.grab_mode = profile.grabMode;
   cameraConfig_.sccb_i2c_port = -1;
 }
 
@@ -132,33 +291,50 @@ void CameraMode::initializeCameraConfig(const bool useCompactProfile) {
  * カメラモジュールを初期化し、利用可否を返します。
  */
 bool CameraMode::initializeCameraModule() {
+  if (isCameraSuspended_) {
+    isCameraSuspended_ = false;
+    if (setSensorOutputEnabled(true)) {
+      LOG_INFO(CAM, "resumed");
+      return true;
+    }
+
+    LOG_WARN(CAM, "resume failed, reinitializing");
+    isCameraReady_ = false;
+  }
+
   if (isCameraReady_) {
     return true;
   }
 
+  // タッチパネルと内部I2Cバスを共有するため、解放と初期化の間はタッチ処理タスクの読み取りを止めます。
+  size_t profileIndex = profileGovernor_.getProfileIndex();
+  inputPipeline().lockInternalBus();
   if (isCameraInitialized_) {
     esp_camera_deinit();
     isCameraInitialized_ = false;
   }
 
-  initializeCameraConfig(false);
+  initializeCameraConfig(profileIndex);
   M5.In_I2C.release();
   esp_err_t result = esp_camera_init(&cameraConfig_);
-  if (result == ESP_OK) {
-    isCameraInitialized_ = true;
-    isCameraReady_ = true;
-    logDebug("[CAM] init ok profile=normal");
-    return true;
+  if (result != ESP_OK && profileIndex != COMPACT_CAMERA_PROFILE_INDEX) {
+    LOG_WARN(CAM, "init failed profile=%s err=%d", CAMERA_PROFILES[profileIndex].name, static_cast<int>(result));
+    esp_camera_deinit();
+    delay(20);
+
+    profileIndex = COMPACT_CAMERA_PROFILE_INDEX;
+    initializeCameraConfig(profileIndex);
+    result = esp_camera_init(&cameraConfig_);
   }
 
-  logDebug("[CAM] init failed profile=normal err=" + String(static_cast<int>(result)));
-  esp_camera_deinit();
-  delay(20);
+  // 初期化できなかった場合は、タッチパネルが読めるよう内部I2Cを戻してから解放します。
+  if (result != ESP_OK) {
+    M5.In_I2C.begin();
+  }
+  inputPipeline().unlockInternalBus();
 
-  initializeCameraConfig(true);
-  result = esp_camera_init(&cameraConfig_);
   if (result != ESP_OK) {
-    logDebug("[CAM] init failed profile=compact err=" + String(static_cast<int>(result)));
+    LOG_ERROR(CAM, "init failed profile=%s err=%d", CAMERA_PROFILES[profileIndex].name, static_cast<int>(result));
     isCameraInitialized_ = false;
     isCameraReady_ = false;
     return false;
@@ -166,10 +342,140 @@ bool CameraMode::initializeCameraModule() {
 
   isCameraInitialized_ = true;
   isCameraReady_ = true;
-  logDebug("[CAM] init ok profile=compact");
+  profileGovernor_.reset(profileIndex);
+  logCameraProfile(profileIndex);
   return true;
 }
 
+/**
+ * 適用した取得設定をログ出力します。
+ */
+void CameraMode::logCameraProfile(const size_t profileIndex) const {
+  const CameraProfile& profile = CAMERA_PROFILES[profileIndex];
+  LOG_INFO(
+    CAM,
+    "init ok profile=%s frame=%dx%d xclk=%dMHz fb=%u loc=%s grab=%s",
+    profile.name,
+    profile.width,
+    profile.height,
+    profile.xclkHz / 1000000,
+    static_cast<unsigned>(profile.fbCount),
+    profile.fbLocation == CAMERA_FB_IN_PSRAM ? "psram" : "dram",
+    profile.grabMode == CAMERA_GRAB_LATEST ? "latest" : "when_empty"
+  );
+}
+
+/**
+ * 直近の計測区間のFPSとPSRAMの空きから、取得設定を切り替えるかを判定します。
+ * ※切り替えはライブ表示の次回更新時に行います。
+ */
+void CameraMode::evaluateCameraProfile() {
+  if (!ENABLE_ADAPTIVE_CAMERA_PROFILE || hasPendingProfile_) {
+    return;
+  }
+
+  const size_t currentIndex = profileGovernor_.getProfileIndex();
+  const CameraProfile& current = CAMERA_PROFILES[currentIndex];
+  const size_t freePsramBytes = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  const bool isMemoryLow = current.fbLocation == CAMERA_FB_IN_PSRAM && freePsramBytes < CAMERA_MIN_FREE_PSRAM_BYTES;
+  const CameraProfileGovernor::Sample sample = {liveViewFps_, captureFps_, isMemoryLow};
+  const CameraProfileGovernor::Decision decision = profileGovernor_.evaluate(sample);
+  if (decision == CameraProfileGovernor::Decision::STAY) {
+    return;
+  }
+
+  const bool isDowngrade = decision == CameraProfileGovernor::Decision::DOWNGRADE;
+  const size_t nextIndex = isDowngrade ? currentIndex + 1 : currentIndex - 1;
+  const char* reason = isMemoryLow ? "psram" : (isDowngrade ? "slow" : "fast");
+
+  // 重い側へ戻すと増えるフレームバッファを確保しても空きが残る場合だけ戻します。
+  const size_t currentPsramBytes = getProfilePsramBytes(current);
+  const size_t nextPsramBytes = getProfilePsramBytes(CAMERA_PROFILES[nextIndex]);
+  if (
+    !isDowngrade &&
+    nextPsramBytes > currentPsramBytes &&
+    freePsramBytes < nextPsramBytes - currentPsramBytes + CAMERA_MIN_FREE_PSRAM_BYTES
+  ) {
+    LOG_DEBUG(PERF, "camera profile hold=%s psram_free=%u", current.name, static_cast<unsigned>(freePsramBytes));
+    profileGovernor_.reset(currentIndex);
+    return;
+  }
+
+  LOG_INFO(
+    PERF,
+    "camera profile %s -> %s reason=%s display=%.1f capture=%.1f psram_free=%u upgrade_after=%u",
+    current.name,
+    CAMERA_PROFILES[nextIndex].name,
+    reason,
+    liveViewFps_,
+    captureFps_,
+    static_cast<unsigned>(freePsramBytes),
+    static_cast<unsigned>(profileGovernor_.getRequiredUpgradeWindows())
+  );
+  pendingProfileIndex_ = nextIndex;
+  hasPendingProfile_ = true;
+}
+
+/**
+ * 保留中の取得設定でカメラを初期化し直し、ライブ表示を再開します。
+ */
+void CameraMode::applyPendingCameraProfile() {
+  hasPendingProfile_ = false;
+  stopCapturePipeline();
+
+  profileGovernor_.reset(pendingProfileIndex_);
+  isCameraReady_ = false;
+  if (!initializeCameraModule()) {
+    handleCaptureFailure();
+    return;
+  }
+
+  startLiveView();
+}
+
+/**
+ * センサーの画像出力を有効または無効にし、設定できたかを返します。
+ */
+bool CameraMode::setSensorOutputEnabled(const bool isEnabled) {
+  sensor_t* sensor = esp_camera_sensor_get();
+  if (sensor == nullptr || sensor->set_reg == nullptr) {
+    return false;
+  }
+
+  inputPipeline().lockInternalBus();
+  const int result = sensor->set_reg(
+    sensor,
+    SENSOR_OUTPUT_ENABLE_REG,
+    0xFF,
+    isEnabled ? SENSOR_OUTPUT_ENABLE_VALUE : 0x00
+  );
+  inputPipeline().unlockInternalBus();
+  return result == 0;
+}
+
+/**
+ * カメラのドライバを停止し、フレームバッファと静止画の保存領域を解放します。
+ * ※初期化時に明け渡した内部I2Cバスをタッチパネル用に再び設定します。
+ */
+void CameraMode::releaseCameraModule() {
+  isCameraSuspended_ = false;
+  isCameraReady_ = false;
+
+  // 保存タスクが静止画を読み終えるまで、保存領域を解放しません。
+  photoSaver_.waitForIdle();
+  stillFramePool_.end();
+  if (!isCameraInitialized_) {
+    return;
+  }
+
+  inputPipeline().lockInternalBus();
+  esp_camera_deinit();
+  M5.In_I2C.begin();
+  inputPipeline().unlockInternalBus();
+  isCameraInitialized_ = false;
+  LOG_INFO(CAM, "released");
+}
+
 /**
  * カメラフレームを1枚取得します。
  */
@@ -194,38 +500,79 @@ void CameraMode::releaseCameraFrame(camera_fb_t*& frame) {
  * 文字列を中央揃えで描画します。
  */
 void CameraMode::drawCenteredText(const String& text, const int y) const {
-  const int x = (M5.Display.width() - M5.Display.textWidth(text)) / 2;
-  M5.Display.setCursor(std::max(x, 0), y);
-  M5.Display.print(text);
+  const int x = (surface().width() - surface().textWidth(text)) / 2;
+  surface().setCursor(std::max(x, 0), y);
+  surface().print(text);
 }
 
 /**
  * カメラ未利用時の画面を描画します。
+ * ※2回目以降は保存済みの画面を転送します。
  */
 void CameraMode::renderCameraUnavailableScreen() const {
-  M5.Display.fillScreen(TFT_BLACK);
-  M5.Display.setFont(BODY_FONT);
-  M5.Display.setTextColor(TFT_WHITE, TFT_BLACK);
+  if (presentCachedScreen(CachedScreen::CAMERA_UNAVAILABLE)) {
+    return;
+  }
+
+  surface().fillScreen(TFT_BLACK);
+  surface().setFont(BODY_FONT);
+  surface().setTextColor(TFT_WHITE, TFT_BLACK);
   drawCenteredText("カメラを", 82);
   drawCenteredText("つかえません", 118);
   drawCenteredText("タップでさいしこう", 168);
+  drawBackButton();
+  cacheScreen(CachedScreen::CAMERA_UNAVAILABLE);
+  presentSurface();
+}
+
+/**
+ * RGB565の画像を描画先の中央へ描画します。
+ */
+void CameraMode::drawStillImage(const uint16_t* pixels, const int width, const int height) const {
+  if (width != surface().width() || height != surface().height()) {
+    surface().fillScreen(TFT_BLACK);
+  }
+
+  const int drawX = (surface().width() - width) / 2;
+  const int drawY = (surface().height() - height) / 2;
+  surface().pushImage(std::max(drawX, 0), std::max(drawY, 0), width, height, pixels);
+}
+
+/**
+ * カメラフレームを描画先へ描画します。
+ */
+void CameraMode::drawCameraFrame(const camera_fb_t* frame) const {
+  drawStillImage(reinterpret_cast<const uint16_t*>(frame->buf), frame->width, frame->height);
+}
+
+/**
+ * 選択中の画像効果をカメラフレームへその場でかけます。
+ * ※ドライバから受け取ったフレームは返却まで専有しているため、複写せずに書き換えます。
+ */
+void CameraMode::applyLiveFilter(camera_fb_t* frame) const {
+  if (liveFilter_ == ImageFilter::NONE || frame->format != PIXFORMAT_RGB565) {
+    return;
+  }
+
+  const ScopedTimer timer(PerfSection::CAMERA_FILTER);
+  applyImageFilter(liveFilter_, reinterpret_cast<uint16_t*>(frame->buf), frame->width, frame->height);
 }
 
 /**
  * カメラフレームを画面へ描画します。
+ * ※DMA転送の完了を待たずに戻るため、返却前にfinishDisplayingFrame等で完了を待ちます。
  */
 void CameraMode::renderCameraFrame(const camera_fb_t* frame) const {
   if (frame == nullptr) {
     return;
   }
 
-  if (frame->width != M5.Display.width() || frame->height != M5.Display.height()) {
-    M5.Display.fillScreen(TFT_BLACK);
-  }
-
+  // フレーム自体がオフスクリーン画面のため、合成せずにDMAで直接転送します。
+  // ※周囲の塗りつぶしはライブ表示の開始時に済ませます。
   const int drawX = (M5.Display.width() - frame->width) / 2;
   const int drawY = (M5.Display.height() - frame->height) / 2;
-  M5.Display.pushImage(
+
+  frameCompositor().presentImageAsync(
     std::max(drawX, 0),
     std::max(drawY, 0),
     frame->width,
@@ -238,8 +585,8 @@ void CameraMode::renderCameraFrame(const camera_fb_t* frame) const {
  * 静止画の外枠を描画します。
  */
 void CameraMode::drawStillPhotoFrame() const {
-  const int width = M5.Display.width();
-  const int height = M5.Display.height();
+  const int width = surface().width();
+  const int height = surface().height();
   const int innerX = STILL_FRAME_THICKNESS;
   const int innerY = STILL_FRAME_THICKNESS;
   const int innerW = std::max(width - STILL_FRAME_THICKNESS * 2, 1);
@@ -250,12 +597,57 @@ void CameraMode::drawStillPhotoFrame() const {
   const int lineW = std::max(width - lineOffset * 2, 1);
   const int lineH = std::max(height - lineOffset * 2, 1);
 
-  M5.Display.fillRect(0, 0, width, STILL_FRAME_THICKNESS, TFT_WHITE);
-  M5.Display.fillRect(0, height - STILL_FRAME_THICKNESS, width, STILL_FRAME_THICKNESS, TFT_WHITE);
-  M5.Display.fillRect(0, STILL_FRAME_THICKNESS, STILL_FRAME_THICKNESS, innerH, TFT_WHITE);
-  M5.Display.fillRect(width - STILL_FRAME_THICKNESS, STILL_FRAME_THICKNESS, STILL_FRAME_THICKNESS, innerH, TFT_WHITE);
-  M5.Display.drawRect(innerX, innerY, innerW, innerH, TFT_LIGHTGREY);
-  M5.Display.drawRect(lineX, lineY, lineW, lineH, TFT_DARKGREY);
+  surface().fillRect(0, 0, width, STILL_FRAME_THICKNESS, TFT_WHITE);
+  surface().fillRect(0, height - STILL_FRAME_THICKNESS, width, STILL_FRAME_THICKNESS, TFT_WHITE);
+  surface().fillRect(0, STILL_FRAME_THICKNESS, STILL_FRAME_THICKNESS, innerH, TFT_WHITE);
+  surface().fillRect(width - STILL_FRAME_THICKNESS, STILL_FRAME_THICKNESS, STILL_FRAME_THICKNESS, innerH, TFT_WHITE);
+  surface().drawRect(innerX, innerY, innerW, innerH, TFT_LIGHTGREY);
+  surface().drawRect(lineX, lineY, lineW, lineH, TFT_DARKGREY);
+}
+
+/**
+ * ライブ表示を開始します。
+ */
+void CameraMode::startLiveView() {
+  resetFpsStats();
+  profileGovernor_.reset(profileGovernor_.getProfileIndex());
+
+  // 画面より小さい取得設定では、フレームの周囲を一度だけ塗りつぶします。
+  const CameraProfile& profile = CAMERA_PROFILES[profileGovernor_.getProfileIndex()];
+  if (profile.width < M5.Display.width() || profile.height < M5.Display.height()) {
+    surface().fillScreen(TFT_BLACK);
+    presentSurface();
+  }
+
+  if (ENABLE_PIPELINED_CAPTURE && !startCapturePipeline()) {
+    LOG_ERROR(CAM, "capture task start failed");
+    handleCaptureFailure();
+    return;
+  }
+
+  if (!scheduler().isScheduled(liveViewJobId_)) {
+    liveViewJobId_ = scheduler().schedulePeriodic(millis(), LIVE_VIEW_POLL_INTERVAL_MS, runLiveViewJob, this);
+  }
+  updateCameraLiveScreen();
+}
+
+/**
+ * ライブ表示の更新ジョブを停止します。
+ */
+void CameraMode::stopLiveViewJob() {
+  scheduler().cancel(liveViewJobId_);
+}
+
+/**
+ * ライブ表示の更新ジョブです。
+ */
+void CameraMode::runLiveViewJob(void* context) {
+  CameraMode* mode = static_cast<CameraMode*>(context);
+  if (mode->viewState_ != ViewState::LIVE) {
+    return;
+  }
+
+  mode->updateCameraLiveScreen();
 }
 
 /**
@@ -266,14 +658,306 @@ void CameraMode::updateCameraLiveScreen() {
     return;
   }
 
+  if (hasPendingProfile_) {
+    applyPendingCameraProfile();
+    return;
+  }
+
+  const ScopedTimer timer(PerfSection::CAMERA_LIVE);
+
+  if (ENABLE_PIPELINED_CAPTURE) {
+    updatePipelinedLiveScreen();
+    return;
+  }
+
   camera_fb_t* frame = nullptr;
   if (!captureCameraFrame(frame)) {
-    logDebug("[CAM] capture failed");
-    isCameraReady_ = false;
-    renderCameraUnavailableScreen();
+    handleCaptureFailure();
     return;
   }
 
+  capturedFrameCount_.fetch_add(1, std::memory_order_relaxed);
+  applyLiveFilter(frame);
   renderCameraFrame(frame);
+  frameCompositor().waitForTransfer();
+  releaseCameraFrame(frame);
+  recordDisplayedFrame();
+}
+
+/**
+ * 取得タスクから届いたフレームを転送しながらライブ表示を更新します。
+ */
+void CameraMode::updatePipelinedLiveScreen() {
+  if (hasCaptureFailed_.load(std::memory_order_acquire)) {
+    handleCaptureFailure();
+    return;
+  }
+
+  // 転送中は待たずに戻り、その間に取得タスクが次のフレームを受け取ります。
+  if (displayingFrame_ != nullptr) {
+    if (!frameCompositor().isTransferComplete()) {
+      return;
+    }
+    finishDisplayingFrame();
+  }
+
+  camera_fb_t* frame = nullptr;
+  if (xQueueReceive(frameQueue_, &frame, 0) != pdTRUE) {
+    return;
+  }
+
+  displayingFrame_ = frame;
+  applyLiveFilter(displayingFrame_);
+  renderCameraFrame(displayingFrame_);
+  recordDisplayedFrame();
+}
+
+/**
+ * カメラ取得失敗時にカメラ未利用画面へ切り替えます。
+ */
+void CameraMode::handleCaptureFailure() {
+  LOG_ERROR(CAM, "capture failed");
+  stopLiveViewJob();
+  stopCapturePipeline();
+  isCameraReady_ = false;
+  renderCameraUnavailableScreen();
+}
+
+/**
+ * カメラ取得タスクを起動し、フレーム取得を開始します。
+ */
+bool CameraMode::startCapturePipeline() {
+  if (frameQueue_ == nullptr) {
+    frameQueue_ = xQueueCreate(FRAME_QUEUE_LENGTH, sizeof(camera_fb_t*));
+    if (frameQueue_ == nullptr) {
+      return false;
+    }
+  }
+
+  if (captureTaskHandle_ == nullptr) {
+    const BaseType_t result = xTaskCreatePinnedToCore(
+      runCaptureTask,
+      "camera",
+      CAPTURE_TASK_STACK_SIZE,
+      this,
+      CAPTURE_TASK_PRIORITY,
+      &captureTaskHandle_,
+      CAPTURE_TASK_CORE
+    );
+    if (result != pdPASS) {
+      captureTaskHandle_ = nullptr;
+      return false;
+    }
+  }
+
+  hasCaptureFailed_.store(false, std::memory_order_release);
+  isCaptureIdle_.store(false, std::memory_order_release);
+  isCaptureRunning_.store(true, std::memory_order_release);
+  xTaskNotifyGive(captureTaskHandle_);
+  return true;
+}
+
+/**
+ * フレーム取得を停止し、保持中のフレームをすべて返却します。
+ */
+void CameraMode::stopCapturePipeline() {
+  finishDisplayingFrame();
+
+  if (captureTaskHandle_ == nullptr) {
+    return;
+  }
+
+  isCaptureRunning_.store(false, std::memory_order_release);
+
+  // 取得タスクが受け渡し待ちで止まらないよう、待機へ戻るまでキューを空にし続けます。
+  camera_fb_t* frame = nullptr;
+  while (true) {
+    while (xQueueReceive(frameQueue_, &frame, 0) == pdTRUE) {
+      releaseCameraFrame(frame);
+    }
+
+    if (isCaptureIdle_.load(std::memory_order_acquire)) {
+      break;
+    }
+    vTaskDelay(1);
+  }
+
+  while (xQueueReceive(frameQueue_, &frame, 0) == pdTRUE) {
+    releaseCameraFrame(frame);
+  }
+}
+
+/**
+ * 転送中のフレームのDMA完了を待ち、ドライバへ返却します。
+ */
+void CameraMode::finishDisplayingFrame() {
+  if (displayingFrame_ == nullptr) {
+    return;
+  }
+
+  frameCompositor().waitForTransfer();
+  releaseCameraFrame(displayingFrame_);
+}
+
+/**
+ * カメラ取得タスクの本体です。
+ */
+void CameraMode::runCaptureTask(void* context) {
+  static_cast<CameraMode*>(context)->runCaptureLoop();
+}
+
+/**
+ * カメラ取得タスクでフレームを取得し続けます。
+ */
+void CameraMode::runCaptureLoop() {
+  while (true) {
+    if (!isCaptureRunning_.load(std::memory_order_acquire)) {
+      isCaptureIdle_.store(true, std::memory_order_release);
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+
+    camera_fb_t* frame = esp_camera_fb_get();
+    if (frame == nullptr) {
+      hasCaptureFailed_.store(true, std::memory_order_release);
+      isCaptureRunning_.store(false, std::memory_order_release);
+      vTaskDelay(pdMS_TO_TICKS(CAPTURE_RETRY_DELAY_MS));
+      continue;
+    }
+
+    capturedFrameCount_.fetch_add(1, std::memory_order_relaxed);
+
+    bool isHandedOff = false;
+    while (!isHandedOff && isCaptureRunning_.load(std::memory_order_acquire)) {
+      isHandedOff = xQueueSend(frameQueue_, &frame, FRAME_HANDOFF_TIMEOUT_TICKS) == pdTRUE;
+    }
+
+    if (!isHandedOff) {
+      esp_camera_fb_return(frame);
+    }
+  }
+}
+
+/**
+ * FPS計測値をリセットします。
+ */
+void CameraMode::resetFpsStats() {
+  displayedFrameCount_ = 0;
+  fpsWindowStartedAtMs_ = millis();
+  fpsWindowCapturedFrameCount_ = capturedFrameCount_.load(std::memory_order_relaxed);
+}
+
+/**
+ * 画面更新1回を記録し、計測区間ごとにFPSを更新します。
+ */
+void CameraMode::recordDisplayedFrame() {
+  ++displayedFrameCount_;
+
+  const uint32_t elapsedMs = millis() - fpsWindowStartedAtMs_;
+  if (elapsedMs < FPS_WINDOW_MS) {
+    return;
+  }
+
+  const uint32_t capturedFrameCount = capturedFrameCount_.load(std::memory_order_relaxed);
+  liveViewFps_ = displayedFrameCount_ * 1000.0f / elapsedMs;
+  captureFps_ = (capturedFrameCount - fpsWindowCapturedFrameCount_) * 1000.0f / elapsedMs;
+  LOG_DEBUG(
+    CAM,
+    "fps display=%.1f capture=%.1f path=%s",
+    liveViewFps_,
+    captureFps_,
+    ENABLE_PIPELINED_CAPTURE ? "pipelined" : "serial"
+  );
+  resetFpsStats();
+  evaluateCameraProfile();
+}
+
+/**
+ * 静止画に使うカメラフレームを1枚取得します。
+ */
+bool CameraMode::takeStillFrame(camera_fb_t*& frame) {
+  if (!ENABLE_PIPELINED_CAPTURE) {
+    return captureCameraFrame(frame);
+  }
+
+  // 取得タスクが次に受け渡すフレームを静止画として受け取り、以降の取得を止めます。
+  finishDisplayingFrame();
+  const bool hasFrame = xQueueReceive(frameQueue_, &frame, STILL_FRAME_TIMEOUT_TICKS) == pdTRUE;
+  stopCapturePipeline();
+  return hasFrame;
+}
+
+/**
+ * 現在のカメラフレームを静止画として外枠付きで表示します。
+ */
+void CameraMode::renderStillPhoto() {
+  camera_fb_t* frame = nullptr;
+  if (!takeStillFrame(frame)) {
+    drawStillPhotoFrame();
+    drawBackButton();
+    presentSurface();
+    return;
+  }
+
+  applyLiveFilter(frame);
+
+  // ドライバのフレームは2枚しかないため保持せず、プールへ複写してすぐ返却します。
+  const bool isStored = stillFramePool_.store(frame->buf, frame->len, frame->width, frame->height);
+  if (isStored) {
+    releaseCameraFrame(frame);
+    renderGalleryPhoto(0);
+
+    // 保存待ちが満杯なら書き出しだけを諦め、撮影とライブ表示への復帰は待たせません。
+    size_t slot = 0;
+    if (photoSaver_.isStarted() && stillFramePool_.getNewestSlot(slot) && !photoSaver_.enqueue(slot)) {
+      LOG_WARN(CAM, "save queue full, photo not saved");
+    }
+    return;
+  }
+
+  drawCameraFrame(frame);
   releaseCameraFrame(frame);
+  drawStillPhotoFrame();
+  drawBackButton();
+  presentSurface();
+}
+
+/**
+ * 保存済みの静止画を新しい方から数えた位置で表示し、表示できたかを返します。
+ */
+bool CameraMode::renderGalleryPhoto(const size_t offset) {
+  StillFrame frame;
+  if (!stillFramePool_.getNewest(offset, frame)) {
+    return false;
+  }
+
+  galleryOffset_ = offset;
+  drawStillImage(frame.pixels, frame.width, frame.height);
+  drawStillPhotoFrame();
+  drawGalleryPosition(offset);
+  drawBackButton();
+  presentSurface();
+  return true;
+}
+
+/**
+ * 表示中の静止画が何枚目かを描画します。
+ * ※新しい方を右端として、左右の送り先があれば矢印を添えます。
+ */
+void CameraMode::drawGalleryPosition(const size_t offset) const {
+  const size_t count = stillFramePool_.size();
+  char label[16];
+  snprintf(
+    label,
+    sizeof(label),
+    "%s%u/%u%s",
+    offset + 1 < count ? "< " : "",
+    static_cast<unsigned>(count - offset),
+    static_cast<unsigned>(count),
+    offset > 0 ? " >" : ""
+  );
+
+  surface().setFont(BODY_FONT);
+  surface().setTextColor(TFT_WHITE, TFT_BLACK);
+  drawCenteredText(label, surface().height() - GALLERY_POSITION_MARGIN_BOTTOM - surface().fontHeight());
 }
@@ -3,8 +3,16 @@
 
 #include <M5Unified.h>
 #include <esp_camera.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
 
+#include <atomic>
+
+#include "camera-profile-governor.h"
+#include "image-filter.h"
 #include "mode-base.h"
+#include "photo-saver.h"
+#include "still-frame-pool.h"
 
 /**
  * カメラモードを提供します。
@@ -21,21 +29,38 @@ class CameraMode : public ModeBase {
    */
   void enter() override;
 
+  /**
+   * モードから離れる際にライブ表示を止め、カメラを休止または解放します。
+   */
+  void exit() override;
+
   /**
    * タップ入力を処理します。
+   * ※左上の角はどの表示中でもモード選択画面へ戻ります。
    */
   void onTouch(int touchX, int touchY) override;
 
   /**
-   * モードの定期更新を処理します。
+   * タッチ操作を処理します。
+   * ※左右のスワイプでライブ表示中は画像効果を、静止画表示中は写真を送り、それ以外は共通の処理へ渡します。
    */
-  void update() override;
+  void onTouchEvent(const TouchEvent& event) override;
 
   /**
    * モード選択時の起動音を鳴らします。
    */
   void playStartupTone() const;
 
+  /**
+   * 直近に計測したライブ表示の画面更新FPSを返します。
+   */
+  float getLiveViewFps() const;
+
+  /**
+   * 直近に計測したカメラ取得FPSを返します。
+   */
+  float getCaptureFps() const;
+
  private:
   /**
    * カメラ表示状態を表します。
@@ -45,26 +70,49 @@ class CameraMode : public ModeBase {
     STILL,
   };
 
-  /**
-   * デバッグログをUSBシリアルへ出力します。
-   */
-  void logDebug(const String& message) const;
-
   /**
    * シャッター音を鳴らします。
    */
   void playShutterTone() const;
 
   /**
-   * カメラ設定を初期化します。
+   * 指定した取得設定でカメラ設定を初期化します。
    */
-  void initializeCameraConfig(bool useCompactProfile);
+  void initializeCameraConfig(size_t profileIndex);
 
   /**
    * カメラモジュールを初期化し、利用可否を返します。
+   * ※現在の取得設定で初期化できない場合は、PSRAMを使わない縮小構成で初期化し直します。
    */
   bool initializeCameraModule();
 
+  /**
+   * 適用した取得設定をログ出力します。
+   */
+  void logCameraProfile(size_t profileIndex) const;
+
+  /**
+   * 直近の計測区間のFPSとPSRAMの空きから、取得設定を切り替えるかを判定します。
+   * ※切り替えはライブ表示の次回更新時に行います。
+   */
+  void evaluateCameraProfile();
+
+  /**
+   * 保留中の取得設定でカメラを初期化し直し、ライブ表示を再開します。
+   */
+  void applyPendingCameraProfile();
+
+  /**
+   * センサーの画像出力を有効または無効にし、設定できたかを返します。
+   * ※無効にするとドライバのフレーム取り込みが止まり、設定とフレームバッファは保持されます。
+   */
+  bool setSensorOutputEnabled(bool isEnabled);
+
+  /**
+   * カメラのドライバを停止し、フレームバッファと静止画の保存領域を解放します。
+   */
+  void releaseCameraModule();
+
   /**
    * カメラフレームを1枚取得します。
    */
@@ -82,9 +130,25 @@ class CameraMode : public ModeBase {
 
   /**
    * カメラ未利用時の画面を描画します。
+   * ※2回目以降は保存済みの画面を転送します。
    */
   void renderCameraUnavailableScreen() const;
 
+  /**
+   * RGB565の画像を描画先の中央へ描画します。
+   */
+  void drawStillImage(const uint16_t* pixels, int width, int height) const;
+
+  /**
+   * カメラフレームを描画先へ描画します。
+   */
+  void drawCameraFrame(const camera_fb_t* frame) const;
+
+  /**
+   * 選択中の画像効果をカメラフレームへその場でかけます。
+   */
+  void applyLiveFilter(camera_fb_t* frame) const;
+
   /**
    * カメラフレームを画面へ描画します。
    */
@@ -95,15 +159,117 @@ class CameraMode : public ModeBase {
    */
   void drawStillPhotoFrame() const;
 
+  /**
+   * ライブ表示を開始します。
+   */
+  void startLiveView();
+
+  /**
+   * ライブ表示の更新ジョブを停止します。
+   */
+  void stopLiveViewJob();
+
+  /**
+   * ライブ表示の更新ジョブです。
+   */
+  static void runLiveViewJob(void* context);
+
   /**
    * ライブカメラ表示を更新します。
    */
   void updateCameraLiveScreen();
 
+  /**
+   * 取得タスクから届いたフレームを転送しながらライブ表示を更新します。
+   */
+  void updatePipelinedLiveScreen();
+
+  /**
+   * カメラ取得失敗時にカメラ未利用画面へ切り替えます。
+   */
+  void handleCaptureFailure();
+
+  /**
+   * カメラ取得タスクを起動し、フレーム取得を開始します。
+   */
+  bool startCapturePipeline();
+
+  /**
+   * フレーム取得を停止し、保持中のフレームをすべて返却します。
+   */
+  void stopCapturePipeline();
+
+  /**
+   * 転送中のフレームのDMA完了を待ち、ドライバへ返却します。
+   */
+  void finishDisplayingFrame();
+
+  /**
+   * カメラ取得タスクの本体です。
+   */
+  static void runCaptureTask(void* context);
+
+  /**
+   * カメラ取得タスクでフレームを取得し続けます。
+   */
+  void runCaptureLoop();
+
+  /**
+   * FPS計測値をリセットします。
+   */
+  void resetFpsStats();
+
+  /**
+   * 画面更新1回を記録し、計測区間ごとにFPSを更新します。
+   */
+  void recordDisplayedFrame();
+
+  /**
+   * 静止画に使うカメラフレームを1枚取得します。
+   */
+  bool takeStillFrame(camera_fb_t*& frame);
+
+  /**
+   * 現在のカメラフレームを静止画として保存し、外枠付きで表示します。
+   * ※保存できない場合は取得したフレームをその場で表示します。microSDへの書き出しは保存タスクへ依頼します。
+   */
+  void renderStillPhoto();
+
+  /**
+   * 保存済みの静止画を新しい方から数えた位置で表示し、表示できたかを返します。
+   */
+  bool renderGalleryPhoto(size_t offset);
+
+  /**
+   * 表示中の静止画が何枚目かを描画します。
+   */
+  void drawGalleryPosition(size_t offset) const;
+
   camera_config_t cameraConfig_;
+  QueueHandle_t frameQueue_;
+  TaskHandle_t captureTaskHandle_;
+  camera_fb_t* displayingFrame_;
+  std::atomic<bool> isCaptureRunning_;
+  std::atomic<bool> isCaptureIdle_;
+  std::atomic<bool> hasCaptureFailed_;
+  std::atomic<uint32_t> capturedFrameCount_;
+  uint32_t displayedFrameCount_;
+  uint32_t fpsWindowStartedAtMs_;
+  uint32_t fpsWindowCapturedFrameCount_;
+  uint32_t liveViewJobId_;
+  float liveViewFps_;
+  float captureFps_;
   bool isCameraInitialized_;
   bool isCameraReady_;
+  bool isCameraSuspended_;
   ViewState viewState_;
+  StillFramePool stillFramePool_;
+  PhotoSaver photoSaver_;
+  size_t galleryOffset_;
+  ImageFilter liveFilter_;
+  CameraProfileGovernor profileGovernor_;
+  size_t pendingProfileIndex_;
+  bool hasPendingProfile_;
 };
 
 #endif
@@ -0,0 +1,94 @@
+#include "camera-profile-governor.h"
+
+/**
+ * 指定した条件と設定数で初期化します。
+ */
+CameraProfileGovernor::CameraProfileGovernor(const Config& config, const size_t profileCount)
+: config_(config),
+  profileCount_(profileCount),
+  profileIndex_(0),
+  slowWindowCount_(0),
+  fastWindowCount_(0),
+  requiredUpgradeWindows_(config.upgradeWindows),
+  isWarmingUp_(true),
+  hasJustUpgraded_(false) {
+}
+
+/**
+ * 現在の設定を指定し、計測の積み上げをやり直します。
+ */
+void CameraProfileGovernor::reset(const size_t profileIndex) {
+  profileIndex_ = profileIndex < profileCount_ ? profileIndex : profileCount_ - 1;
+  slowWindowCount_ = 0;
+  fastWindowCount_ = 0;
+  isWarmingUp_ = true;
+}
+
+/**
+ * 1計測区間の測定値を積み上げ、切り替えるかを返します。
+ * ※重い側へ戻した直後に再び軽い側へ落ちた場合は、次に戻すまでの区間数を倍にして往復を抑えます。
+ */
+CameraProfileGovernor::Decision CameraProfileGovernor::evaluate(const Sample& sample) {
+  if (isWarmingUp_) {
+    isWarmingUp_ = false;
+    return Decision::STAY;
+  }
+
+  const bool isLastProfile = profileIndex_ + 1 >= profileCount_;
+  if (sample.isMemoryLow && !isLastProfile) {
+    hasJustUpgraded_ = false;
+    return Decision::DOWNGRADE;
+  }
+
+  const float achievedFps = sample.displayFps < sample.captureFps ? sample.displayFps : sample.captureFps;
+  if (achievedFps < config_.targetFps) {
+    fastWindowCount_ = 0;
+    if (slowWindowCount_ < UINT8_MAX) {
+      ++slowWindowCount_;
+    }
+
+    if (slowWindowCount_ < config_.downgradeWindows || isLastProfile) {
+      return Decision::STAY;
+    }
+
+    if (hasJustUpgraded_) {
+      const uint16_t doubled = static_cast<uint16_t>(requiredUpgradeWindows_) * 2;
+      requiredUpgradeWindows_ = static_cast<uint8_t>(
+        doubled < config_.maxUpgradeWindows ? doubled : config_.maxUpgradeWindows
+      );
+    }
+    hasJustUpgraded_ = false;
+    return Decision::DOWNGRADE;
+  }
+
+  slowWindowCount_ = 0;
+  hasJustUpgraded_ = false;
+  if (achievedFps < config_.targetFps * config_.upgradeFpsRatio || profileIndex_ == 0) {
+    fastWindowCount_ = 0;
+    return Decision::STAY;
+  }
+
+  if (fastWindowCount_ < UINT8_MAX) {
+    ++fastWindowCount_;
+  }
+  if (fastWindowCount_ < requiredUpgradeWindows_) {
+    return Decision::STAY;
+  }
+
+  hasJustUpgraded_ = true;
+  return Decision::UPGRADE;
+}
+
+/**
+ * 現在の設定の添字を返します。
+ */
+size_t CameraProfileGovernor::getProfileIndex() const {
+  return profileIndex_;
+}
+
+/**
+ * 重い側への切り替えを試すまでに必要な、目標を上回る区間数を返します。
+ */
+uint8_t CameraProfileGovernor::getRequiredUpgradeWindows() const {
+  return requiredUpgradeWindows_;
+}
@@ -0,0 +1,80 @@
+#ifndef CAMERA_PROFILE_GOVERNOR_H
+#define CAMERA_PROFILE_GOVERNOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 計測したFPSから、カメラ設定を軽い側と重い側のどちらへ切り替えるかを決めます。
+ * ※設定は添字0を最も重い設定とし、添字が大きいほど軽い設定として並べます。
+ */
+class CameraProfileGovernor {
+ public:
+  /**
+   * 切り替えの判定条件です。
+   */
+  struct Config {
+    float targetFps;
+    float upgradeFpsRatio;
+    uint8_t downgradeWindows;
+    uint8_t upgradeWindows;
+    uint8_t maxUpgradeWindows;
+  };
+
+  /**
+   * 1計測区間の測定値です。
+   */
+  struct Sample {
+    float displayFps;
+    float captureFps;
+    bool isMemoryLow;
+  };
+
+  /**
+   * 判定結果です。
+   */
+  enum class Decision {
+    STAY,
+    DOWNGRADE,
+    UPGRADE,
+  };
+
+  /**
+   * 指定した条件と設定数で初期化します。
+   */
+  CameraProfileGovernor(const Config& config, size_t profileCount);
+
+  /**
+   * 現在の設定を指定し、計測の積み上げをやり直します。
+   * ※切り替え直後の1区間は立ち上がりを含むため判定に使いません。
+   */
+  void reset(size_t profileIndex);
+
+  /**
+   * 1計測区間の測定値を積み上げ、切り替えるかを返します。
+   * ※DOWNGRADE/UPGRADEを返した場合、呼び出し側は切り替え後にresetを呼び出します。
+   */
+  Decision evaluate(const Sample& sample);
+
+  /**
+   * 現在の設定の添字を返します。
+   */
+  size_t getProfileIndex() const;
+
+  /**
+   * 重い側への切り替えを試すまでに必要な、目標を上回る区間数を返します。
+   */
+  uint8_t getRequiredUpgradeWindows() const;
+
+ private:
+  Config config_;
+  size_t profileCount_;
+  size_t profileIndex_;
+  uint8_t slowWindowCount_;
+  uint8_t fastWindowCount_;
+  uint8_t requiredUpgradeWindows_;
+  bool isWarmingUp_;
+  bool hasJustUpgraded_;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "catalog-index.h"
+
+#include <string.h>
+
+#include "product-catalog.h"
+
+namespace {
+
+// イメージの識別子 "KRCT" と形式の版です。tools/make-catalog.py と揃えます。
+constexpr uint32_t CATALOG_MAGIC = 0x5443524BUL;
+constexpr uint16_t CATALOG_VERSION = 1;
+constexpr uint32_t EMPTY_SLOT_OFFSET = 0xFFFFFFFFUL;
+constexpr size_t SLOT_BYTES = 8;
+constexpr size_t RECORD_HEADER_BYTES = 4;
+
+// ヘッダ内の各値の位置です。
+constexpr size_t MAGIC_OFFSET = 0;
+constexpr size_t VERSION_OFFSET = 4;
+constexpr size_t ENTRY_COUNT_OFFSET = 8;
+constexpr size_t SLOT_COUNT_OFFSET = 12;
+constexpr size_t SLOTS_OFFSET_OFFSET = 16;
+constexpr size_t RECORDS_OFFSET_OFFSET = 20;
+constexpr size_t IMAGE_BYTES_OFFSET = 24;
+constexpr size_t MAX_PROBE_COUNT_OFFSET = 28;
+
+/**
+ * バイト列の指定位置からリトルエンディアンの32bit値を読みます。
+ */
+uint32_t loadU32(const uint8_t* bytes) {
+  return static_cast<uint32_t>(bytes[0]) |
+    (static_cast<uint32_t>(bytes[1]) << 8) |
+    (static_cast<uint32_t>(bytes[2]) << 16) |
+    (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+}  // namespace
+
+/**
+ * イメージを参照していない状態で初期化します。
+ */
+CatalogIndex::CatalogIndex()
+: image_(nullptr),
+  imageBytes_(0),
+  entryCount_(0),
+  slotMask_(0),
+  slotsOffset_(0),
+  recordsOffset_(0),
+  maxProbeCount_(0) {
+}
+
+/**
+ * ヘッダの先頭部分から、イメージ全体のバイト数を返します。
+ */
+size_t CatalogIndex::readImageBytes(const uint8_t* header, const size_t length) {
+  if (header == nullptr || length < HEADER_BYTES) {
+    return 0;
+  }
+
+  const uint16_t version = static_cast<uint16_t>(header[VERSION_OFFSET] | (header[VERSION_OFFSET + 1] << 8));
+  if (loadU32(header + MAGIC_OFFSET) != CATALOG_MAGIC || version != CATALOG_VERSION) {
+    return 0;
+  }
+
+  return loadU32(header + IMAGE_BYTES_OFFSET);
+}
+
+/**
+ * イメージを参照し、ヘッダと索引の範囲を検証できたかを返します。
+ */
+bool CatalogIndex::attach(const uint8_t* image, const size_t length) {
+  detach();
+
+  const size_t imageBytes = readImageBytes(image, length);
+  if (imageBytes < HEADER_BYTES || imageBytes > length) {
+    return false;
+  }
+
+  const uint32_t entryCount = loadU32(image + ENTRY_COUNT_OFFSET);
+  const uint32_t slotCount = loadU32(image + SLOT_COUNT_OFFSET);
+  const uint32_t slotsOffset = loadU32(image + SLOTS_OFFSET_OFFSET);
+  const uint32_t recordsOffset = loadU32(image + RECORDS_OFFSET_OFFSET);
+  const uint32_t maxProbeCount = loadU32(image + MAX_PROBE_COUNT_OFFSET);
+
+  // 索引の大きさは2の累乗とし、ハッシュ値の下位ビットで位置を決めます。
+  const bool isSlotCountValid = slotCount != 0 && (slotCount & (slotCount - 1)) == 0;
+  if (
+    !isSlotCountValid ||
+    entryCount > slotCount ||
+    maxProbeCount > slotCount ||
+    slotsOffset < HEADER_BYTES ||
+    slotCount > (imageBytes - slotsOffset) / SLOT_BYTES ||
+    recordsOffset < slotsOffset + slotCount * SLOT_BYTES ||
+    recordsOffset > imageBytes
+  ) {
+    return false;
+  }
+
+  image_ = image;
+  imageBytes_ = imageBytes;
+  entryCount_ = entryCount;
+  slotMask_ = slotCount - 1;
+  slotsOffset_ = slotsOffset;
+  recordsOffset_ = recordsOffset;
+  maxProbeCount_ = maxProbeCount;
+  return true;
+}
+
+/**
+ * イメージの参照をやめます。
+ */
+void CatalogIndex::detach() {
+  image_ = nullptr;
+  imageBytes_ = 0;
+  entryCount_ = 0;
+  slotMask_ = 0;
+  slotsOffset_ = 0;
+  recordsOffset_ = 0;
+  maxProbeCount_ = 0;
+}
+
+/**
+ * イメージを参照しているかを返します。
+ */
+bool CatalogIndex::isAttached() const {
+  return image_ != nullptr;
+}
+
+/**
+ * 登録されている商品数を返します。
+ */
+size_t CatalogIndex::size() const {
+  return entryCount_;
+}
+
+/**
+ * コードに一致する商品を探し、見つかったかを返します。
+ * ※レコードはハッシュ値が一致した索引からだけ読み、範囲外を指す索引は不一致として扱います。
+ */
+bool CatalogIndex::find(const char* code, const size_t length, CatalogEntry& entryOut) const {
+  if (!isAttached() || length == 0 || length > UINT8_MAX) {
+    return false;
+  }
+
+  const uint32_t hash = fnv1a32Update(FNV1A32_OFFSET_BASIS, code, length);
+  for (uint32_t probe = 0; probe < maxProbeCount_; ++probe) {
+    const size_t slotOffset = slotsOffset_ + ((hash + probe) & slotMask_) * SLOT_BYTES;
+    const uint32_t recordOffset = readU32(slotOffset + 4);
+    if (recordOffset == EMPTY_SLOT_OFFSET) {
+      return false;
+    }
+
+    if (readU32(slotOffset) != hash) {
+      continue;
+    }
+
+    const size_t record = static_cast<size_t>(recordsOffset_) + recordOffset;
+    if (record > imageBytes_ || imageBytes_ - record < RECORD_HEADER_BYTES) {
+      continue;
+    }
+
+    const size_t codeLength = image_[record + 2];
+    const size_t nameLength = image_[record + 3];
+    const size_t codeStart = record + RECORD_HEADER_BYTES;
+    const size_t nameStart = codeStart + codeLength;
+    if (nameStart + nameLength >= imageBytes_ || image_[nameStart + nameLength] != '\0') {
+      continue;
+    }
+
+    if (codeLength != length || memcmp(image_ + codeStart, code, length) != 0) {
+      continue;
+    }
+
+    entryOut.name = reinterpret_cast<const char*>(image_ + nameStart);
+    entryOut.price = readU16(record);
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * イメージ内の指定位置からリトルエンディアンの値を読みます。
+ */
+uint32_t CatalogIndex::readU32(const size_t offset) const {
+  return loadU32(image_ + offset);
+}
+
+uint16_t CatalogIndex::readU16(const size_t offset) const {
+  return static_cast<uint16_t>(image_[offset] | (image_[offset + 1] << 8));
+}
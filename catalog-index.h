@@ -0,0 +1,79 @@
+#ifndef CATALOG_INDEX_H
+#define CATALOG_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 登録カタログで見つかった商品1件です。
+ * ※商品名はカタログのイメージ内の終端付き文字列を直接指します。
+ */
+struct CatalogEntry {
+  const char* name;
+  uint16_t price;
+};
+
+/**
+ * メモリ上に配置された登録カタログのイメージから、コードで商品を引きます。
+ * ※イメージは先頭のヘッダ、コードのハッシュ値で引く開番地法の索引、商品レコードの順に並びます。
+ *   索引はハッシュ値とレコード位置の組を線形探査で並べたもので、検索のたびに必要な範囲だけを読みます。
+ */
+class CatalogIndex {
+ public:
+  static constexpr size_t HEADER_BYTES = 32;
+
+  /**
+   * イメージを参照していない状態で初期化します。
+   */
+  CatalogIndex();
+
+  /**
+   * ヘッダの先頭部分から、イメージ全体のバイト数を返します。
+   * ※識別子か版が一致しない場合は0を返します。
+   */
+  static size_t readImageBytes(const uint8_t* header, size_t length);
+
+  /**
+   * イメージを参照し、ヘッダと索引の範囲を検証できたかを返します。
+   * ※イメージは参照している間、書き換えず保持してください。
+   */
+  bool attach(const uint8_t* image, size_t length);
+
+  /**
+   * イメージの参照をやめます。
+   */
+  void detach();
+
+  /**
+   * イメージを参照しているかを返します。
+   */
+  bool isAttached() const;
+
+  /**
+   * 登録されている商品数を返します。
+   */
+  size_t size() const;
+
+  /**
+   * コードに一致する商品を探し、見つかったかを返します。
+   * ※索引の探査回数はイメージ作成時に記録した最大値で打ち切ります。
+   */
+  bool find(const char* code, size_t length, CatalogEntry& entryOut) const;
+
+ private:
+  /**
+   * イメージ内の指定位置からリトルエンディアンの値を読みます。
+   */
+  uint32_t readU32(size_t offset) const;
+  uint16_t readU16(size_t offset) const;
+
+  const uint8_t* image_;
+  size_t imageBytes_;
+  uint32_t entryCount_;
+  uint32_t slotMask_;
+  uint32_t slotsOffset_;
+  uint32_t recordsOffset_;
+  uint32_t maxProbeCount_;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "catalog-partition.h"
+
+#include "catalog-index.h"
+#include "logger.h"
+
+/**
+ * 割り付けていない状態で初期化します。
+ */
+CatalogPartition::CatalogPartition()
+: data_(nullptr),
+  size_(0),
+  mapHandle_(),
+  isMapped_(false) {
+}
+
+/**
+ * 指定ラベルのパーティションからカタログのイメージを割り付け、成功したかを返します。
+ * ※割り付けはヘッダに記録したイメージの大きさだけに留め、キャッシュのページを使い過ぎないようにします。
+ */
+bool CatalogPartition::begin(const char* label) {
+  end();
+
+  const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if (partition == nullptr) {
+    LOG_INFO(BOOT, "catalog partition=%s missing", label);
+    return false;
+  }
+
+  uint8_t header[CatalogIndex::HEADER_BYTES];
+  esp_err_t result = esp_partition_read(partition, 0, header, sizeof(header));
+  if (result != ESP_OK) {
+    LOG_WARN(BOOT, "catalog header read failed err=%d", static_cast<int>(result));
+    return false;
+  }
+
+  const size_t imageBytes = CatalogIndex::readImageBytes(header, sizeof(header));
+  if (imageBytes == 0) {
+    LOG_INFO(BOOT, "catalog partition=%s empty", label);
+    return false;
+  }
+
+  if (imageBytes > partition->size) {
+    LOG_WARN(
+      BOOT,
+      "catalog image=%u exceeds partition=%u",
+      static_cast<unsigned>(imageBytes),
+      static_cast<unsigned>(partition->size)
+    );
+    return false;
+  }
+
+  const void* mapped = nullptr;
+  result = esp_partition_mmap(partition, 0, imageBytes, SPI_FLASH_MMAP_DATA, &mapped, &mapHandle_);
+  if (result != ESP_OK) {
+    LOG_WARN(BOOT, "catalog mmap failed err=%d", static_cast<int>(result));
+    return false;
+  }
+
+  data_ = static_cast<const uint8_t*>(mapped);
+  size_ = imageBytes;
+  isMapped_ = true;
+  return true;
+}
+
+/**
+ * 割り付けを解除します。
+ */
+void CatalogPartition::end() {
+  if (isMapped_) {
+    spi_flash_munmap(mapHandle_);
+  }
+
+  data_ = nullptr;
+  size_ = 0;
+  isMapped_ = false;
+}
+
+/**
+ * 割り付けたイメージの先頭を返します。
+ */
+const uint8_t* CatalogPartition::data() const {
+  return data_;
+}
+
+/**
+ * 割り付けたイメージのバイト数を返します。
+ */
+size_t CatalogPartition::size() const {
+  return size_;
+}
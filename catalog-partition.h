@@ -0,0 +1,48 @@
+#ifndef CATALOG_PARTITION_H
+#define CATALOG_PARTITION_H
+
+#include <esp_partition.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 登録カタログを書き込んだフラッシュのパーティションを、アドレス空間へ割り付けて読みます。
+ * ※割り付けた領域はフラッシュのキャッシュ越しに読むため、RAMへは読み込みません。
+ */
+class CatalogPartition {
+ public:
+  /**
+   * 割り付けていない状態で初期化します。
+   */
+  CatalogPartition();
+
+  /**
+   * 指定ラベルのパーティションからカタログのイメージを割り付け、成功したかを返します。
+   * ※ヘッダを読めない場合は割り付けず、消去済みのパーティションでも失敗として返します。
+   */
+  bool begin(const char* label);
+
+  /**
+   * 割り付けを解除します。
+   * ※解除後は、割り付け中に取り出した商品名を参照しないでください。
+   */
+  void end();
+
+  /**
+   * 割り付けたイメージの先頭を返します。
+   */
+  const uint8_t* data() const;
+
+  /**
+   * 割り付けたイメージのバイト数を返します。
+   */
+  size_t size() const;
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  spi_flash_mmap_handle_t mapHandle_;
+  bool isMapped_;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "checkout-record.h"
+
+#include <string.h>
+
+#include "product-catalog.h"
+
+namespace {
+
+// 記録の識別子 "CJ" です。消去済みのフラッシュ（0xFFFF）と区別できる値にします。
+constexpr uint16_t RECORD_MAGIC = 0x4A43;
+constexpr size_t RECORD_ALIGNMENT = 4;
+
+// 記録の先頭部分の各値の位置です。
+constexpr size_t MAGIC_OFFSET = 0;
+constexpr size_t BYTES_OFFSET = 2;
+constexpr size_t SEQUENCE_OFFSET = 4;
+constexpr size_t UNIX_TIME_OFFSET = 8;
+constexpr size_t UPTIME_OFFSET = 12;
+constexpr size_t TOTAL_OFFSET = 16;
+constexpr size_t ITEM_COUNT_OFFSET = 20;
+constexpr size_t UID_LENGTH_OFFSET = 22;
+constexpr size_t CHECKSUM_OFFSET = 24;
+
+/**
+ * リトルエンディアンの値を書き込みます。
+ */
+void storeU16(uint8_t* bytes, const uint16_t value) {
+  bytes[0] = static_cast<uint8_t>(value);
+  bytes[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void storeU32(uint8_t* bytes, const uint32_t value) {
+  storeU16(bytes, static_cast<uint16_t>(value));
+  storeU16(bytes + 2, static_cast<uint16_t>(value >> 16));
+}
+
+/**
+ * リトルエンディアンの値を読みます。
+ */
+uint16_t loadU16(const uint8_t* bytes) {
+  return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t loadU32(const uint8_t* bytes) {
+  return static_cast<uint32_t>(loadU16(bytes)) | (static_cast<uint32_t>(loadU16(bytes + 2)) << 16);
+}
+
+/**
+ * 検査値の欄を除いた記録全体のハッシュ値を返します。
+ */
+uint32_t computeChecksum(const uint8_t* bytes, const size_t recordBytes) {
+  const char* text = reinterpret_cast<const char*>(bytes);
+  const uint32_t headHash = fnv1a32Update(FNV1A32_OFFSET_BASIS, text, CHECKSUM_OFFSET);
+  return fnv1a32Update(headHash, text + CHECKOUT_RECORD_HEADER_BYTES, recordBytes - CHECKOUT_RECORD_HEADER_BYTES);
+}
+
+}  // namespace
+
+/**
+ * 決済1件をカートの明細ごとバイト列へ書き込み、書き込んだバイト数を返します。
+ */
+size_t encodeCheckoutRecord(
+  const CheckoutSummary& summary,
+  const RegisterCart& cart,
+  uint8_t* out,
+  const size_t capacity
+) {
+  const size_t uidLength = summary.uidLength < CHECKOUT_UID_CAPACITY ? summary.uidLength : CHECKOUT_UID_CAPACITY;
+  const size_t itemCount = cart.size();
+  const size_t usedBytes = CHECKOUT_RECORD_HEADER_BYTES + uidLength + itemCount * CHECKOUT_ITEM_BYTES;
+  const size_t recordBytes = (usedBytes + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+  if (out == nullptr || recordBytes > capacity) {
+    return 0;
+  }
+
+  storeU16(out + MAGIC_OFFSET, RECORD_MAGIC);
+  storeU16(out + BYTES_OFFSET, static_cast<uint16_t>(recordBytes));
+  storeU32(out + SEQUENCE_OFFSET, summary.sequence);
+  storeU32(out + UNIX_TIME_OFFSET, summary.unixTime);
+  storeU32(out + UPTIME_OFFSET, summary.uptimeMs);
+  storeU32(out + TOTAL_OFFSET, static_cast<uint32_t>(cart.getTotal()));
+  storeU16(out + ITEM_COUNT_OFFSET, static_cast<uint16_t>(itemCount));
+  out[UID_LENGTH_OFFSET] = static_cast<uint8_t>(uidLength);
+  out[UID_LENGTH_OFFSET + 1] = 0;
+
+  uint8_t* cursor = out + CHECKOUT_RECORD_HEADER_BYTES;
+  memcpy(cursor, summary.uid, uidLength);
+  cursor += uidLength;
+
+  for (size_t offset = itemCount; offset > 0; --offset) {
+    CartItem item;
+    cart.getNewest(offset - 1, item);
+    storeU16(cursor, item.price);
+    cursor[2] = item.nameIndex;
+    cursor[3] = 0;
+    cursor += CHECKOUT_ITEM_BYTES;
+  }
+  memset(cursor, 0, recordBytes - usedBytes);
+
+  storeU32(out + CHECKSUM_OFFSET, computeChecksum(out, recordBytes));
+  return recordBytes;
+}
+
+/**
+ * バイト列の先頭が消去済みのフラッシュ（記録なし）かを返します。
+ */
+bool isErasedCheckoutRecord(const uint8_t* bytes, const size_t available) {
+  return available < CHECKOUT_RECORD_HEADER_BYTES || loadU16(bytes + MAGIC_OFFSET) == 0xFFFF;
+}
+
+/**
+ * バイト列の先頭から決済1件を読み出し、識別子・長さ・検査値が正しいかを返します。
+ */
+bool decodeCheckoutRecord(const uint8_t* bytes, const size_t available, CheckoutRecordView& recordOut) {
+  if (available < CHECKOUT_RECORD_HEADER_BYTES || loadU16(bytes + MAGIC_OFFSET) != RECORD_MAGIC) {
+    return false;
+  }
+
+  const size_t recordBytes = loadU16(bytes + BYTES_OFFSET);
+  const size_t itemCount = loadU16(bytes + ITEM_COUNT_OFFSET);
+  const size_t uidLength = bytes[UID_LENGTH_OFFSET];
+  const size_t usedBytes = CHECKOUT_RECORD_HEADER_BYTES + uidLength + itemCount * CHECKOUT_ITEM_BYTES;
+  if (
+    recordBytes > available ||
+    recordBytes > CHECKOUT_RECORD_MAX_BYTES ||
+    recordBytes % RECORD_ALIGNMENT != 0 ||
+    usedBytes > recordBytes ||
+    uidLength > CHECKOUT_UID_CAPACITY
+  ) {
+    return false;
+  }
+
+  if (loadU32(bytes + CHECKSUM_OFFSET) != computeChecksum(bytes, recordBytes)) {
+    return false;
+  }
+
+  recordOut.sequence = loadU32(bytes + SEQUENCE_OFFSET);
+  recordOut.unixTime = loadU32(bytes + UNIX_TIME_OFFSET);
+  recordOut.uptimeMs = loadU32(bytes + UPTIME_OFFSET);
+  recordOut.total = loadU32(bytes + TOTAL_OFFSET);
+  recordOut.uid = reinterpret_cast<const char*>(bytes + CHECKOUT_RECORD_HEADER_BYTES);
+  recordOut.uidLength = uidLength;
+  recordOut.items = bytes + CHECKOUT_RECORD_HEADER_BYTES + uidLength;
+  recordOut.itemCount = itemCount;
+  recordOut.recordBytes = recordBytes;
+  return true;
+}
+
+/**
+ * 読み出した記録から指定位置の明細を取り出します。
+ */
+void getCheckoutItem(
+  const CheckoutRecordView& record,
+  const size_t index,
+  uint8_t& nameIndexOut,
+  uint16_t& priceOut
+) {
+  const uint8_t* item = record.items + index * CHECKOUT_ITEM_BYTES;
+  priceOut = loadU16(item);
+  nameIndexOut = item[2];
+}
@@ -0,0 +1,71 @@
+#ifndef CHECKOUT_RECORD_H
+#define CHECKOUT_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "register-cart.h"
+
+/**
+ * 決済1件の記録に付ける識別情報です。
+ */
+struct CheckoutSummary {
+  uint32_t sequence;
+  uint32_t unixTime;
+  uint32_t uptimeMs;
+  const char* uid;
+  size_t uidLength;
+};
+
+/**
+ * バイト列から読み出した決済1件の記録です。
+ * ※uidと明細は読み出し元のバイト列を直接指します。
+ */
+struct CheckoutRecordView {
+  uint32_t sequence;
+  uint32_t unixTime;
+  uint32_t uptimeMs;
+  uint32_t total;
+  const char* uid;
+  size_t uidLength;
+  const uint8_t* items;
+  size_t itemCount;
+  size_t recordBytes;
+};
+
+/**
+ * 記録に保持するUID文字列の最大長です。
+ */
+static constexpr size_t CHECKOUT_UID_CAPACITY = 32;
+
+/**
+ * 記録1件の最大バイト数です。
+ */
+static constexpr size_t CHECKOUT_RECORD_HEADER_BYTES = 28;
+static constexpr size_t CHECKOUT_ITEM_BYTES = 4;
+static constexpr size_t CHECKOUT_RECORD_MAX_BYTES =
+  CHECKOUT_RECORD_HEADER_BYTES + CHECKOUT_UID_CAPACITY + RegisterCart::CAPACITY * CHECKOUT_ITEM_BYTES;
+
+/**
+ * 決済1件をカートの明細ごとバイト列へ書き込み、書き込んだバイト数を返します。
+ * ※明細は古い順に並べ、末尾を4バイト境界まで詰めます。容量が足りない場合は0を返します。
+ */
+size_t encodeCheckoutRecord(const CheckoutSummary& summary, const RegisterCart& cart, uint8_t* out, size_t capacity);
+
+/**
+ * バイト列の先頭が消去済みのフラッシュ（記録なし）かを返します。
+ */
+bool isErasedCheckoutRecord(const uint8_t* bytes, size_t available);
+
+/**
+ * バイト列の先頭から決済1件を読み出し、識別子・長さ・検査値が正しいかを返します。
+ */
+bool decodeCheckoutRecord(const uint8_t* bytes, size_t available, CheckoutRecordView& recordOut);
+
+/**
+ * 読み出した記録から指定位置の明細を取り出します。
+ * ※商品名は保持しないため、nameIndexと価格だけを返します。
+ */
+void getCheckoutItem(const CheckoutRecordView& record, size_t index, uint8_t& nameIndexOut, uint16_t& priceOut);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef CORE_INTERFACES_H
+#define CORE_INTERFACES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 受信済みのバイト列を取り出す入力元です。
+ * ※ハードウェアに依存しない処理から、UARTやUSBシリアルを読むために使います。
+ */
+class ByteStream {
+ public:
+  virtual ~ByteStream() {}
+
+  /**
+   * 待たずに読み出せるバイト数を返します。
+   */
+  virtual int available() = 0;
+
+  /**
+   * 最大lengthバイトを読み出し、読み出したバイト数を返します。
+   */
+  virtual size_t readBytes(uint8_t* buffer, size_t length) = 0;
+};
+
+/**
+ * 単調増加する経過時間の取得元です。
+ */
+class MonotonicClock {
+ public:
+  virtual ~MonotonicClock() {}
+
+  /**
+   * 経過時間をミリ秒で返します。
+   */
+  virtual uint32_t getMillis() const = 0;
+
+  /**
+   * 経過時間をマイクロ秒で返します。
+   */
+  virtual uint32_t getMicros() const = 0;
+};
+
+/**
+ * 文字列の表示幅を測る描画先です。
+ */
+class TextMetrics {
+ public:
+  virtual ~TextMetrics() {}
+
+  /**
+   * 現在のフォントでの文字列の表示幅を返します。
+   */
+  virtual int measureTextWidth(const char* text) = 0;
+
+  /**
+   * 現在のフォントを識別する値を返します。
+   * ※計測結果をフォントごとに使い分けるために使います。
+   */
+  virtual const void* getFontKey() const = 0;
+};
+
+#endif
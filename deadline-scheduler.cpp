@@ -0,0 +1,167 @@
+#include "deadline-scheduler.h"
+
+namespace {
+
+/**
+ * millisの桁あふれを跨いでも、期限に達したかを判定します。
+ */
+bool hasReached(const uint32_t nowMs, const uint32_t dueAtMs) {
+  return static_cast<int32_t>(nowMs - dueAtMs) >= 0;
+}
+
+}  // namespace
+
+/**
+ * 空のジョブ表で初期化します。
+ */
+DeadlineScheduler::DeadlineScheduler()
+: jobs_(),
+  nextJobId_(INVALID_JOB_ID + 1) {
+}
+
+/**
+ * 指定周期で繰り返すジョブを登録し、ジョブIDを返します。
+ */
+uint32_t DeadlineScheduler::schedulePeriodic(
+  const uint32_t nowMs,
+  const uint32_t periodMs,
+  const Callback callback,
+  void* context
+) {
+  if (periodMs == 0) {
+    return INVALID_JOB_ID;
+  }
+
+  return schedule(nowMs + periodMs, periodMs, callback, context);
+}
+
+/**
+ * 指定時間後に1回だけ実行するジョブを登録し、ジョブIDを返します。
+ */
+uint32_t DeadlineScheduler::scheduleOnce(
+  const uint32_t nowMs,
+  const uint32_t delayMs,
+  const Callback callback,
+  void* context
+) {
+  return schedule(nowMs + delayMs, 0, callback, context);
+}
+
+/**
+ * ジョブを取り消し、保持していたジョブIDをINVALID_JOB_IDへ戻します。
+ */
+void DeadlineScheduler::cancel(uint32_t& jobId) {
+  if (jobId == INVALID_JOB_ID) {
+    return;
+  }
+
+  for (size_t index = 0; index < JOB_CAPACITY; ++index) {
+    if (jobs_[index].id == jobId) {
+      jobs_[index].id = INVALID_JOB_ID;
+      break;
+    }
+  }
+
+  jobId = INVALID_JOB_ID;
+}
+
+/**
+ * 指定したジョブが実行待ちかを返します。
+ */
+bool DeadlineScheduler::isScheduled(const uint32_t jobId) const {
+  if (jobId == INVALID_JOB_ID) {
+    return false;
+  }
+
+  for (size_t index = 0; index < JOB_CAPACITY; ++index) {
+    if (jobs_[index].id == jobId) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * 期限に達したジョブを実行します。
+ * ※ジョブの中から登録や取り消しをしても構いません。
+ */
+void DeadlineScheduler::runDue(const uint32_t nowMs) {
+  for (size_t index = 0; index < JOB_CAPACITY; ++index) {
+    Job& job = jobs_[index];
+    if (job.id == INVALID_JOB_ID || !hasReached(nowMs, job.dueAtMs)) {
+      continue;
+    }
+
+    const Callback callback = job.callback;
+    void* context = job.context;
+
+    if (job.periodMs == 0) {
+      job.id = INVALID_JOB_ID;
+    } else {
+      // 処理が遅れて周期を丸ごと逃した場合は、溜まった回数をまとめて実行せず次の周期へ進めます。
+      job.dueAtMs += job.periodMs;
+      if (hasReached(nowMs, job.dueAtMs)) {
+        job.dueAtMs = nowMs + job.periodMs;
+      }
+    }
+
+    callback(context);
+  }
+}
+
+/**
+ * 最も近い期限までの待ち時間を返します。
+ */
+uint32_t DeadlineScheduler::getWaitMs(const uint32_t nowMs, const uint32_t maxWaitMs) const {
+  uint32_t waitMs = maxWaitMs;
+
+  for (size_t index = 0; index < JOB_CAPACITY; ++index) {
+    const Job& job = jobs_[index];
+    if (job.id == INVALID_JOB_ID) {
+      continue;
+    }
+
+    if (hasReached(nowMs, job.dueAtMs)) {
+      return 0;
+    }
+
+    const uint32_t remainingMs = job.dueAtMs - nowMs;
+    if (remainingMs < waitMs) {
+      waitMs = remainingMs;
+    }
+  }
+
+  return waitMs;
+}
+
+/**
+ * 空いているジョブ枠へ登録し、ジョブIDを返します。
+ */
+uint32_t DeadlineScheduler::schedule(
+  const uint32_t dueAtMs,
+  const uint32_t periodMs,
+  const Callback callback,
+  void* context
+) {
+  for (size_t index = 0; index < JOB_CAPACITY; ++index) {
+    Job& job = jobs_[index];
+    if (job.id != INVALID_JOB_ID) {
+      continue;
+    }
+
+    job.id = nextJobId_;
+    job.dueAtMs = dueAtMs;
+    job.periodMs = periodMs;
+    job.callback = callback;
+    job.context = context;
+
+    ++nextJobId_;
+    if (nextJobId_ == INVALID_JOB_ID) {
+      ++nextJobId_;
+    }
+    return job.id;
+  }
+
+  return INVALID_JOB_ID;
+}
@@ -0,0 +1,82 @@
+#ifndef DEADLINE_SCHEDULER_H
+#define DEADLINE_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 周期ジョブと1回限りのタイムアウトを期限順に実行します。
+ * ※画面処理タスクからのみ呼び出します。ジョブ表は固定長で、登録時に確保しません。
+ */
+class DeadlineScheduler {
+ public:
+  /**
+   * ジョブとして呼び出す関数です。
+   */
+  using Callback = void (*)(void* context);
+
+  static constexpr uint32_t INVALID_JOB_ID = 0;
+
+  /**
+   * 空のジョブ表で初期化します。
+   */
+  DeadlineScheduler();
+
+  /**
+   * 指定周期で繰り返すジョブを登録し、ジョブIDを返します。
+   * ※初回は登録から1周期後に実行します。空きがない場合はINVALID_JOB_IDを返します。
+   */
+  uint32_t schedulePeriodic(uint32_t nowMs, uint32_t periodMs, Callback callback, void* context);
+
+  /**
+   * 指定時間後に1回だけ実行するジョブを登録し、ジョブIDを返します。
+   * ※空きがない場合はINVALID_JOB_IDを返します。
+   */
+  uint32_t scheduleOnce(uint32_t nowMs, uint32_t delayMs, Callback callback, void* context);
+
+  /**
+   * ジョブを取り消し、保持していたジョブIDをINVALID_JOB_IDへ戻します。
+   * ※実行済みの1回限りのジョブや取り消し済みのIDを渡しても何もしません。
+   */
+  void cancel(uint32_t& jobId);
+
+  /**
+   * 指定したジョブが実行待ちかを返します。
+   */
+  bool isScheduled(uint32_t jobId) const;
+
+  /**
+   * 期限に達したジョブを実行します。
+   */
+  void runDue(uint32_t nowMs);
+
+  /**
+   * 最も近い期限までの待ち時間を返します。
+   * ※ジョブがない場合や期限が遠い場合はmaxWaitMsを返します。
+   */
+  uint32_t getWaitMs(uint32_t nowMs, uint32_t maxWaitMs) const;
+
+ private:
+  /**
+   * 登録済みジョブ1件です。
+   */
+  struct Job {
+    uint32_t id;
+    uint32_t dueAtMs;
+    uint32_t periodMs;
+    Callback callback;
+    void* context;
+  };
+
+  /**
+   * 空いているジョブ枠へ登録し、ジョブIDを返します。
+   */
+  uint32_t schedule(uint32_t dueAtMs, uint32_t periodMs, Callback callback, void* context);
+
+  static constexpr size_t JOB_CAPACITY = 8;
+
+  Job jobs_[JOB_CAPACITY];
+  uint32_t nextJobId_;
+};
+
+#endif
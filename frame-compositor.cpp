@@ -0,0 +1,290 @@
+#include "frame-compositor.h"
+
+#include <esp_heap_caps.h>
+#include <freertos/semphr.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr bool ENABLE_FRAME_COMPOSITOR = true;
+constexpr int CANVAS_COLOR_DEPTH = 16;
+// 静的な画面を一度だけ描いてPSRAMへ保存し、以降は1回のDMA転送で表示します。
+constexpr bool ENABLE_SCREEN_CACHE = true;
+
+}  // namespace
+
+/**
+ * 画面合成を初期化します。
+ */
+FrameCompositor::FrameCompositor()
+: canvas_(&M5.Display),
+  cachedScreens_(),
+  busMutex_(nullptr),
+  isEnabled_(false),
+  isTransferPending_(false) {
+}
+
+/**
+ * オフスクリーン画面を確保し、合成描画を使えるかを返します。
+ */
+bool FrameCompositor::begin() {
+  if (busMutex_ == nullptr) {
+    busMutex_ = xSemaphoreCreateMutex();
+  }
+
+  if (!ENABLE_FRAME_COMPOSITOR) {
+    isEnabled_ = false;
+    return false;
+  }
+
+  if (isEnabled_) {
+    return true;
+  }
+
+  canvas_.setColorDepth(CANVAS_COLOR_DEPTH);
+  canvas_.setPsram(true);
+  isEnabled_ = canvas_.createSprite(M5.Display.width(), M5.Display.height()) != nullptr;
+  return isEnabled_;
+}
+
+/**
+ * 合成描画が有効かを返します。
+ */
+bool FrameCompositor::isEnabled() const {
+  return isEnabled_;
+}
+
+/**
+ * 描画先を返します。
+ * ※転送中のDMAがあれば完了を待ってから返します。合成描画が無効な場合は画面をそのまま返し、SPIバスは占有しません。
+ */
+LovyanGFX& FrameCompositor::surface() {
+  if (!isEnabled_) {
+    return M5.Display;
+  }
+
+  waitForTransfer();
+  return canvas_;
+}
+
+/**
+ * オフスクリーン画面全体を画面へ転送します。
+ */
+void FrameCompositor::present() {
+  presentRows(0, canvas_.height());
+}
+
+/**
+ * 指定した行範囲を画面へ転送します。
+ */
+void FrameCompositor::presentRows(const int y, const int h) {
+  if (!isEnabled_) {
+    return;
+  }
+
+  const int width = canvas_.width();
+  const int top = std::max(y, 0);
+  const int bottom = std::min(y + h, static_cast<int>(canvas_.height()));
+  if (bottom <= top) {
+    return;
+  }
+
+  // 行全体を転送するとバッファ上で連続するため、1回のDMAで送れます。
+  waitForTransfer();
+  const lgfx::swap565_t* pixels = static_cast<const lgfx::swap565_t*>(canvas_.getBuffer());
+  beginTransfer();
+  M5.Display.pushImageDMA(0, top, width, bottom - top, pixels + top * width);
+  isTransferPending_ = true;
+}
+
+/**
+ * 外部のRGB565画像をDMAで直接画面へ転送し、完了まで待ちます。
+ */
+void FrameCompositor::presentImage(
+  const int x,
+  const int y,
+  const int w,
+  const int h,
+  const uint16_t* pixels
+) {
+  presentImageAsync(x, y, w, h, pixels);
+  waitForTransfer();
+}
+
+/**
+ * 外部のRGB565画像のDMA転送を開始し、完了を待たずに戻ります。
+ * ※転送完了までpixelsを解放しないでください。
+ */
+void FrameCompositor::presentImageAsync(
+  const int x,
+  const int y,
+  const int w,
+  const int h,
+  const uint16_t* pixels
+) {
+  waitForTransfer();
+  beginTransfer();
+  M5.Display.pushImageDMA(x, y, w, h, pixels);
+  isTransferPending_ = true;
+}
+
+/**
+ * オフスクリーン画面の内容を指定番号の画面としてPSRAMへ保存し、保存できたかを返します。
+ * ※保存先は初回に確保し、確保できない場合は保存せずに毎回描画します。
+ */
+bool FrameCompositor::cacheScreen(const size_t slot) {
+  if (!ENABLE_SCREEN_CACHE || !isEnabled_ || slot >= SCREEN_CACHE_CAPACITY) {
+    return false;
+  }
+
+  const size_t frameBytes = getFrameBytes();
+  if (cachedScreens_[slot] == nullptr) {
+    cachedScreens_[slot] = static_cast<lgfx::swap565_t*>(
+      heap_caps_malloc(frameBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+    );
+    if (cachedScreens_[slot] == nullptr) {
+      return false;
+    }
+  }
+
+  memcpy(cachedScreens_[slot], canvas_.getBuffer(), frameBytes);
+  return true;
+}
+
+/**
+ * 指定番号の画面を保存済みかを返します。
+ */
+bool FrameCompositor::hasCachedScreen(const size_t slot) const {
+  return isEnabled_ && slot < SCREEN_CACHE_CAPACITY && cachedScreens_[slot] != nullptr;
+}
+
+/**
+ * 保存済みの画面をDMAで画面へ転送し、転送中にオフスクリーン画面へ書き戻します。
+ * ※転送元は保存先のため、転送中に書き戻してもオフスクリーン画面との競合はありません。
+ */
+bool FrameCompositor::presentCachedScreen(const size_t slot) {
+  if (!hasCachedScreen(slot)) {
+    return false;
+  }
+
+  waitForTransfer();
+  beginTransfer();
+  M5.Display.pushImageDMA(0, 0, canvas_.width(), canvas_.height(), cachedScreens_[slot]);
+  isTransferPending_ = true;
+
+  memcpy(canvas_.getBuffer(), cachedScreens_[slot], getFrameBytes());
+  return true;
+}
+
+/**
+ * 保存済みの画面をオフスクリーン画面へ書き戻し、書き戻せたかを返します。
+ */
+bool FrameCompositor::restoreCachedScreen(const size_t slot) {
+  if (!hasCachedScreen(slot)) {
+    return false;
+  }
+
+  waitForTransfer();
+  memcpy(canvas_.getBuffer(), cachedScreens_[slot], getFrameBytes());
+  return true;
+}
+
+/**
+ * 保存済みの画面のうち指定矩形だけをオフスクリーン画面へ書き戻し、書き戻せたかを返します。
+ */
+bool FrameCompositor::restoreCachedRect(const size_t slot, const int x, const int y, const int w, const int h) {
+  if (!hasCachedScreen(slot)) {
+    return false;
+  }
+
+  const int width = canvas_.width();
+  const int left = std::max(x, 0);
+  const int top = std::max(y, 0);
+  const int right = std::min(x + w, width);
+  const int bottom = std::min(y + h, static_cast<int>(canvas_.height()));
+  if (right <= left || bottom <= top) {
+    return true;
+  }
+
+  waitForTransfer();
+  lgfx::swap565_t* pixels = static_cast<lgfx::swap565_t*>(canvas_.getBuffer());
+  const size_t rowBytes = static_cast<size_t>(right - left) * sizeof(lgfx::swap565_t);
+  for (int row = top; row < bottom; ++row) {
+    const size_t offset = static_cast<size_t>(row) * width + left;
+    memcpy(pixels + offset, cachedScreens_[slot] + offset, rowBytes);
+  }
+  return true;
+}
+
+/**
+ * 転送中のDMAがないかを返します。
+ */
+bool FrameCompositor::isTransferComplete() const {
+  return !isTransferPending_ || !M5.Display.dmaBusy();
+}
+
+/**
+ * 転送中のDMAの完了を待ちます。
+ */
+void FrameCompositor::waitForTransfer() {
+  if (!isTransferPending_) {
+    return;
+  }
+
+  M5.Display.waitDMA();
+  M5.Display.endWrite();
+  isTransferPending_ = false;
+  unlockBus();
+}
+
+/**
+ * 転送を開始したまま終えていないかを返します。
+ */
+bool FrameCompositor::isTransferPending() const {
+  return isTransferPending_;
+}
+
+/**
+ * DMAが完了していれば転送を終え、SPIバスを解放します。
+ */
+void FrameCompositor::finishCompletedTransfer() {
+  if (isTransferPending_ && !M5.Display.dmaBusy()) {
+    waitForTransfer();
+  }
+}
+
+/**
+ * 画面とSPIバスを共有する周辺機器を使う前にバスを占有します。
+ */
+void FrameCompositor::lockBus() {
+  if (busMutex_ != nullptr) {
+    xSemaphoreTake(busMutex_, portMAX_DELAY);
+  }
+}
+
+/**
+ * SPIバスの占有を解除します。
+ */
+void FrameCompositor::unlockBus() {
+  if (busMutex_ != nullptr) {
+    xSemaphoreGive(busMutex_);
+  }
+}
+
+/**
+ * SPIバスを占有して画面への書き込みを開始します。
+ * ※占有はwaitForTransferで転送を終えるときに解除します。
+ */
+void FrameCompositor::beginTransfer() {
+  lockBus();
+  M5.Display.startWrite();
+}
+
+/**
+ * オフスクリーン画面1枚分のバイト数を返します。
+ */
+size_t FrameCompositor::getFrameBytes() const {
+  return static_cast<size_t>(canvas_.width()) * canvas_.height() * sizeof(lgfx::swap565_t);
+}
@@ -0,0 +1,137 @@
+#ifndef FRAME_COMPOSITOR_H
+#define FRAME_COMPOSITOR_H
+
+#include <M5Unified.h>
+#include <freertos/semphr.h>
+
+/**
+ * PSRAM上のオフスクリーン画面で描画し、DMAで画面へ転送します。
+ */
+class FrameCompositor {
+ public:
+  /**
+   * 保存しておける画面の数です。
+   */
+  static constexpr size_t SCREEN_CACHE_CAPACITY = 4;
+
+  /**
+   * 画面合成を初期化します。
+   */
+  FrameCompositor();
+
+  /**
+   * オフスクリーン画面を確保し、合成描画を使えるかを返します。
+   */
+  bool begin();
+
+  /**
+   * 合成描画が有効かを返します。
+   */
+  bool isEnabled() const;
+
+  /**
+   * 描画先を返します。
+   * ※転送中のDMAがあれば完了を待ってから返します。合成描画が無効な場合は画面をそのまま返し、SPIバスは占有しません。
+   */
+  LovyanGFX& surface();
+
+  /**
+   * オフスクリーン画面全体を画面へ転送します。
+   */
+  void present();
+
+  /**
+   * 指定した行範囲を画面へ転送します。
+   */
+  void presentRows(int y, int h);
+
+  /**
+   * 外部のRGB565画像をDMAで直接画面へ転送し、完了まで待ちます。
+   */
+  void presentImage(int x, int y, int w, int h, const uint16_t* pixels);
+
+  /**
+   * 外部のRGB565画像のDMA転送を開始し、完了を待たずに戻ります。
+   * ※転送完了までpixelsを解放しないでください。
+   */
+  void presentImageAsync(int x, int y, int w, int h, const uint16_t* pixels);
+
+  /**
+   * オフスクリーン画面の内容を指定番号の画面としてPSRAMへ保存し、保存できたかを返します。
+   * ※同じ番号へ再度保存すると上書きします。
+   */
+  bool cacheScreen(size_t slot);
+
+  /**
+   * 指定番号の画面を保存済みかを返します。
+   */
+  bool hasCachedScreen(size_t slot) const;
+
+  /**
+   * 保存済みの画面をDMAで画面へ転送し、転送中にオフスクリーン画面へ書き戻します。
+   * ※保存していない場合は何もせずfalseを返します。
+   */
+  bool presentCachedScreen(size_t slot);
+
+  /**
+   * 保存済みの画面をオフスクリーン画面へ書き戻し、書き戻せたかを返します。
+   * ※画面へは転送しません。続けて動的な要素を描いてから転送します。
+   */
+  bool restoreCachedScreen(size_t slot);
+
+  /**
+   * 保存済みの画面のうち指定矩形だけをオフスクリーン画面へ書き戻し、書き戻せたかを返します。
+   */
+  bool restoreCachedRect(size_t slot, int x, int y, int w, int h);
+
+  /**
+   * 転送中のDMAがないかを返します。
+   */
+  bool isTransferComplete() const;
+
+  /**
+   * 転送中のDMAの完了を待ちます。
+   */
+  void waitForTransfer();
+
+  /**
+   * 転送を開始したまま終えていないかを返します。
+   */
+  bool isTransferPending() const;
+
+  /**
+   * DMAが完了していれば転送を終え、SPIバスを解放します。
+   * ※画面処理タスクの各周回の終わりに呼び出し、他タスクのバス待ちを短くします。
+   */
+  void finishCompletedTransfer();
+
+  /**
+   * 画面とSPIバスを共有する周辺機器を使う前にバスを占有します。
+   * ※画面への転送中は、転送を終えるまで待ちます。
+   */
+  void lockBus();
+
+  /**
+   * SPIバスの占有を解除します。
+   */
+  void unlockBus();
+
+ private:
+  /**
+   * SPIバスを占有して画面への書き込みを開始します。
+   */
+  void beginTransfer();
+
+  /**
+   * オフスクリーン画面1枚分のバイト数を返します。
+   */
+  size_t getFrameBytes() const;
+
+  M5Canvas canvas_;
+  lgfx::swap565_t* cachedScreens_[SCREEN_CACHE_CAPACITY];
+  SemaphoreHandle_t busMutex_;
+  bool isEnabled_;
+  bool isTransferPending_;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "frame-reader.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+/**
+ * 無通信時間の判定に使う時計を指定して、空のフレームバッファを初期化します。
+ */
+FrameReader::FrameReader(const MonotonicClock& clock)
+: clock_(clock),
+  ring_(),
+  frame_(),
+  chunk_(),
+  ringStart_(0),
+  ringLength_(0),
+  chunkIndex_(0),
+  chunkLength_(0),
+  lastByteAtMs_(0),
+  firstByteAtUs_(0) {
+}
+
+/**
+ * ストリームから1フレームを読み取ります。
+ */
+bool FrameReader::read(ByteStream& stream, FrameView& frameOut, const uint32_t frameGapMs) {
+  while (true) {
+    if (chunkIndex_ >= chunkLength_) {
+      const int available = stream.available();
+      if (available <= 0) {
+        break;
+      }
+
+      // 受信済みの範囲だけをまとめて取り出すため、readBytesが待たされることはありません。
+      const size_t requestLength = std::min(static_cast<size_t>(available), CHUNK_SIZE);
+      chunkLength_ = stream.readBytes(chunk_, requestLength);
+      chunkIndex_ = 0;
+      lastByteAtMs_ = clock_.getMillis();
+      if (chunkLength_ == 0) {
+        break;
+      }
+    }
+
+    const char ch = static_cast<char>(chunk_[chunkIndex_]);
+    ++chunkIndex_;
+
+    if (ch == '\r' || ch == '\n') {
+      if (ringLength_ == 0) {
+        continue;
+      }
+      takeFrame(frameOut);
+      return true;
+    }
+
+    if (ch >= 0x20 && ch <= 0x7E) {
+      appendCharacter(ch);
+    }
+  }
+
+  if (frameGapMs > 0 && ringLength_ > 0 && clock_.getMillis() - lastByteAtMs_ >= frameGapMs) {
+    takeFrame(frameOut);
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * 組み立て中のフレームがあれば区切りを待たずに取り出します。
+ */
+bool FrameReader::takePendingFrame(FrameView& frameOut) {
+  if (ringLength_ == 0) {
+    return false;
+  }
+
+  takeFrame(frameOut);
+  return true;
+}
+
+/**
+ * 組み立て中のフレームと読み込み済みの未処理データを破棄します。
+ */
+void FrameReader::clear() {
+  ringStart_ = 0;
+  ringLength_ = 0;
+  chunkIndex_ = 0;
+  chunkLength_ = 0;
+  lastByteAtMs_ = 0;
+  firstByteAtUs_ = 0;
+}
+
+/**
+ * 文字を末尾へ追加し、上限長を超えた分は先頭から破棄します。
+ */
+void FrameReader::appendCharacter(const char ch) {
+  if (ringLength_ == 0) {
+    firstByteAtUs_ = clock_.getMicros();
+  }
+
+  if (ringLength_ < FRAME_BUFFER_MAX_LENGTH) {
+    ring_[(ringStart_ + ringLength_) % FRAME_BUFFER_MAX_LENGTH] = ch;
+    ++ringLength_;
+    return;
+  }
+
+  ring_[ringStart_] = ch;
+  ringStart_ = (ringStart_ + 1) % FRAME_BUFFER_MAX_LENGTH;
+}
+
+/**
+ * 組み立て中のフレームを連続領域へ並べ直して取り出します。
+ */
+void FrameReader::takeFrame(FrameView& frameOut) {
+  const size_t firstLength = std::min(ringLength_, FRAME_BUFFER_MAX_LENGTH - ringStart_);
+  memcpy(frame_, ring_ + ringStart_, firstLength);
+  memcpy(frame_ + firstLength, ring_, ringLength_ - firstLength);
+  frame_[ringLength_] = '\0';
+
+  frameOut = FrameView{frame_, ringLength_, firstByteAtUs_};
+  ringStart_ = 0;
+  ringLength_ = 0;
+}
@@ -0,0 +1,71 @@
+#ifndef FRAME_READER_H
+#define FRAME_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core-interfaces.h"
+
+/**
+ * 受信済みフレームの参照を保持します。
+ * ※次にFrameReaderを操作するまで有効です。
+ */
+struct FrameView {
+  const char* data;
+  size_t length;
+  uint32_t firstByteAtUs;
+};
+
+/**
+ * ストリームから改行または無通信時間で区切られたフレームを固定長バッファで組み立てます。
+ */
+class FrameReader {
+ public:
+  static constexpr size_t FRAME_BUFFER_MAX_LENGTH = 128;
+
+  /**
+   * 無通信時間の判定に使う時計を指定して、空のフレームバッファを初期化します。
+   */
+  explicit FrameReader(const MonotonicClock& clock);
+
+  /**
+   * ストリームから1フレームを読み取ります。
+   */
+  bool read(ByteStream& stream, FrameView& frameOut, uint32_t frameGapMs);
+
+  /**
+   * 組み立て中のフレームがあれば区切りを待たずに取り出します。
+   */
+  bool takePendingFrame(FrameView& frameOut);
+
+  /**
+   * 組み立て中のフレームと読み込み済みの未処理データを破棄します。
+   */
+  void clear();
+
+ private:
+  static constexpr size_t CHUNK_SIZE = 64;
+
+  /**
+   * 文字を末尾へ追加し、上限長を超えた分は先頭から破棄します。
+   */
+  void appendCharacter(char ch);
+
+  /**
+   * 組み立て中のフレームを連続領域へ並べ直して取り出します。
+   */
+  void takeFrame(FrameView& frameOut);
+
+  const MonotonicClock& clock_;
+  char ring_[FRAME_BUFFER_MAX_LENGTH];
+  char frame_[FRAME_BUFFER_MAX_LENGTH + 1];
+  uint8_t chunk_[CHUNK_SIZE];
+  size_t ringStart_;
+  size_t ringLength_;
+  size_t chunkIndex_;
+  size_t chunkLength_;
+  uint32_t lastByteAtMs_;
+  uint32_t firstByteAtUs_;
+};
+
+#endif
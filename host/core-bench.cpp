@@ -0,0 +1,119 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "host-fakes.h"
+#include "input-text.h"
+#include "latency-histogram.h"
+#include "product-catalog.h"
+#include "register-cart.h"
+#include "text-fit-cache.h"
+
+namespace {
+
+constexpr uint32_t DEFAULT_ITERATIONS = 1000000;
+constexpr size_t BENCH_CODE_COUNT = 64;
+constexpr size_t BENCH_CODE_LENGTH = 13;
+constexpr int ROW_NAME_MAX_WIDTH = 150;
+
+// 測定対象の結果を畳み込み、最適化で処理ごと消されないようにします。
+volatile uint32_t benchSink = 0;
+
+/**
+ * 1件の測定を実行し、1回あたりの所要時間をCSVの1行として出力します。
+ */
+template <typename Body>
+void runBench(const char* name, const uint32_t iterations, Body body) {
+  const auto startedAt = std::chrono::steady_clock::now();
+  for (uint32_t index = 0; index < iterations; ++index) {
+    body(index);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - startedAt;
+  const double elapsedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  printf("%s,%u,%.1f\n", name, static_cast<unsigned>(iterations), elapsedNs / iterations);
+}
+
+/**
+ * JANコードに似た13桁の数字列を並べます。
+ */
+void fillBenchCodes(char (&codes)[BENCH_CODE_COUNT][BENCH_CODE_LENGTH + 1]) {
+  uint32_t state = 12345;
+  for (size_t codeIndex = 0; codeIndex < BENCH_CODE_COUNT; ++codeIndex) {
+    for (size_t digit = 0; digit < BENCH_CODE_LENGTH; ++digit) {
+      state = state * 1103515245U + 12345U;
+      codes[codeIndex][digit] = static_cast<char>('0' + (state >> 16) % 10);
+    }
+    codes[codeIndex][BENCH_CODE_LENGTH] = '\0';
+  }
+}
+
+}  // namespace
+
+/**
+ * 中核処理の所要時間を測り、`name,iterations,ns_per_op` のCSVで出力します。
+ * ※引数で繰り返し回数を指定できます。
+ */
+int main(int argc, char** argv) {
+  const uint32_t iterations = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : DEFAULT_ITERATIONS;
+  if (iterations == 0) {
+    fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  char codes[BENCH_CODE_COUNT][BENCH_CODE_LENGTH + 1];
+  fillBenchCodes(codes);
+  const CatalogIndex emptyCatalog;
+
+  printf("name,iterations,ns_per_op\n");
+
+  runBench("fnv1a32", iterations, [&](const uint32_t index) {
+    const char* code = codes[index % BENCH_CODE_COUNT];
+    benchSink = benchSink + fnv1a32Update(FNV1A32_OFFSET_BASIS, code, BENCH_CODE_LENGTH);
+  });
+
+  runBench("resolve_item_hash", iterations, [&](const uint32_t index) {
+    const CartItem item = resolveItemFromCode(emptyCatalog, codes[index % BENCH_CODE_COUNT], BENCH_CODE_LENGTH);
+    benchSink = benchSink + item.price;
+  });
+
+  runBench("normalize_input", iterations, [&](const uint32_t index) {
+    const char* code = codes[index % BENCH_CODE_COUNT];
+    TextSpan normalized{nullptr, 0};
+    const bool isValid = tryNormalizeInput(TextSpan{code, BENCH_CODE_LENGTH}, normalized);
+    benchSink = benchSink + (isValid && !isBarcodeControlResponse(normalized) ? 1 : 0);
+  });
+
+  FixedWidthTextMetrics metrics;
+  TextFitCache fitCache;
+  runBench("ellipsize_cached", iterations, [&](const uint32_t index) {
+    const char* fitted = fitCache.fit(metrics, getProductName(index % PRODUCT_NAME_COUNT), ROW_NAME_MAX_WIDTH);
+    benchSink = benchSink + static_cast<uint8_t>(fitted[0]);
+  });
+
+  runBench("ellipsize_uncached", iterations, [&](const uint32_t index) {
+    fitCache.clear();
+    const char* fitted = fitCache.fit(metrics, getProductName(index % PRODUCT_NAME_COUNT), ROW_NAME_MAX_WIDTH);
+    benchSink = benchSink + static_cast<uint8_t>(fitted[0]);
+  });
+
+  RegisterCart cart;
+  runBench("cart_add_total", iterations, [&](const uint32_t index) {
+    const CartItem item = {getProductName(index % PRODUCT_NAME_COUNT), static_cast<uint16_t>(PRICE_MIN + index % 100), 0};
+    if (!cart.add(item)) {
+      cart.clear();
+      cart.add(item);
+    }
+    benchSink = benchSink + static_cast<uint32_t>(cart.getTotal());
+  });
+
+  LatencyHistogram histogram;
+  runBench("histogram_record", iterations, [&](const uint32_t index) {
+    histogram.record(index * 2654435761U >> 12);
+  });
+  benchSink = benchSink + histogram.getPercentileUs(99);
+
+  return 0;
+}
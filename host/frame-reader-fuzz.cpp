@@ -0,0 +1,281 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "frame-reader.h"
+#include "host-fakes.h"
+
+namespace {
+
+constexpr uint32_t DEFAULT_ITERATIONS = 500;
+constexpr uint32_t DEFAULT_SEED = 1;
+constexpr size_t MODEL_STREAM_MAX_BYTES = 4096;
+constexpr size_t GAP_BURST_MAX_COUNT = 64;
+constexpr size_t GAP_BURST_MAX_LENGTH = 100;
+constexpr uint32_t FRAME_GAP_MS = 20;
+constexpr size_t THROUGHPUT_BYTES = 8 * 1024 * 1024;
+constexpr size_t THROUGHPUT_SLICE_BYTES = 64;
+constexpr size_t THROUGHPUT_CODE_LENGTH = 13;
+
+/**
+ * FrameReaderが読み取りの対象とする文字かを返します。
+ */
+bool isFrameCharacter(const uint8_t byte) {
+  return byte >= 0x20 && byte <= 0x7E;
+}
+
+/**
+ * 改行・印字可能文字・制御文字・上位バイトを偏りを付けて混ぜた1バイトを返します。
+ */
+uint8_t pickFuzzByte(std::mt19937& random) {
+  const uint32_t kind = random() % 100;
+  if (kind < 8) {
+    return random() % 2 == 0 ? '\r' : '\n';
+  }
+  if (kind < 90) {
+    return static_cast<uint8_t>(0x20 + random() % (0x7F - 0x20));
+  }
+  return static_cast<uint8_t>(random() % 256);
+}
+
+/**
+ * 区切りを無通信時間で判定しない場合に、ストリーム全体から得られるはずのフレームを返します。
+ * ※上限長を超えた行は末尾の上限長分だけが残ります。
+ */
+std::vector<std::string> splitReferenceFrames(const std::vector<uint8_t>& stream) {
+  std::vector<std::string> frames;
+  std::string current;
+
+  for (const uint8_t byte : stream) {
+    if (byte == '\r' || byte == '\n') {
+      if (!current.empty()) {
+        frames.push_back(current);
+        current.clear();
+      }
+      continue;
+    }
+
+    if (isFrameCharacter(byte)) {
+      current.push_back(static_cast<char>(byte));
+      if (current.size() > FrameReader::FRAME_BUFFER_MAX_LENGTH) {
+        current.erase(0, 1);
+      }
+    }
+  }
+
+  if (!current.empty()) {
+    frames.push_back(current);
+  }
+  return frames;
+}
+
+/**
+ * 読み取ったフレームの共通の性質を確かめ、満たしていれば末尾へ加えます。
+ */
+bool acceptFrame(
+  const FrameView& frame,
+  const FakeClock& clock,
+  uint32_t& lastFirstByteAtUs,
+  std::vector<std::string>& framesOut
+) {
+  if (frame.length == 0 || frame.length > FrameReader::FRAME_BUFFER_MAX_LENGTH || frame.data[frame.length] != '\0') {
+    fprintf(stderr, "invalid frame length=%u\n", static_cast<unsigned>(frame.length));
+    return false;
+  }
+
+  for (size_t index = 0; index < frame.length; ++index) {
+    if (!isFrameCharacter(static_cast<uint8_t>(frame.data[index]))) {
+      fprintf(stderr, "non-printable byte 0x%02x in frame\n", static_cast<uint8_t>(frame.data[index]));
+      return false;
+    }
+  }
+
+  if (frame.firstByteAtUs < lastFirstByteAtUs || frame.firstByteAtUs > clock.getMicros()) {
+    fprintf(stderr, "first byte time out of order at=%u\n", static_cast<unsigned>(frame.firstByteAtUs));
+    return false;
+  }
+
+  lastFirstByteAtUs = frame.firstByteAtUs;
+  framesOut.emplace_back(frame.data, frame.length);
+  return true;
+}
+
+/**
+ * 読み取ったフレーム列が期待どおりかを比べ、違えば最初の差分を出力します。
+ */
+bool compareFrames(const char* phase, const std::vector<std::string>& actual, const std::vector<std::string>& expected) {
+  const size_t commonCount = std::min(actual.size(), expected.size());
+  for (size_t index = 0; index < commonCount; ++index) {
+    if (actual[index] != expected[index]) {
+      fprintf(stderr, "%s frame %u mismatch\n  got:  %s\n  want: %s\n", phase, static_cast<unsigned>(index), actual[index].c_str(), expected[index].c_str());
+      return false;
+    }
+  }
+
+  if (actual.size() != expected.size()) {
+    fprintf(stderr, "%s frame count %u, want %u\n", phase, static_cast<unsigned>(actual.size()), static_cast<unsigned>(expected.size()));
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 任意のバイト列を不規則な分量ずつ届け、改行区切りの結果が参照実装と一致するかを確かめます。
+ */
+bool runLineModelCase(std::mt19937& random) {
+  std::vector<uint8_t> bytes(random() % MODEL_STREAM_MAX_BYTES);
+  for (uint8_t& byte : bytes) {
+    byte = pickFuzzByte(random);
+  }
+
+  // 上限長を超える行を必ず含めます。
+  if (!bytes.empty() && random() % 4 == 0) {
+    const size_t start = random() % bytes.size();
+    const size_t runLength = FrameReader::FRAME_BUFFER_MAX_LENGTH + random() % 200;
+    for (size_t index = start; index < std::min(bytes.size(), start + runLength); ++index) {
+      bytes[index] = static_cast<uint8_t>('A' + index % 26);
+    }
+  }
+
+  FakeClock clock;
+  ScriptedByteStream stream;
+  FrameReader reader(clock);
+  stream.append(bytes.data(), bytes.size());
+
+  std::vector<std::string> frames;
+  uint32_t lastFirstByteAtUs = 0;
+  FrameView frame;
+  while (stream.getUnreadLength() > 0) {
+    stream.receive(random() % 160);
+    clock.advanceUs(random() % 5000);
+    while (reader.read(stream, frame, 0)) {
+      if (!acceptFrame(frame, clock, lastFirstByteAtUs, frames)) {
+        return false;
+      }
+    }
+  }
+
+  if (reader.takePendingFrame(frame) && !acceptFrame(frame, clock, lastFirstByteAtUs, frames)) {
+    return false;
+  }
+
+  return compareFrames("line", frames, splitReferenceFrames(bytes));
+}
+
+/**
+ * 区切り文字のない読み取りを何回かに分けて届け、無通信時間で1件ずつに区切られるかを確かめます。
+ */
+bool runGapCase(std::mt19937& random) {
+  FakeClock clock;
+  ScriptedByteStream stream;
+  FrameReader reader(clock);
+
+  std::vector<std::string> expected;
+  std::vector<std::string> frames;
+  uint32_t lastFirstByteAtUs = 0;
+  FrameView frame;
+
+  const size_t burstCount = 1 + random() % GAP_BURST_MAX_COUNT;
+  for (size_t burstIndex = 0; burstIndex < burstCount; ++burstIndex) {
+    std::string burst(1 + random() % GAP_BURST_MAX_LENGTH, ' ');
+    for (char& ch : burst) {
+      ch = static_cast<char>(0x21 + random() % (0x7F - 0x21));
+    }
+    expected.push_back(burst);
+
+    std::vector<uint8_t> bytes(burst.begin(), burst.end());
+    if (random() % 3 == 0) {
+      bytes.push_back('\r');
+    }
+    stream.append(bytes.data(), bytes.size());
+
+    // 1件の読み取りの途中では、無通信時間に届かない間隔で少しずつ届けます。
+    while (stream.getUnreadLength() > 0) {
+      stream.receive(1 + random() % 24);
+      clock.advanceUs((random() % (FRAME_GAP_MS - 1)) * 1000);
+      while (reader.read(stream, frame, FRAME_GAP_MS)) {
+        if (!acceptFrame(frame, clock, lastFirstByteAtUs, frames)) {
+          return false;
+        }
+      }
+    }
+
+    clock.advanceUs((FRAME_GAP_MS + random() % 200) * 1000);
+    while (reader.read(stream, frame, FRAME_GAP_MS)) {
+      if (!acceptFrame(frame, clock, lastFirstByteAtUs, frames)) {
+        return false;
+      }
+    }
+  }
+
+  return compareFrames("gap", frames, expected);
+}
+
+/**
+ * 改行で終わる13桁のコードが連続する入力を読み切る速さを測ります。
+ */
+void runThroughput(std::mt19937& random) {
+  std::vector<uint8_t> bytes;
+  bytes.reserve(THROUGHPUT_BYTES + THROUGHPUT_CODE_LENGTH + 1);
+  while (bytes.size() < THROUGHPUT_BYTES) {
+    for (size_t digit = 0; digit < THROUGHPUT_CODE_LENGTH; ++digit) {
+      bytes.push_back(static_cast<uint8_t>('0' + random() % 10));
+    }
+    bytes.push_back('\r');
+  }
+
+  FakeClock clock;
+  ScriptedByteStream stream;
+  FrameReader reader(clock);
+  stream.append(bytes.data(), bytes.size());
+
+  size_t frameCount = 0;
+  FrameView frame;
+  const auto startedAt = std::chrono::steady_clock::now();
+  while (stream.getUnreadLength() > 0) {
+    stream.receive(THROUGHPUT_SLICE_BYTES);
+    while (reader.read(stream, frame, FRAME_GAP_MS)) {
+      ++frameCount;
+    }
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - startedAt;
+  const double elapsedSec = std::chrono::duration<double>(elapsed).count();
+
+  printf(
+    "throughput bytes=%u frames=%u elapsed_ms=%.1f mb_per_s=%.1f frames_per_s=%.0f\n",
+    static_cast<unsigned>(bytes.size()),
+    static_cast<unsigned>(frameCount),
+    elapsedSec * 1000.0,
+    bytes.size() / elapsedSec / (1024.0 * 1024.0),
+    frameCount / elapsedSec
+  );
+}
+
+}  // namespace
+
+/**
+ * FrameReaderへ乱数で作った入力を流して結果を確かめ、最後に処理速度を出力します。
+ * ※引数で試行回数と乱数の種を指定できます。失敗した試行の番号と種を出力して1を返します。
+ */
+int main(int argc, char** argv) {
+  const uint32_t iterations = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : DEFAULT_ITERATIONS;
+  const uint32_t seed = argc > 2 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : DEFAULT_SEED;
+
+  for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+    std::mt19937 random(seed + iteration);
+    if (!runLineModelCase(random) || !runGapCase(random)) {
+      fprintf(stderr, "failed iteration=%u seed=%u\n", static_cast<unsigned>(iteration), static_cast<unsigned>(seed + iteration));
+      return 1;
+    }
+  }
+  printf("fuzz iterations=%u seed=%u ok\n", static_cast<unsigned>(iterations), static_cast<unsigned>(seed));
+
+  std::mt19937 random(seed);
+  runThroughput(random);
+  return 0;
+}
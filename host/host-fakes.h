@@ -0,0 +1,142 @@
+#ifndef HOST_FAKES_H
+#define HOST_FAKES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "core-interfaces.h"
+
+/**
+ * 呼び出し側が進める時計です。
+ */
+class FakeClock : public MonotonicClock {
+ public:
+  /**
+   * 0ミリ秒から始まる時計を初期化します。
+   */
+  FakeClock()
+  : nowUs_(0) {
+  }
+
+  /**
+   * 時刻を指定マイクロ秒だけ進めます。
+   */
+  void advanceUs(const uint32_t elapsedUs) {
+    nowUs_ += elapsedUs;
+  }
+
+  uint32_t getMillis() const override {
+    return static_cast<uint32_t>(nowUs_ / 1000);
+  }
+
+  uint32_t getMicros() const override {
+    return static_cast<uint32_t>(nowUs_);
+  }
+
+ private:
+  uint64_t nowUs_;
+};
+
+/**
+ * 積んだバイト列を、受信済みとみなす上限ずつ返す入力元です。
+ * ※UARTの受信バッファへ少しずつ届く状況を再現します。
+ */
+class ScriptedByteStream : public ByteStream {
+ public:
+  /**
+   * 空の入力元を初期化します。
+   */
+  ScriptedByteStream()
+  : bytes_(),
+    readIndex_(0),
+    receivedLimit_(0) {
+  }
+
+  /**
+   * 末尾へバイト列を積みます。
+   * ※受信済みの範囲へは、receiveを呼ぶまで含めません。
+   */
+  void append(const uint8_t* data, const size_t length) {
+    compact();
+    bytes_.insert(bytes_.end(), data, data + length);
+  }
+
+  /**
+   * 積んだバイト列のうち、次の指定バイト数を受信済みにします。
+   */
+  void receive(const size_t length) {
+    receivedLimit_ = std::min(receivedLimit_ + length, bytes_.size());
+  }
+
+  /**
+   * 積んだバイト列をすべて受信済みにします。
+   */
+  void receiveAll() {
+    receivedLimit_ = bytes_.size();
+  }
+
+  /**
+   * 読み出していないバイト数を返します。
+   */
+  size_t getUnreadLength() const {
+    return bytes_.size() - readIndex_;
+  }
+
+  int available() override {
+    return static_cast<int>(receivedLimit_ - readIndex_);
+  }
+
+  size_t readBytes(uint8_t* buffer, const size_t length) override {
+    const size_t copyLength = std::min(length, receivedLimit_ - readIndex_);
+    memcpy(buffer, bytes_.data() + readIndex_, copyLength);
+    readIndex_ += copyLength;
+    return copyLength;
+  }
+
+ private:
+  /**
+   * 読み出し済みの先頭部分を捨てます。
+   */
+  void compact() {
+    bytes_.erase(bytes_.begin(), bytes_.begin() + static_cast<std::ptrdiff_t>(readIndex_));
+    receivedLimit_ -= readIndex_;
+    readIndex_ = 0;
+  }
+
+  std::vector<uint8_t> bytes_;
+  size_t readIndex_;
+  size_t receivedLimit_;
+};
+
+/**
+ * ASCIIは半角、それ以外の文字は全角の固定幅として文字列幅を測ります。
+ * ※実機の日本語フォントに近い比率で、省略処理の探索回数を再現します。
+ */
+class FixedWidthTextMetrics : public TextMetrics {
+ public:
+  static constexpr int HALF_WIDTH = 12;
+  static constexpr int FULL_WIDTH = 24;
+
+  int measureTextWidth(const char* text) override {
+    int width = 0;
+    for (const char* cursor = text; *cursor != '\0'; ++cursor) {
+      const uint8_t byte = static_cast<uint8_t>(*cursor);
+      if (byte < 0x80) {
+        width += HALF_WIDTH;
+      } else if ((byte & 0xC0) != 0x80) {
+        width += FULL_WIDTH;
+      }
+    }
+    return width;
+  }
+
+  const void* getFontKey() const override {
+    return this;
+  }
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include "image-filter.h"
+
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "logger.h"
+
+namespace {
+
+constexpr int MAX_WIDTH = 320;
+constexpr int SKETCH_EDGE_GAIN = 3;
+constexpr int SEPIA_RED_OFFSET = 40;
+constexpr int SEPIA_GREEN_OFFSET = 20;
+constexpr int SEPIA_BLUE_OFFSET = -20;
+// 各色の上位2bitを残すマスクと、残した段の中央へ寄せる値です（バイト入れ替え済み）。
+constexpr uint16_t POSTERIZE_MASK = 0x18C6;
+constexpr uint16_t POSTERIZE_BIAS = 0x0421;
+
+constexpr const char* FILTER_NAMES[static_cast<size_t>(ImageFilter::COUNT)] = {
+  "none",
+  "mono",
+  "sepia",
+  "posterize",
+  "mirror",
+  "sketch",
+};
+
+uint16_t monoPalette[256];
+uint16_t sepiaPalette[256];
+bool hasPalettes = false;
+uint8_t sketchLumaRows[2][MAX_WIDTH];
+
+/**
+ * 上位バイトが先の並びとRGB565の値を相互に変換します。
+ */
+inline uint16_t swapBytes(const uint16_t value) {
+  return static_cast<uint16_t>((value << 8) | (value >> 8));
+}
+
+/**
+ * 8bitの各色からバイト入れ替え済みのRGB565を返します。
+ */
+uint16_t packSwapped565(const int red, const int green, const int blue) {
+  const uint16_t value = static_cast<uint16_t>(((red >> 3) << 11) | ((green >> 2) << 5) | (blue >> 3));
+  return swapBytes(value);
+}
+
+/**
+ * バイト入れ替え済みのRGB565から輝度(0-255)を返します。
+ * ※係数はBT.601を5/6bitの各色の最大値で正規化したものです。
+ */
+inline uint8_t getLuma(const uint16_t swappedPixel) {
+  const uint16_t value = swapBytes(swappedPixel);
+  const uint32_t red = value >> 11;
+  const uint32_t green = (value >> 5) & 0x3F;
+  const uint32_t blue = value & 0x1F;
+  return static_cast<uint8_t>((red * 634 + green * 607 + blue * 239) >> 8);
+}
+
+/**
+ * 輝度から色を引く表を用意します。
+ * ※単色とセピアは輝度を求めた後の色付けだけが異なるため、表引き1回で済ませます。
+ */
+void preparePalettes() {
+  if (hasPalettes) {
+    return;
+  }
+
+  for (int luma = 0; luma < 256; ++luma) {
+    monoPalette[luma] = packSwapped565(luma, luma, luma);
+    sepiaPalette[luma] = packSwapped565(
+      std::min(std::max(luma + SEPIA_RED_OFFSET, 0), 255),
+      std::min(std::max(luma + SEPIA_GREEN_OFFSET, 0), 255),
+      std::min(std::max(luma + SEPIA_BLUE_OFFSET, 0), 255)
+    );
+  }
+  hasPalettes = true;
+}
+
+/**
+ * 輝度を求めて表の色へ置き換えます。
+ */
+void applyPalette(const uint16_t* palette, uint16_t* pixels, const size_t count) {
+  for (size_t index = 0; index < count; ++index) {
+    pixels[index] = palette[getLuma(pixels[index])];
+  }
+}
+
+/**
+ * 各色を4段階へ減色します。
+ * ※2画素ずつ32bitで読み書きし、マスクとORだけで処理します。
+ */
+void applyPosterize(uint16_t* pixels, const size_t count) {
+  constexpr uint32_t MASK = (static_cast<uint32_t>(POSTERIZE_MASK) << 16) | POSTERIZE_MASK;
+  constexpr uint32_t BIAS = (static_cast<uint32_t>(POSTERIZE_BIAS) << 16) | POSTERIZE_BIAS;
+  const size_t pairCount = count / 2;
+
+  for (size_t index = 0; index < pairCount; ++index) {
+    uint32_t pair;
+    memcpy(&pair, pixels + index * 2, sizeof(pair));
+    pair = (pair & MASK) | BIAS;
+    memcpy(pixels + index * 2, &pair, sizeof(pair));
+  }
+
+  if (count % 2 != 0) {
+    pixels[count - 1] = static_cast<uint16_t>((pixels[count - 1] & POSTERIZE_MASK) | POSTERIZE_BIAS);
+  }
+}
+
+/**
+ * 左右を反転します。
+ */
+void applyMirror(uint16_t* pixels, const int width, const int height) {
+  for (int y = 0; y < height; ++y) {
+    uint16_t* row = pixels + static_cast<size_t>(y) * width;
+    std::reverse(row, row + width);
+  }
+}
+
+/**
+ * 1行分の輝度を求めます。
+ */
+void fillLumaRow(const uint16_t* row, const int width, uint8_t* lumaOut) {
+  for (int x = 0; x < width; ++x) {
+    lumaOut[x] = getLuma(row[x]);
+  }
+}
+
+/**
+ * 輝度の差分で輪郭を取り、白地に黒い線の鉛筆画風にします。
+ * ※その場で書き換えるため、次の行の輝度を上書き前に求めて2行分だけ保持します。
+ */
+void applySketch(uint16_t* pixels, const int width, const int height) {
+  uint8_t* currentLuma = sketchLumaRows[0];
+  uint8_t* nextLuma = sketchLumaRows[1];
+  fillLumaRow(pixels, width, currentLuma);
+
+  for (int y = 0; y < height; ++y) {
+    uint16_t* row = pixels + static_cast<size_t>(y) * width;
+    const bool hasNextRow = y + 1 < height;
+    if (hasNextRow) {
+      fillLumaRow(row + width, width, nextLuma);
+    }
+
+    for (int x = 0; x < width; ++x) {
+      const int luma = currentLuma[x];
+      const int rightLuma = x + 1 < width ? currentLuma[x + 1] : luma;
+      const int belowLuma = hasNextRow ? nextLuma[x] : luma;
+      const int edge = (abs(rightLuma - luma) + abs(belowLuma - luma)) * SKETCH_EDGE_GAIN;
+      row[x] = monoPalette[255 - std::min(edge, 255)];
+    }
+
+    std::swap(currentLuma, nextLuma);
+  }
+}
+
+}  // namespace
+
+/**
+ * 画像効果の名前を返します。
+ */
+const char* getImageFilterName(const ImageFilter filter) {
+  const size_t index = static_cast<size_t>(filter);
+  return index < static_cast<size_t>(ImageFilter::COUNT) ? FILTER_NAMES[index] : "unknown";
+}
+
+/**
+ * 指定した数だけ先の画像効果を返します。
+ */
+ImageFilter getNextImageFilter(const ImageFilter filter, const int step) {
+  const int count = static_cast<int>(ImageFilter::COUNT);
+  const int index = ((static_cast<int>(filter) + step) % count + count) % count;
+  return static_cast<ImageFilter>(index);
+}
+
+/**
+ * カメラのRGB565画像へその場で画像効果をかけます。
+ */
+void applyImageFilter(const ImageFilter filter, uint16_t* pixels, const int width, const int height) {
+  if (pixels == nullptr || width <= 0 || height <= 0 || width > MAX_WIDTH) {
+    return;
+  }
+
+  preparePalettes();
+  const size_t count = static_cast<size_t>(width) * height;
+
+  switch (filter) {
+    case ImageFilter::MONO:
+      applyPalette(monoPalette, pixels, count);
+      break;
+
+    case ImageFilter::SEPIA:
+      applyPalette(sepiaPalette, pixels, count);
+      break;
+
+    case ImageFilter::POSTERIZE:
+      applyPosterize(pixels, count);
+      break;
+
+    case ImageFilter::MIRROR:
+      applyMirror(pixels, width, height);
+      break;
+
+    case ImageFilter::SKETCH:
+      applySketch(pixels, width, height);
+      break;
+
+    case ImageFilter::NONE:
+    case ImageFilter::COUNT:
+      break;
+  }
+}
+
+/**
+ * 画像効果ごとに1フレームあたりの処理時間を計測し、ログ出力します。
+ */
+bool runImageFilterBenchmark(const int width, const int height, const uint32_t iterations) {
+  if (width <= 0 || height <= 0 || width > MAX_WIDTH || iterations == 0) {
+    return false;
+  }
+
+  const size_t count = static_cast<size_t>(width) * height;
+  uint16_t* pixels = static_cast<uint16_t*>(heap_caps_malloc(count * sizeof(uint16_t), MALLOC_CAP_SPIRAM));
+  if (pixels == nullptr) {
+    LOG_WARN(PERF, "filter bench alloc failed");
+    return false;
+  }
+
+  for (size_t filterIndex = 1; filterIndex < static_cast<size_t>(ImageFilter::COUNT); ++filterIndex) {
+    const ImageFilter filter = static_cast<ImageFilter>(filterIndex);
+    uint64_t totalUs = 0;
+
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+      // 減色などは同じ画像へ繰り返すと結果が変わらず速く見えるため、毎回同じ模様へ戻します。
+      for (size_t index = 0; index < count; ++index) {
+        pixels[index] = static_cast<uint16_t>(index * 2654435761UL >> 16);
+      }
+
+      const int64_t startedAtUs = esp_timer_get_time();
+      applyImageFilter(filter, pixels, width, height);
+      totalUs += static_cast<uint64_t>(esp_timer_get_time() - startedAtUs);
+    }
+
+    const uint32_t averageUs = static_cast<uint32_t>(totalUs / iterations);
+    LOG_INFO(
+      PERF,
+      "filter=%s %dx%d avg=%lu.%03lums/frame",
+      getImageFilterName(filter),
+      width,
+      height,
+      static_cast<unsigned long>(averageUs / 1000),
+      static_cast<unsigned long>(averageUs % 1000)
+    );
+  }
+
+  heap_caps_free(pixels);
+  return true;
+}
@@ -0,0 +1,43 @@
+#ifndef IMAGE_FILTER_H
+#define IMAGE_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * ライブ表示と静止画にかける画像効果です。
+ */
+enum class ImageFilter : uint8_t {
+  NONE,
+  MONO,
+  SEPIA,
+  POSTERIZE,
+  MIRROR,
+  SKETCH,
+  COUNT,
+};
+
+/**
+ * 画像効果の名前を返します。
+ */
+const char* getImageFilterName(ImageFilter filter);
+
+/**
+ * 指定した数だけ先の画像効果を返します。
+ * ※末尾の次は先頭へ戻ります。
+ */
+ImageFilter getNextImageFilter(ImageFilter filter, int step);
+
+/**
+ * カメラのRGB565画像へその場で画像効果をかけます。
+ * ※画素は画面へそのまま送れる上位バイトが先の並びを前提とし、幅はMAX_WIDTHまでです。
+ */
+void applyImageFilter(ImageFilter filter, uint16_t* pixels, int width, int height);
+
+/**
+ * 画像効果ごとに1フレームあたりの処理時間を計測し、ログ出力します。
+ * ※計測用の画像をPSRAMへ一時的に確保します。
+ */
+bool runImageFilterBenchmark(int width, int height, uint32_t iterations);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef INPUT_EVENT_H
+#define INPUT_EVENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spsc-queue.h"
+
+/**
+ * 入力イベントの種類を表します。
+ */
+enum class InputEventType {
+  BARCODE,
+  RFID,
+  DEBUG_LINE,
+};
+
+/**
+ * 入力処理タスクから画面処理タスクへ渡す入力イベントです。
+ */
+struct InputEvent {
+  static constexpr size_t TEXT_CAPACITY = 129;
+
+  InputEventType type;
+  uint32_t timestampMs;
+  uint32_t sourceStartedAtUs;
+  uint32_t publishedAtUs;
+  // 負荷試験が発行した疑似入力かを表します。疑似入力は決済の記録を残しません。
+  bool isSynthetic;
+  char text[TEXT_CAPACITY];
+};
+
+/**
+ * 入力イベントを受け渡すキューです。
+ */
+using InputEventQueue = SpscQueue<InputEvent, 32>;
+
+#endif
@@ -0,0 +1,330 @@
+#include "input-pipeline.h"
+
+#include <M5Unified.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <algorithm>
+
+#include "logger.h"
+#include "mode-base.h"
+
+namespace {
+
+constexpr uint32_t INPUT_TASK_STACK_SIZE = 4096;
+constexpr UBaseType_t INPUT_TASK_PRIORITY = 2;
+constexpr BaseType_t INPUT_TASK_CORE = 0;
+constexpr TickType_t INPUT_POLL_INTERVAL_TICKS = 1;
+// タッチパネルは周辺機器の読み取りより優先し、固定の間隔で読み取ります。
+constexpr uint32_t TOUCH_TASK_STACK_SIZE = 3072;
+constexpr UBaseType_t TOUCH_TASK_PRIORITY = 3;
+constexpr BaseType_t TOUCH_TASK_CORE = 0;
+constexpr uint32_t TOUCH_SAMPLE_INTERVAL_MS = 10;
+constexpr TouchGestureRecognizer::Config TOUCH_GESTURE_CONFIG = {
+  600,  // longPressMs
+  16,   // tapSlopPixels
+  40,   // swipeMinPixels
+};
+
+}  // namespace
+
+/**
+ * 入力処理を初期化します。
+ */
+InputPipeline::InputPipeline()
+: queue_(),
+  touchQueue_(),
+  touchRecognizer_(TOUCH_GESTURE_CONFIG),
+  bootModes_(),
+  bootModeCount_(0),
+  activeMode_(nullptr),
+  droppedEventCount_(0),
+  pollPassCount_(0),
+  internalBusMutex_(nullptr),
+  taskHandle_(nullptr),
+  touchTaskHandle_(nullptr),
+  consumerTaskHandle_(nullptr) {
+}
+
+/**
+ * 入力処理タスクとタッチ処理タスクを起動し、起動できたかを返します。
+ * ※画面処理タスクから呼び出し、そのタスクを入力イベントの通知先にします。
+ */
+bool InputPipeline::begin() {
+  if (taskHandle_ != nullptr) {
+    return true;
+  }
+
+  internalBusMutex_ = xSemaphoreCreateMutex();
+  if (internalBusMutex_ == nullptr) {
+    return false;
+  }
+
+  consumerTaskHandle_ = xTaskGetCurrentTaskHandle();
+
+  // 画面処理はArduinoのloop()側のコアに任せ、入力は反対側のコアで読み取ります。
+  const BaseType_t result = xTaskCreatePinnedToCore(
+    runTask,
+    "input",
+    INPUT_TASK_STACK_SIZE,
+    this,
+    INPUT_TASK_PRIORITY,
+    &taskHandle_,
+    INPUT_TASK_CORE
+  );
+  if (result != pdPASS) {
+    taskHandle_ = nullptr;
+    return false;
+  }
+
+  // 周辺機器の読み取りや画面処理が重い周回でも、タッチの読み取り間隔は変えません。
+  const BaseType_t touchResult = xTaskCreatePinnedToCore(
+    runTouchTask,
+    "touch",
+    TOUCH_TASK_STACK_SIZE,
+    this,
+    TOUCH_TASK_PRIORITY,
+    &touchTaskHandle_,
+    TOUCH_TASK_CORE
+  );
+  if (touchResult != pdPASS) {
+    touchTaskHandle_ = nullptr;
+    LOG_ERROR(BOOT, "touch task start failed");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 入力処理タスクで起動処理を進めるモードを登録し、登録できたかを返します。
+ * ※begin前に呼び出します。
+ */
+bool InputPipeline::addBootMode(ModeBase* mode) {
+  if (taskHandle_ != nullptr || bootModeCount_ >= BOOT_MODE_CAPACITY) {
+    return false;
+  }
+
+  bootModes_[bootModeCount_] = mode;
+  ++bootModeCount_;
+  return true;
+}
+
+/**
+ * 周辺機器を読み取るモードを切り替えます。
+ * ※切り替えた後に周回が1回終われば、それ以降の周回は切り替え後のモードだけを読み取ります。
+ */
+void InputPipeline::setActiveMode(ModeBase* mode) {
+  ModeBase* previousMode = activeMode_.exchange(mode, std::memory_order_acq_rel);
+  if (previousMode == nullptr || previousMode == mode || taskHandle_ == nullptr) {
+    return;
+  }
+
+  // 切り替え前に読み出したモードで読み取り中の周回が終わるのを、周回の通し番号で待ちます。
+  const uint32_t passCount = pollPassCount_.load(std::memory_order_acquire);
+  wake();
+  while (pollPassCount_.load(std::memory_order_acquire) == passCount) {
+    vTaskDelay(1);
+  }
+}
+
+/**
+ * 次の周期を待たずに入力処理タスクを起こします。
+ * ※他タスクやコールバックから呼び出せます。
+ */
+void InputPipeline::wake() {
+  if (taskHandle_ != nullptr) {
+    xTaskNotifyGive(taskHandle_);
+  }
+}
+
+/**
+ * 入力イベントを発行し、キューへ積めたかを返します。
+ * ※入力処理タスクからのみ呼び出します。
+ */
+bool InputPipeline::publish(const InputEvent& event) {
+  if (queue_.push(event)) {
+    if (consumerTaskHandle_ != nullptr) {
+      xTaskNotifyGive(consumerTaskHandle_);
+    }
+    return true;
+  }
+
+  droppedEventCount_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+/**
+ * 文字列を伴う入力イベントを発行し、キューへ積めたかを返します。
+ * ※入力処理タスクからのみ呼び出します。
+ */
+bool InputPipeline::publishText(const InputEventType type, const char* text, const size_t length) {
+  return publishFrame(type, FrameView{text, length, micros()});
+}
+
+/**
+ * 負荷試験の疑似入力として文字列を伴う入力イベントを発行し、キューへ積めたかを返します。
+ * ※入力処理タスクからのみ呼び出します。
+ */
+bool InputPipeline::publishSyntheticText(const InputEventType type, const char* text, const size_t length) {
+  return publishFrameEvent(type, FrameView{text, length, micros()}, true);
+}
+
+/**
+ * 受信済みフレームを入力イベントとして発行し、キューへ積めたかを返します。
+ * ※先頭バイトの受信時刻を遅延計測用に引き継ぎます。
+ */
+bool InputPipeline::publishFrame(const InputEventType type, const FrameView& frame) {
+  return publishFrameEvent(type, frame, false);
+}
+
+/**
+ * フレームを入力イベントとして組み立てて発行し、キューへ積めたかを返します。
+ */
+bool InputPipeline::publishFrameEvent(const InputEventType type, const FrameView& frame, const bool isSynthetic) {
+  InputEvent event{};
+  event.type = type;
+  event.timestampMs = millis();
+  event.publishedAtUs = micros();
+  event.sourceStartedAtUs = frame.firstByteAtUs;
+  event.isSynthetic = isSynthetic;
+
+  const size_t copyLength = std::min(frame.length, InputEvent::TEXT_CAPACITY - 1);
+  memcpy(event.text, frame.data, copyLength);
+  event.text[copyLength] = '\0';
+  return publish(event);
+}
+
+/**
+ * 入力イベントが届くか指定時間が経つまで画面処理タスクを休ませます。
+ * ※休む前に届いていたイベントの通知も、ここでまとめて消費します。
+ */
+void InputPipeline::waitForEvent(const uint32_t timeoutMs) {
+  if (timeoutMs == 0) {
+    return;
+  }
+
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+}
+
+/**
+ * 入力イベントを1件取り出し、取り出せたかを返します。
+ * ※画面処理タスクからのみ呼び出します。
+ */
+bool InputPipeline::popEvent(InputEvent& event) {
+  return queue_.pop(event);
+}
+
+/**
+ * タッチ操作を1件取り出し、取り出せたかを返します。
+ * ※画面処理タスクからのみ呼び出します。
+ */
+bool InputPipeline::popTouchEvent(TouchEvent& event) {
+  return touchQueue_.pop(event);
+}
+
+/**
+ * キューが満杯で破棄した入力イベント数を返します。
+ * ※タッチ操作の破棄も含みます。
+ */
+uint32_t InputPipeline::getDroppedEventCount() const {
+  return droppedEventCount_.load(std::memory_order_relaxed);
+}
+
+/**
+ * タッチパネルと共有する内部I2Cバスを占有します。
+ */
+void InputPipeline::lockInternalBus() {
+  if (internalBusMutex_ != nullptr) {
+    xSemaphoreTake(internalBusMutex_, portMAX_DELAY);
+  }
+}
+
+/**
+ * 内部I2Cバスの占有を解除します。
+ */
+void InputPipeline::unlockInternalBus() {
+  if (internalBusMutex_ != nullptr) {
+    xSemaphoreGive(internalBusMutex_);
+  }
+}
+
+/**
+ * 入力処理タスクの本体です。
+ */
+void InputPipeline::runTask(void* context) {
+  InputPipeline* pipeline = static_cast<InputPipeline*>(context);
+
+  while (true) {
+    pipeline->advanceBootModes();
+
+    ModeBase* mode = pipeline->activeMode_.load(std::memory_order_acquire);
+    if (mode != nullptr) {
+      mode->pollInput(*pipeline);
+    }
+    pipeline->pollPassCount_.fetch_add(1, std::memory_order_release);
+
+    // 入力を処理し終えた空き時間に、溜まったログを送信できる分だけ書き出します。
+    Logger::instance().drain(Serial);
+
+    ulTaskNotifyTake(pdTRUE, INPUT_POLL_INTERVAL_TICKS);
+  }
+}
+
+/**
+ * 登録済みモードの起動処理を1段階ずつ進めます。
+ */
+void InputPipeline::advanceBootModes() {
+  size_t index = 0;
+
+  while (index < bootModeCount_) {
+    if (!bootModes_[index]->advanceBoot()) {
+      ++index;
+      continue;
+    }
+
+    bootModes_[index] = bootModes_[bootModeCount_ - 1];
+    --bootModeCount_;
+  }
+}
+
+/**
+ * タッチ処理タスクの本体です。
+ * ※前回の起床時刻を基準に待つため、読み取りにかかった時間で間隔がずれません。
+ */
+void InputPipeline::runTouchTask(void* context) {
+  InputPipeline* pipeline = static_cast<InputPipeline*>(context);
+  TickType_t lastWakeTicks = xTaskGetTickCount();
+
+  while (true) {
+    pipeline->sampleTouch();
+    vTaskDelayUntil(&lastWakeTicks, pdMS_TO_TICKS(TOUCH_SAMPLE_INTERVAL_MS));
+  }
+}
+
+/**
+ * タッチパネルを1回読み取り、認識したタッチ操作を発行します。
+ * ※タッチ操作のキューはこのタスクだけが書き込みます。
+ */
+void InputPipeline::sampleTouch() {
+  int32_t touchX = 0;
+  int32_t touchY = 0;
+
+  lockInternalBus();
+  M5.update();
+  const bool isTouching = M5.Display.getTouch(&touchX, &touchY);
+  unlockInternalBus();
+
+  TouchEvent event{};
+  if (!touchRecognizer_.update(isTouching, touchX, touchY, millis(), event)) {
+    return;
+  }
+
+  if (!touchQueue_.push(event)) {
+    droppedEventCount_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  if (consumerTaskHandle_ != nullptr) {
+    xTaskNotifyGive(consumerTaskHandle_);
+  }
+}
@@ -0,0 +1,150 @@
+#ifndef INPUT_PIPELINE_H
+#define INPUT_PIPELINE_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "frame-reader.h"
+#include "input-event.h"
+#include "touch-gesture.h"
+
+class ModeBase;
+
+/**
+ * 入力処理専用タスクで周辺機器を読み取り、入力イベントとして画面処理側へ渡します。
+ * ※タッチパネルは別のタスクで一定間隔に読み取り、認識したタッチ操作を専用のキューで渡します。
+ */
+class InputPipeline {
+ public:
+  /**
+   * 入力処理を初期化します。
+   */
+  InputPipeline();
+
+  /**
+   * 入力処理タスクとタッチ処理タスクを起動し、起動できたかを返します。
+   * ※画面処理タスクから呼び出し、そのタスクを入力イベントの通知先にします。
+   */
+  bool begin();
+
+  /**
+   * 入力処理タスクで起動処理を進めるモードを登録し、登録できたかを返します。
+   * ※begin前に呼び出します。
+   */
+  bool addBootMode(ModeBase* mode);
+
+  /**
+   * 周辺機器を読み取るモードを切り替えます。
+   * ※切り替え前のモードを読み取っている周回があれば、その周回が終わるまで待ってから戻ります。
+   *   入力処理タスクからは呼び出さないでください。
+   */
+  void setActiveMode(ModeBase* mode);
+
+  /**
+   * 次の周期を待たずに入力処理タスクを起こします。
+   * ※他タスクやコールバックから呼び出せます。
+   */
+  void wake();
+
+  /**
+   * 入力イベントを発行し、キューへ積めたかを返します。
+   * ※入力処理タスクからのみ呼び出します。
+   */
+  bool publish(const InputEvent& event);
+
+  /**
+   * 文字列を伴う入力イベントを発行し、キューへ積めたかを返します。
+   * ※入力処理タスクからのみ呼び出します。
+   */
+  bool publishText(InputEventType type, const char* text, size_t length);
+
+  /**
+   * 負荷試験の疑似入力として文字列を伴う入力イベントを発行し、キューへ積めたかを返します。
+   * ※入力処理タスクからのみ呼び出します。
+   */
+  bool publishSyntheticText(InputEventType type, const char* text, size_t length);
+
+  /**
+   * 受信済みフレームを入力イベントとして発行し、キューへ積めたかを返します。
+   * ※先頭バイトの受信時刻を遅延計測用に引き継ぎます。
+   */
+  bool publishFrame(InputEventType type, const FrameView& frame);
+
+  /**
+   * 入力イベントが届くか指定時間が経つまで画面処理タスクを休ませます。
+   * ※画面処理タスクからのみ呼び出します。
+   */
+  void waitForEvent(uint32_t timeoutMs);
+
+  /**
+   * 入力イベントを1件取り出し、取り出せたかを返します。
+   * ※画面処理タスクからのみ呼び出します。
+   */
+  bool popEvent(InputEvent& event);
+
+  /**
+   * タッチ操作を1件取り出し、取り出せたかを返します。
+   * ※画面処理タスクからのみ呼び出します。
+   */
+  bool popTouchEvent(TouchEvent& event);
+
+  /**
+   * キューが満杯で破棄した入力イベント数を返します。
+   * ※タッチ操作の破棄も含みます。
+   */
+  uint32_t getDroppedEventCount() const;
+
+  /**
+   * タッチパネルと共有する内部I2Cバスを占有します。
+   */
+  void lockInternalBus();
+
+  /**
+   * 内部I2Cバスの占有を解除します。
+   */
+  void unlockInternalBus();
+
+ private:
+  /**
+   * 入力処理タスクの本体です。
+   */
+  static void runTask(void* context);
+
+  /**
+   * フレームを入力イベントとして組み立てて発行し、キューへ積めたかを返します。
+   */
+  bool publishFrameEvent(InputEventType type, const FrameView& frame, bool isSynthetic);
+
+  /**
+   * 登録済みモードの起動処理を1段階ずつ進めます。
+   */
+  void advanceBootModes();
+
+  /**
+   * タッチ処理タスクの本体です。
+   */
+  static void runTouchTask(void* context);
+
+  /**
+   * タッチパネルを1回読み取り、認識したタッチ操作を発行します。
+   */
+  void sampleTouch();
+
+  static constexpr size_t BOOT_MODE_CAPACITY = 2;
+
+  InputEventQueue queue_;
+  TouchEventQueue touchQueue_;
+  TouchGestureRecognizer touchRecognizer_;
+  ModeBase* bootModes_[BOOT_MODE_CAPACITY];
+  size_t bootModeCount_;
+  std::atomic<ModeBase*> activeMode_;
+  std::atomic<uint32_t> droppedEventCount_;
+  std::atomic<uint32_t> pollPassCount_;
+  SemaphoreHandle_t internalBusMutex_;
+  TaskHandle_t taskHandle_;
+  TaskHandle_t touchTaskHandle_;
+  TaskHandle_t consumerTaskHandle_;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "input-text.h"
+
+#include <string.h>
+
+namespace {
+
+constexpr size_t MIN_VALID_INPUT_LENGTH = 2;
+constexpr size_t CONTROL_RESPONSE_MAX_LENGTH = 4;
+
+/**
+ * 空白文字かを返します。
+ */
+bool isSpace(const char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\v' || ch == '\f';
+}
+
+}  // namespace
+
+/**
+ * 前後の空白文字を除いた範囲を返します。
+ */
+TextSpan trimSpaces(const TextSpan& text) {
+  size_t start = 0;
+  size_t end = text.length;
+
+  while (start < end && isSpace(text.data[start])) {
+    ++start;
+  }
+
+  while (end > start && isSpace(text.data[end - 1])) {
+    --end;
+  }
+
+  return TextSpan{text.data + start, end - start};
+}
+
+/**
+ * 前後の空白を除いた入力が有効な長さかを返します。
+ */
+bool tryNormalizeInput(const TextSpan& rawInput, TextSpan& normalizedInput) {
+  normalizedInput = trimSpaces(rawInput);
+  return normalizedInput.length >= MIN_VALID_INPUT_LENGTH;
+}
+
+/**
+ * バーコードスキャナの制御応答フレームかを判定します。
+ */
+bool isBarcodeControlResponse(const TextSpan& frame) {
+  if (frame.length == 2 && memcmp(frame.data, "3u", 2) == 0) {
+    return true;
+  }
+
+  if (frame.length > 0 && frame.length <= CONTROL_RESPONSE_MAX_LENGTH) {
+    return frame.data[0] == '"' || frame.data[0] == '$';
+  }
+
+  return false;
+}
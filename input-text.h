@@ -0,0 +1,30 @@
+#ifndef INPUT_TEXT_H
+#define INPUT_TEXT_H
+
+#include <stddef.h>
+
+/**
+ * 入力文字列の一部を参照します。
+ * ※参照元の文字列が有効な間だけ使えます。
+ */
+struct TextSpan {
+  const char* data;
+  size_t length;
+};
+
+/**
+ * 前後の空白文字を除いた範囲を返します。
+ */
+TextSpan trimSpaces(const TextSpan& text);
+
+/**
+ * 前後の空白を除いた入力が有効な長さかを返します。
+ */
+bool tryNormalizeInput(const TextSpan& rawInput, TextSpan& normalizedInput);
+
+/**
+ * バーコードスキャナの制御応答フレームかを判定します。
+ */
+bool isBarcodeControlResponse(const TextSpan& frame);
+
+#endif
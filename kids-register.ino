@@ -3,13 +3,17 @@
 #include <algorithm>
 
 #include "camera-mode.h"
+#include "logger.h"
 #include "mode-base.h"
+#include "perf-stats.h"
 #include "register-config.h"
 #include "register-mode.h"
 
 namespace {
 
 constexpr long USB_SERIAL_BAUD = 115200;
+// 期限付きジョブも入力もない間に画面処理タスクを休ませる上限です。
+constexpr uint32_t LOOP_MAX_WAIT_MS = 100;
 constexpr int MODE_BUTTON_W = 146;
 constexpr int MODE_BUTTON_H = 164;
 constexpr int MODE_BUTTON_GAP = 16;
@@ -43,7 +47,6 @@ RegisterMode registerMode;
 CameraMode cameraMode;
 ModeBase* activeMode = nullptr;
 AppMode appMode = AppMode::SELECT;
-bool wasTouching = false;
 
 /**
  * 周辺機器ピン情報を取得します。
@@ -57,14 +60,23 @@ RegisterMode::Pins resolvePeripheralPins() {
   return RegisterMode::Pins{barcodeRxdPin, barcodeTxdPin, rfidSdaPin, rfidSclPin};
 }
 
+/**
+ * モード共通の描画先を返します。
+ */
+LovyanGFX& surface() {
+  return ModeBase::frameCompositor().surface();
+}
+
 /**
  * 画面とスピーカーを初期化します。
  */
 void initializeUi() {
   M5.Speaker.setVolume(SPEAKER_VOLUME);
+  ModeBase::prepareToneClips();
   M5.Display.setRotation(3);
-  M5.Display.setFont(BODY_FONT);
-  M5.Display.setTextSize(1);
+  ModeBase::frameCompositor().begin();
+  surface().setFont(BODY_FONT);
+  surface().setTextSize(1);
 }
 
 /**
@@ -72,7 +84,7 @@ void initializeUi() {
  */
 Rect getRegisterModeButtonRect() {
   const int totalWidth = MODE_BUTTON_W * 2 + MODE_BUTTON_GAP;
-  const int startX = (M5.Display.width() - totalWidth) / 2;
+  const int startX = (surface().width() - totalWidth) / 2;
   return Rect{startX, MODE_BUTTON_TOP, MODE_BUTTON_W, MODE_BUTTON_H};
 }
 
@@ -101,9 +113,9 @@ bool isPointInsideRect(const int x, const int y, const Rect& rect) {
  * 文字列を中央揃えで描画します。
  */
 void drawCenteredText(const String& text, const int y) {
-  const int x = (M5.Display.width() - M5.Display.textWidth(text)) / 2;
-  M5.Display.setCursor(std::max(x, 0), y);
-  M5.Display.print(text);
+  const int x = (surface().width() - surface().textWidth(text)) / 2;
+  surface().setCursor(std::max(x, 0), y);
+  surface().print(text);
 }
 
 /**
@@ -119,7 +131,7 @@ void drawRegisterModeIcon(const Rect& iconRect) {
   const int bodyW = iconRect.w - 24;
   const int bodyH = iconRect.h - 30;
 
-  M5.Display.fillTriangle(
+  surface().fillTriangle(
     roofLeftX,
     roofBottomY,
     iconRect.x + iconRect.w / 2,
@@ -128,9 +140,9 @@ void drawRegisterModeIcon(const Rect& iconRect) {
     roofBottomY,
     TFT_DARKGREEN
   );
-  M5.Display.fillRect(bodyX, bodyY, bodyW, bodyH, TFT_DARKGREEN);
-  M5.Display.fillRect(iconRect.x + iconRect.w / 2 - 8, bodyY + 14, 16, bodyH - 16, TFT_WHITE);
-  M5.Display.fillRect(bodyX + 8, bodyY + 10, bodyW - 16, 12, TFT_WHITE);
+  surface().fillRect(bodyX, bodyY, bodyW, bodyH, TFT_DARKGREEN);
+  surface().fillRect(iconRect.x + iconRect.w / 2 - 8, bodyY + 14, 16, bodyH - 16, TFT_WHITE);
+  surface().fillRect(bodyX + 8, bodyY + 10, bodyW - 16, 12, TFT_WHITE);
 }
 
 /**
@@ -142,18 +154,23 @@ void drawCameraModeIcon(const Rect& iconRect) {
   const int bodyW = iconRect.w - 12;
   const int bodyH = iconRect.h - 24;
 
-  M5.Display.fillRoundRect(bodyX, bodyY, bodyW, bodyH, 10, TFT_NAVY);
-  M5.Display.fillRoundRect(bodyX + 14, iconRect.y + 6, bodyW - 28, 16, 5, TFT_NAVY);
-  M5.Display.fillCircle(iconRect.x + iconRect.w / 2, bodyY + bodyH / 2, 17, TFT_WHITE);
-  M5.Display.fillCircle(iconRect.x + iconRect.w / 2, bodyY + bodyH / 2, 8, TFT_NAVY);
+  surface().fillRoundRect(bodyX, bodyY, bodyW, bodyH, 10, TFT_NAVY);
+  surface().fillRoundRect(bodyX + 14, iconRect.y + 6, bodyW - 28, 16, 5, TFT_NAVY);
+  surface().fillCircle(iconRect.x + iconRect.w / 2, bodyY + bodyH / 2, 17, TFT_WHITE);
+  surface().fillCircle(iconRect.x + iconRect.w / 2, bodyY + bodyH / 2, 8, TFT_NAVY);
 }
 
+/**
+ * モード選択ボタンのアイコンを描画する関数です。
+ */
+using ModeIconDrawer = void (*)(const Rect& iconRect);
+
 /**
  * モード選択ボタンの共通枠を描画します。
  */
-void drawModeButtonFrame(const Rect& buttonRect, const String& label) {
-  M5.Display.fillRoundRect(buttonRect.x, buttonRect.y, buttonRect.w, buttonRect.h, 10, TFT_WHITE);
-  M5.Display.drawRoundRect(buttonRect.x, buttonRect.y, buttonRect.w, buttonRect.h, 10, TFT_DARKGREY);
+void drawModeButtonFrame(const Rect& buttonRect, const char* label, const ModeIconDrawer drawIcon) {
+  surface().fillRoundRect(buttonRect.x, buttonRect.y, buttonRect.w, buttonRect.h, 10, TFT_WHITE);
+  surface().drawRoundRect(buttonRect.x, buttonRect.y, buttonRect.w, buttonRect.h, 10, TFT_DARKGREY);
 
   const Rect iconRect{
     buttonRect.x + (buttonRect.w - MODE_ICON_SIZE) / 2,
@@ -161,52 +178,80 @@ void drawModeButtonFrame(const Rect& buttonRect, const String& label) {
     MODE_ICON_SIZE,
     MODE_ICON_SIZE,
   };
+  drawIcon(iconRect);
 
-  if (label == "おうちレジ") {
-    drawRegisterModeIcon(iconRect);
-  } else {
-    drawCameraModeIcon(iconRect);
-  }
-
-  M5.Display.setCursor(
-    buttonRect.x + (buttonRect.w - M5.Display.textWidth(label)) / 2,
+  surface().setCursor(
+    buttonRect.x + (buttonRect.w - surface().textWidth(label)) / 2,
     iconRect.y + iconRect.h + MODE_LABEL_GAP_Y
   );
-  M5.Display.print(label);
+  surface().print(label);
 }
 
 /**
  * 起動モード選択画面を描画します。
+ * ※初回に描いた画面を保存し、モードから戻るときは保存した画面を1回のDMA転送で表示します。
  */
 void renderModeSelectionScreen() {
+  if (ModeBase::presentCachedScreen(ModeBase::CachedScreen::MODE_SELECTION)) {
+    return;
+  }
+
   const Rect registerButtonRect = getRegisterModeButtonRect();
   const Rect cameraButtonRect = getCameraModeButtonRect();
 
-  M5.Display.fillScreen(TFT_WHITE);
-  M5.Display.setFont(BODY_FONT);
-  M5.Display.setTextColor(TFT_BLACK, TFT_WHITE);
+  surface().fillScreen(TFT_WHITE);
+  surface().setFont(BODY_FONT);
+  surface().setTextColor(TFT_BLACK, TFT_WHITE);
   drawCenteredText("モードを選ぶ", MODE_TITLE_Y + 8);
 
-  drawModeButtonFrame(registerButtonRect, "おうちレジ");
-  drawModeButtonFrame(cameraButtonRect, "カメラ");
+  drawModeButtonFrame(registerButtonRect, "おうちレジ", drawRegisterModeIcon);
+  drawModeButtonFrame(cameraButtonRect, "カメラ", drawCameraModeIcon);
+  ModeBase::cacheScreen(ModeBase::CachedScreen::MODE_SELECTION);
+  ModeBase::frameCompositor().present();
+}
+
+/**
+ * 現在のモードを終了し、指定したモードへ切り替えます。
+ * ※入力処理タスクの読み取り先を先に外し、読み取り中の周回が終わるのを待ってから終了処理を行います。
+ */
+void switchToMode(const AppMode nextAppMode, ModeBase* nextMode) {
+  if (activeMode != nullptr && activeMode != nextMode) {
+    ModeBase::inputPipeline().setActiveMode(nullptr);
+    activeMode->exit();
+  }
+
+  appMode = nextAppMode;
+  activeMode = nextMode;
+  ModeBase::inputPipeline().setActiveMode(activeMode);
+  activeMode->enter();
+}
+
+/**
+ * 現在のモードを終了し、起動モード選択画面へ戻ります。
+ */
+void switchToModeSelection() {
+  if (activeMode != nullptr) {
+    ModeBase::inputPipeline().setActiveMode(nullptr);
+    activeMode->exit();
+  }
+
+  appMode = AppMode::SELECT;
+  activeMode = nullptr;
+  renderModeSelectionScreen();
 }
 
 /**
  * おうちレジモードへ切り替えます。
  */
 void switchToRegisterMode() {
-  appMode = AppMode::REGISTER;
-  activeMode = &registerMode;
-  activeMode->enter();
+  switchToMode(AppMode::REGISTER, &registerMode);
 }
 
 /**
  * カメラモードへ切り替えます。
  */
 void switchToCameraMode() {
-  appMode = AppMode::CAMERA;
-  activeMode = &cameraMode;
-  activeMode->enter();
+  switchToMode(AppMode::CAMERA, &cameraMode);
 }
 
 /**
@@ -226,25 +271,72 @@ void handleModeSelectionTouch(const int touchX, const int touchY) {
 }
 
 /**
- * タップ入力を現在モードへ振り分けます。
+ * タッチ操作を現在モードへ振り分けます。
+ * ※起動モード選択画面ではスワイプを無視し、タップと長押しでモードを選びます。
  */
-void pollTouchInput() {
-  int32_t touchX = 0;
-  int32_t touchY = 0;
-  const bool isTouching = M5.Display.getTouch(&touchX, &touchY);
+void dispatchTouchEvent(const TouchEvent& event) {
+  if (appMode == AppMode::SELECT) {
+    if (event.gesture != TouchGesture::SWIPE) {
+      handleModeSelectionTouch(event.x, event.y);
+    }
+  } else if (activeMode != nullptr) {
+    activeMode->onTouchEvent(event);
+  }
+}
 
-  if (!isTouching || wasTouching) {
-    wasTouching = isTouching;
-    return;
+/**
+ * モードから選択画面へ戻る依頼があれば切り替えます。
+ * ※モードの処理中には切り替えず、イベントを1件処理し終えてから選択画面へ戻ります。
+ */
+void handleModeSelectionRequest() {
+  if (ModeBase::takeModeSelectionRequest()) {
+    switchToModeSelection();
   }
+}
 
-  if (appMode == AppMode::SELECT) {
-    handleModeSelectionTouch(touchX, touchY);
-  } else if (activeMode != nullptr) {
-    activeMode->onTouch(touchX, touchY);
+/**
+ * 入力処理タスクとタッチ処理タスクから届いたイベントを現在モードへ振り分けます。
+ */
+void dispatchInputEvents() {
+  TouchEvent touchEvent;
+  while (ModeBase::inputPipeline().popTouchEvent(touchEvent)) {
+    dispatchTouchEvent(touchEvent);
+    handleModeSelectionRequest();
   }
 
-  wasTouching = isTouching;
+  InputEvent event;
+  while (ModeBase::inputPipeline().popEvent(event)) {
+    if (activeMode != nullptr) {
+      activeMode->onInputEvent(event);
+    }
+    handleModeSelectionRequest();
+  }
+}
+
+/**
+ * 入力イベントと期限に達したジョブを処理します。
+ */
+void runLoopPass() {
+  const ScopedTimer timer(PerfSection::LOOP);
+  ModeBase::updateTonePlayer();
+  dispatchInputEvents();
+  ModeBase::scheduler().runDue(millis());
+  ModeBase::frameCompositor().finishCompletedTransfer();
+}
+
+/**
+ * 次の期限か入力イベントまで画面処理タスクを休ませます。
+ */
+void waitForNextWork() {
+  const uint32_t nowMs = millis();
+  uint32_t waitMs = ModeBase::scheduler().getWaitMs(nowMs, LOOP_MAX_WAIT_MS);
+  waitMs = ModeBase::getTonePlayerWaitMs(nowMs, waitMs);
+
+  // 転送中はSPIバスを占有しているため、完了後すぐに解放できるよう短く休みます。
+  if (ModeBase::frameCompositor().isTransferPending()) {
+    waitMs = std::min<uint32_t>(waitMs, 1);
+  }
+  ModeBase::inputPipeline().waitForEvent(waitMs);
 }
 
 }  // namespace
@@ -258,21 +350,22 @@ void setup() {
   initializeUi();
 
   Serial.begin(USB_SERIAL_BAUD);
+  Logger::instance().begin();
 
   const RegisterMode::Pins pins = resolvePeripheralPins();
   registerMode.initialize(pins);
 
+  // 選択画面を先に表示し、周辺機器の初期化は入力処理タスクで並行して進めます。
   renderModeSelectionScreen();
+  ModeBase::inputPipeline().addBootMode(&registerMode);
+  ModeBase::inputPipeline().begin();
 }
 
 /**
  * メインループ処理を行います。
+ * ※処理がない間は休み、計測には休止を含めません。
  */
 void loop() {
-  M5.update();
-  pollTouchInput();
-
-  if (activeMode != nullptr) {
-    activeMode->update();
-  }
+  runLoopPass();
+  waitForNextWork();
 }
@@ -0,0 +1,114 @@
+#include "latency-histogram.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+/**
+ * 空の集計を初期化します。
+ */
+LatencyHistogram::LatencyHistogram()
+: count_(0),
+  minUs_(UINT32_MAX),
+  maxUs_(0),
+  totalUs_(0),
+  buckets_() {
+}
+
+/**
+ * 所要時間を1件記録します。
+ */
+void LatencyHistogram::record(const uint32_t elapsedUs) {
+  ++count_;
+  totalUs_ += elapsedUs;
+  minUs_ = std::min(minUs_, elapsedUs);
+  maxUs_ = std::max(maxUs_, elapsedUs);
+  ++buckets_[getBucketIndex(elapsedUs)];
+}
+
+/**
+ * 集計を破棄します。
+ */
+void LatencyHistogram::reset() {
+  count_ = 0;
+  minUs_ = UINT32_MAX;
+  maxUs_ = 0;
+  totalUs_ = 0;
+  memset(buckets_, 0, sizeof(buckets_));
+}
+
+/**
+ * 記録件数を返します。
+ */
+uint32_t LatencyHistogram::getCount() const {
+  return count_;
+}
+
+/**
+ * 最小値を返します。
+ * ※記録がない場合は0を返します。
+ */
+uint32_t LatencyHistogram::getMinUs() const {
+  return count_ == 0 ? 0 : minUs_;
+}
+
+/**
+ * 平均値を返します。
+ * ※記録がない場合は0を返します。
+ */
+uint32_t LatencyHistogram::getAverageUs() const {
+  return count_ == 0 ? 0 : static_cast<uint32_t>(totalUs_ / count_);
+}
+
+/**
+ * 最大値を返します。
+ */
+uint32_t LatencyHistogram::getMaxUs() const {
+  return maxUs_;
+}
+
+/**
+ * 指定パーセンタイル値を区分の上限値で返します。
+ */
+uint32_t LatencyHistogram::getPercentileUs(const uint32_t percentile) const {
+  const uint64_t target = (static_cast<uint64_t>(count_) * percentile + 99) / 100;
+  uint64_t cumulative = 0;
+
+  for (size_t index = 0; index < BUCKET_COUNT; ++index) {
+    cumulative += buckets_[index];
+    if (cumulative >= target && cumulative > 0) {
+      return std::min(getBucketUpperBoundUs(index), maxUs_);
+    }
+  }
+
+  return maxUs_;
+}
+
+/**
+ * 所要時間を格納する区分番号を返します。
+ * ※1オクターブを2区分に分けた対数目盛です。
+ */
+size_t LatencyHistogram::getBucketIndex(const uint32_t elapsedUs) {
+  if (elapsedUs == 0) {
+    return 0;
+  }
+
+  const int octave = 31 - __builtin_clz(elapsedUs);
+  const int half = octave == 0 ? 0 : static_cast<int>((elapsedUs >> (octave - 1)) & 1U);
+  return static_cast<size_t>(1 + octave * 2 + half);
+}
+
+/**
+ * 区分の上限値を返します。
+ */
+uint32_t LatencyHistogram::getBucketUpperBoundUs(const size_t bucketIndex) {
+  if (bucketIndex == 0) {
+    return 0;
+  }
+
+  const int octave = static_cast<int>((bucketIndex - 1) / 2);
+  const int half = static_cast<int>((bucketIndex - 1) % 2);
+  const uint64_t octaveStart = 1ULL << octave;
+  const uint64_t upperBound = octaveStart + (octaveStart / 2) * (half + 1) - 1;
+  return static_cast<uint32_t>(std::min<uint64_t>(std::max(upperBound, octaveStart), UINT32_MAX));
+}
@@ -0,0 +1,75 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 所要時間の件数・最小・平均・最大とパーセンタイルを固定長の対数ヒストグラムで集計します。
+ */
+class LatencyHistogram {
+ public:
+  static constexpr size_t BUCKET_COUNT = 65;
+
+  /**
+   * 空の集計を初期化します。
+   */
+  LatencyHistogram();
+
+  /**
+   * 所要時間を1件記録します。
+   */
+  void record(uint32_t elapsedUs);
+
+  /**
+   * 集計を破棄します。
+   */
+  void reset();
+
+  /**
+   * 記録件数を返します。
+   */
+  uint32_t getCount() const;
+
+  /**
+   * 最小値を返します。
+   * ※記録がない場合は0を返します。
+   */
+  uint32_t getMinUs() const;
+
+  /**
+   * 平均値を返します。
+   * ※記録がない場合は0を返します。
+   */
+  uint32_t getAverageUs() const;
+
+  /**
+   * 最大値を返します。
+   */
+  uint32_t getMaxUs() const;
+
+  /**
+   * 指定パーセンタイル値を区分の上限値で返します。
+   */
+  uint32_t getPercentileUs(uint32_t percentile) const;
+
+ private:
+  /**
+   * 所要時間を格納する区分番号を返します。
+   * ※1オクターブを2区分に分けた対数目盛です。
+   */
+  static size_t getBucketIndex(uint32_t elapsedUs);
+
+  /**
+   * 区分の上限値を返します。
+   */
+  static uint32_t getBucketUpperBoundUs(size_t bucketIndex);
+
+  uint32_t count_;
+  uint32_t minUs_;
+  uint32_t maxUs_;
+  uint64_t totalUs_;
+  uint32_t buckets_[BUCKET_COUNT];
+};
+
+#endif
@@ -0,0 +1,316 @@
+#include "load-generator.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "input-pipeline.h"
+#include "logger.h"
+
+namespace {
+
+constexpr uint32_t FINISH_IDLE_TIMEOUT_MS = 2000;
+constexpr uint32_t MAX_RATE_HZ = 100000;
+constexpr uint32_t RECORDING_GAP_CAP_MS = 10000;
+
+/**
+ * 負荷試験の種類名を返します。
+ */
+const char* getLoadKindName(const LoadKind kind) {
+  switch (kind) {
+    case LoadKind::BARCODE:
+      return "bc";
+    case LoadKind::RFID:
+      return "rfid";
+    case LoadKind::REPLAY:
+      return "replay";
+  }
+
+  return "unknown";
+}
+
+}  // namespace
+
+/**
+ * 停止状態で初期化します。
+ */
+LoadGenerator::LoadGenerator()
+: recording_(),
+  replay_(),
+  replayAtMs_(),
+  recordingStart_(0),
+  recordingCount_(0),
+  recordingLastAtMs_(0),
+  kind_(LoadKind::BARCODE),
+  totalCount_(0),
+  rateHz_(0),
+  speedPercent_(100),
+  startedAtUs_(0),
+  issuedCount_(0),
+  isActive_(false),
+  isPublishing_(false),
+  isStopRequested_(false),
+  sentCount_(0),
+  droppedCount_(0),
+  handledCount_(0),
+  lastHandledAtUs_(0),
+  lastProgressAtMs_(0),
+  latency_() {
+}
+
+/**
+ * 連番の疑似入力を指定件数・指定レートで発行し始め、開始できたかを返します。
+ */
+bool LoadGenerator::startSynthetic(const LoadKind kind, const uint32_t count, const uint32_t rateHz) {
+  if (isActive() || isPublishing_.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  if (kind == LoadKind::REPLAY || count == 0 || rateHz == 0) {
+    return false;
+  }
+
+  beginRun(kind, count, std::min(rateHz, MAX_RATE_HZ), 100);
+  LOG_INFO(
+    PERF,
+    "bench start kind=%s count=%lu rate=%luHz",
+    getLoadKindName(kind_),
+    static_cast<unsigned long>(totalCount_),
+    static_cast<unsigned long>(rateHz_)
+  );
+  return true;
+}
+
+/**
+ * 記録済みの実スキャンを元の間隔の指定倍速で発行し始め、開始できたかを返します。
+ * ※speedPercentは100で等速です。
+ */
+bool LoadGenerator::startReplay(const uint32_t speedPercent) {
+  if (isActive() || isPublishing_.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  if (recordingCount_ == 0 || speedPercent == 0) {
+    return false;
+  }
+
+  // 記録は実スキャンのたびに更新されるため、再生分を別領域へ写してから渡します。
+  uint32_t atMs = 0;
+  for (size_t index = 0; index < recordingCount_; ++index) {
+    replay_[index] = recording_[(recordingStart_ + index) % RECORDING_CAPACITY];
+    atMs += index == 0 ? 0 : replay_[index].gapMs;
+    replayAtMs_[index] = static_cast<uint32_t>(static_cast<uint64_t>(atMs) * 100 / speedPercent);
+  }
+
+  beginRun(LoadKind::REPLAY, static_cast<uint32_t>(recordingCount_), 0, speedPercent);
+  LOG_INFO(
+    PERF,
+    "bench start kind=replay count=%lu speed=%lu%%",
+    static_cast<unsigned long>(totalCount_),
+    static_cast<unsigned long>(speedPercent_)
+  );
+  return true;
+}
+
+/**
+ * 発行を打ち切り、届いた分だけで集計を締めます。
+ */
+void LoadGenerator::stop() {
+  if (!isActive()) {
+    return;
+  }
+
+  isStopRequested_.store(true, std::memory_order_release);
+}
+
+/**
+ * 実スキャンのコードと受付時刻を再生用に記録します。
+ * ※負荷試験中の入力は記録しません。
+ */
+void LoadGenerator::recordScan(const char* code, const size_t length) {
+  if (isActive()) {
+    return;
+  }
+
+  const uint32_t nowMs = millis();
+  const uint32_t gapMs = recordingCount_ == 0 ? 0 : std::min(nowMs - recordingLastAtMs_, RECORDING_GAP_CAP_MS);
+  recordingLastAtMs_ = nowMs;
+
+  size_t slot = (recordingStart_ + recordingCount_) % RECORDING_CAPACITY;
+  if (recordingCount_ < RECORDING_CAPACITY) {
+    ++recordingCount_;
+  } else {
+    slot = recordingStart_;
+    recordingStart_ = (recordingStart_ + 1) % RECORDING_CAPACITY;
+  }
+
+  RecordedScan& scan = recording_[slot];
+  const size_t copyLength = std::min(length, CODE_CAPACITY - 1);
+  scan.gapMs = gapMs;
+  memcpy(scan.code, code, copyLength);
+  scan.code[copyLength] = '\0';
+}
+
+/**
+ * 発行時刻に達した疑似入力を入力イベントとして発行します。
+ * ※入力処理タスクからのみ呼び出します。
+ */
+void LoadGenerator::poll(InputPipeline& pipeline) {
+  if (!isPublishing_.load(std::memory_order_acquire) || !isActive_.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  if (isStopRequested_.load(std::memory_order_acquire)) {
+    isPublishing_.store(false, std::memory_order_release);
+    return;
+  }
+
+  // 1回の呼び出しで発行する件数を抑え、キューの空きと他の入力の処理を待てるようにします。
+  const uint32_t dueCount = getDueCount(micros() - startedAtUs_);
+  const InputEventType type = kind_ == LoadKind::RFID ? InputEventType::RFID : InputEventType::BARCODE;
+  char text[CODE_CAPACITY];
+  for (size_t burst = 0; burst < PUBLISH_BURST_LIMIT && issuedCount_ < dueCount; ++burst) {
+    const size_t length = formatInput(issuedCount_, text, sizeof(text));
+    if (pipeline.publishSyntheticText(type, text, length)) {
+      sentCount_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      droppedCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    ++issuedCount_;
+  }
+
+  if (issuedCount_ >= totalCount_) {
+    isPublishing_.store(false, std::memory_order_release);
+  }
+}
+
+/**
+ * 疑似入力1件の処理完了と発行からの所要時間を記録します。
+ */
+void LoadGenerator::recordHandled(const uint32_t latencyUs) {
+  ++handledCount_;
+  lastHandledAtUs_ = micros();
+  lastProgressAtMs_ = millis();
+  latency_.record(latencyUs);
+}
+
+/**
+ * 負荷試験の実行中かを返します。
+ */
+bool LoadGenerator::isActive() const {
+  return isActive_.load(std::memory_order_acquire);
+}
+
+/**
+ * 発行と処理が出そろっていれば結果をログへ書き出して終了し、終了したかを返します。
+ */
+bool LoadGenerator::tryFinish() {
+  if (!isActive() || isPublishing_.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  // 状態によって捨てられた入力もあるため、一定時間届かなければ届いた分で締めます。
+  const uint32_t sentCount = sentCount_.load(std::memory_order_relaxed);
+  if (handledCount_ < sentCount && millis() - lastProgressAtMs_ < FINISH_IDLE_TIMEOUT_MS) {
+    return false;
+  }
+
+  report();
+  isActive_.store(false, std::memory_order_release);
+  return true;
+}
+
+/**
+ * 集計を初期化し、入力処理タスクへ発行を開始させます。
+ */
+void LoadGenerator::beginRun(
+  const LoadKind kind,
+  const uint32_t count,
+  const uint32_t rateHz,
+  const uint32_t speedPercent
+) {
+  kind_ = kind;
+  totalCount_ = count;
+  rateHz_ = rateHz;
+  speedPercent_ = speedPercent;
+  issuedCount_ = 0;
+  sentCount_.store(0, std::memory_order_relaxed);
+  droppedCount_.store(0, std::memory_order_relaxed);
+  handledCount_ = 0;
+  latency_.reset();
+  startedAtUs_ = micros();
+  lastHandledAtUs_ = startedAtUs_;
+  lastProgressAtMs_ = millis();
+  isStopRequested_.store(false, std::memory_order_relaxed);
+  isPublishing_.store(true, std::memory_order_relaxed);
+
+  // 設定を書き終えてから入力処理タスクへ公開します。
+  isActive_.store(true, std::memory_order_release);
+}
+
+/**
+ * 発行済みにすべき件数を経過時間から返します。
+ */
+uint32_t LoadGenerator::getDueCount(const uint32_t elapsedUs) const {
+  if (kind_ == LoadKind::REPLAY) {
+    const uint32_t elapsedMs = elapsedUs / 1000;
+    uint32_t dueCount = issuedCount_;
+    while (dueCount < totalCount_ && replayAtMs_[dueCount] <= elapsedMs) {
+      ++dueCount;
+    }
+    return dueCount;
+  }
+
+  const uint64_t dueCount = static_cast<uint64_t>(elapsedUs) * rateHz_ / 1000000ULL + 1;
+  return static_cast<uint32_t>(std::min<uint64_t>(dueCount, totalCount_));
+}
+
+/**
+ * 指定番号の疑似入力を書き出し、文字数を返します。
+ */
+size_t LoadGenerator::formatInput(const uint32_t index, char* buffer, const size_t bufferSize) const {
+  int length = 0;
+  switch (kind_) {
+    case LoadKind::BARCODE:
+      length = snprintf(buffer, bufferSize, "49%011lu", static_cast<unsigned long>(index));
+      break;
+    case LoadKind::RFID:
+      length = snprintf(buffer, bufferSize, "BE%06lX", static_cast<unsigned long>(index & 0xFFFFFFUL));
+      break;
+    case LoadKind::REPLAY:
+      length = snprintf(buffer, bufferSize, "%s", replay_[index].code);
+      break;
+  }
+
+  return static_cast<size_t>(std::max(std::min(length, static_cast<int>(bufferSize) - 1), 0));
+}
+
+/**
+ * 結果をログへ書き出します。
+ */
+void LoadGenerator::report() const {
+  const uint32_t sentCount = sentCount_.load(std::memory_order_relaxed);
+  const uint32_t droppedCount = droppedCount_.load(std::memory_order_relaxed);
+  const uint32_t elapsedUs = std::max<uint32_t>(lastHandledAtUs_ - startedAtUs_, 1);
+
+  LOG_INFO(
+    PERF,
+    "bench done kind=%s sent=%lu dropped=%lu handled=%lu elapsed=%lums throughput=%.1f/s",
+    getLoadKindName(kind_),
+    static_cast<unsigned long>(sentCount),
+    static_cast<unsigned long>(droppedCount),
+    static_cast<unsigned long>(handledCount_),
+    static_cast<unsigned long>(elapsedUs / 1000),
+    handledCount_ * 1000000.0f / elapsedUs
+  );
+  LOG_INFO(
+    PERF,
+    "bench latency min=%luus p50<=%luus p90<=%luus p99<=%luus max=%luus",
+    static_cast<unsigned long>(latency_.getMinUs()),
+    static_cast<unsigned long>(latency_.getPercentileUs(50)),
+    static_cast<unsigned long>(latency_.getPercentileUs(90)),
+    static_cast<unsigned long>(latency_.getPercentileUs(99)),
+    static_cast<unsigned long>(latency_.getMaxUs())
+  );
+}
@@ -0,0 +1,128 @@
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "latency-histogram.h"
+
+class InputPipeline;
+
+/**
+ * 負荷試験で発行する入力の種類です。
+ */
+enum class LoadKind : uint8_t {
+  BARCODE,
+  RFID,
+  REPLAY,
+};
+
+/**
+ * 入力処理タスクから疑似入力を指定レートで発行し、処理結果を集計します。
+ * ※開始・集計は画面処理タスク、発行は入力処理タスクから呼び出します。
+ */
+class LoadGenerator {
+ public:
+  static constexpr size_t RECORDING_CAPACITY = 32;
+  static constexpr size_t CODE_CAPACITY = 32;
+  static constexpr size_t PUBLISH_BURST_LIMIT = 16;
+
+  /**
+   * 停止状態で初期化します。
+   */
+  LoadGenerator();
+
+  /**
+   * 連番の疑似入力を指定件数・指定レートで発行し始め、開始できたかを返します。
+   */
+  bool startSynthetic(LoadKind kind, uint32_t count, uint32_t rateHz);
+
+  /**
+   * 記録済みの実スキャンを元の間隔の指定倍速で発行し始め、開始できたかを返します。
+   * ※speedPercentは100で等速です。
+   */
+  bool startReplay(uint32_t speedPercent);
+
+  /**
+   * 発行を打ち切り、届いた分だけで集計を締めます。
+   */
+  void stop();
+
+  /**
+   * 実スキャンのコードと受付時刻を再生用に記録します。
+   * ※負荷試験中の入力は記録しません。
+   */
+  void recordScan(const char* code, size_t length);
+
+  /**
+   * 発行時刻に達した疑似入力を入力イベントとして発行します。
+   * ※入力処理タスクからのみ呼び出します。
+   */
+  void poll(InputPipeline& pipeline);
+
+  /**
+   * 疑似入力1件の処理完了と発行からの所要時間を記録します。
+   */
+  void recordHandled(uint32_t latencyUs);
+
+  /**
+   * 負荷試験の実行中かを返します。
+   */
+  bool isActive() const;
+
+  /**
+   * 発行と処理が出そろっていれば結果をログへ書き出して終了し、終了したかを返します。
+   */
+  bool tryFinish();
+
+ private:
+  struct RecordedScan {
+    uint32_t gapMs;
+    char code[CODE_CAPACITY];
+  };
+
+  /**
+   * 集計を初期化し、入力処理タスクへ発行を開始させます。
+   */
+  void beginRun(LoadKind kind, uint32_t count, uint32_t rateHz, uint32_t speedPercent);
+
+  /**
+   * 発行済みにすべき件数を経過時間から返します。
+   */
+  uint32_t getDueCount(uint32_t elapsedUs) const;
+
+  /**
+   * 指定番号の疑似入力を書き出し、文字数を返します。
+   */
+  size_t formatInput(uint32_t index, char* buffer, size_t bufferSize) const;
+
+  /**
+   * 結果をログへ書き出します。
+   */
+  void report() const;
+
+  RecordedScan recording_[RECORDING_CAPACITY];
+  RecordedScan replay_[RECORDING_CAPACITY];
+  uint32_t replayAtMs_[RECORDING_CAPACITY];
+  size_t recordingStart_;
+  size_t recordingCount_;
+  uint32_t recordingLastAtMs_;
+  LoadKind kind_;
+  uint32_t totalCount_;
+  uint32_t rateHz_;
+  uint32_t speedPercent_;
+  uint32_t startedAtUs_;
+  uint32_t issuedCount_;
+  std::atomic<bool> isActive_;
+  std::atomic<bool> isPublishing_;
+  std::atomic<bool> isStopRequested_;
+  std::atomic<uint32_t> sentCount_;
+  std::atomic<uint32_t> droppedCount_;
+  uint32_t handledCount_;
+  uint32_t lastHandledAtUs_;
+  uint32_t lastProgressAtMs_;
+  LatencyHistogram latency_;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "logger.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+/**
+ * 共有のロガーを返します。
+ */
+Logger& Logger::instance() {
+  static Logger logger;
+  return logger;
+}
+
+/**
+ * ロガーを初期化します。
+ */
+Logger::Logger()
+: mutex_(nullptr),
+  line_(),
+  ring_(),
+  ringStart_(0),
+  ringLength_(0),
+  droppedLineCount_(0) {
+}
+
+/**
+ * 排他制御を初期化します。
+ * ※begin前のログは破棄します。
+ */
+bool Logger::begin() {
+  if (mutex_ == nullptr) {
+    mutex_ = xSemaphoreCreateMutex();
+  }
+
+  return mutex_ != nullptr;
+}
+
+/**
+ * 分類名を付けた1行を整形してリングバッファへ追加します。
+ * ※空きが足りない場合は行ごと破棄します。
+ */
+void Logger::write(const char* category, const char* format, ...) {
+  if (mutex_ == nullptr) {
+    return;
+  }
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+
+  // 末尾の改行分を残して整形し、収まらない本文は切り詰めます。
+  const int prefixLength = snprintf(line_, LINE_CAPACITY - 1, "[%s] ", category);
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line_ + prefixLength, LINE_CAPACITY - 1 - prefixLength, format, args);
+  va_end(args);
+
+  size_t lineLength = strlen(line_);
+  line_[lineLength++] = '\n';
+
+  if (lineLength > RING_CAPACITY - ringLength_) {
+    ++droppedLineCount_;
+    xSemaphoreGive(mutex_);
+    return;
+  }
+
+  const size_t tail = (ringStart_ + ringLength_) % RING_CAPACITY;
+  const size_t firstLength = std::min(lineLength, RING_CAPACITY - tail);
+  memcpy(ring_ + tail, line_, firstLength);
+  memcpy(ring_, line_ + firstLength, lineLength - firstLength);
+  ringLength_ += lineLength;
+
+  xSemaphoreGive(mutex_);
+}
+
+/**
+ * 送信バッファの空き分だけリングバッファの内容を書き出します。
+ * ※書き出し先が詰まっていても待たずに戻ります。
+ */
+void Logger::drain(Print& output) {
+  if (mutex_ == nullptr) {
+    return;
+  }
+
+  xSemaphoreTake(mutex_, portMAX_DELAY);
+
+  while (ringLength_ > 0) {
+    const int writable = output.availableForWrite();
+    if (writable <= 0) {
+      break;
+    }
+
+    const size_t chunkLength = std::min(
+      std::min(ringLength_, RING_CAPACITY - ringStart_),
+      static_cast<size_t>(writable)
+    );
+    const size_t writtenLength = output.write(reinterpret_cast<const uint8_t*>(ring_ + ringStart_), chunkLength);
+    if (writtenLength == 0) {
+      break;
+    }
+
+    ringStart_ = (ringStart_ + writtenLength) % RING_CAPACITY;
+    ringLength_ -= writtenLength;
+  }
+
+  xSemaphoreGive(mutex_);
+}
+
+/**
+ * 空き不足で破棄した行数を返します。
+ */
+uint32_t Logger::getDroppedLineCount() const {
+  return droppedLineCount_;
+}
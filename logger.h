@@ -0,0 +1,109 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+/**
+ * ログ出力の重要度です。
+ * ※LOG_LEVEL未満のログは引数ごとコンパイル時に取り除かれます。
+ */
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+/**
+ * ログ出力の分類です。
+ * ※LOG_CATEGORIESに含まれない分類のログは引数ごとコンパイル時に取り除かれます。
+ */
+#define LOG_CATEGORY_BC 0x01
+#define LOG_CATEGORY_RFID 0x02
+#define LOG_CATEGORY_CAM 0x04
+#define LOG_CATEGORY_BOOT 0x08
+#define LOG_CATEGORY_PERF 0x10
+#define LOG_CATEGORY_TRACE 0x20
+#define LOG_CATEGORY_JOURNAL 0x40
+
+#ifndef LOG_CATEGORIES
+#define LOG_CATEGORIES ( \
+  LOG_CATEGORY_BC | LOG_CATEGORY_RFID | LOG_CATEGORY_CAM | LOG_CATEGORY_BOOT | LOG_CATEGORY_PERF | LOG_CATEGORY_TRACE | \
+  LOG_CATEGORY_JOURNAL \
+)
+#endif
+
+#define LOG_IS_ENABLED(level, category) ((level) >= LOG_LEVEL && ((category) & (LOG_CATEGORIES)) != 0)
+
+/**
+ * printf形式でログを書き込みます。
+ * ※無効なログは条件が定数のため、引数の評価を含めて最適化で消えます。
+ */
+#define LOG_AT(level, category, ...) \
+  do { \
+    if (LOG_IS_ENABLED(level, LOG_CATEGORY_##category)) { \
+      Logger::instance().write(#category, __VA_ARGS__); \
+    } \
+  } while (0)
+
+#define LOG_DEBUG(category, ...) LOG_AT(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG_AT(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#define LOG_WARN(category, ...) LOG_AT(LOG_LEVEL_WARN, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG_AT(LOG_LEVEL_ERROR, category, __VA_ARGS__)
+
+/**
+ * 複数タスクからのログを固定長のリングバッファへ溜め、空き時間にシリアルへ書き出します。
+ */
+class Logger {
+ public:
+  static constexpr size_t LINE_CAPACITY = 160;
+  static constexpr size_t RING_CAPACITY = 4096;
+
+  /**
+   * 共有のロガーを返します。
+   */
+  static Logger& instance();
+
+  /**
+   * 排他制御を初期化します。
+   * ※begin前のログは破棄します。
+   */
+  bool begin();
+
+  /**
+   * 分類名を付けた1行を整形してリングバッファへ追加します。
+   * ※空きが足りない場合は行ごと破棄します。
+   */
+  void write(const char* category, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+  /**
+   * 送信バッファの空き分だけリングバッファの内容を書き出します。
+   * ※書き出し先が詰まっていても待たずに戻ります。
+   */
+  void drain(Print& output);
+
+  /**
+   * 空き不足で破棄した行数を返します。
+   */
+  uint32_t getDroppedLineCount() const;
+
+ private:
+  /**
+   * ロガーを初期化します。
+   */
+  Logger();
+
+  SemaphoreHandle_t mutex_;
+  char line_[LINE_CAPACITY];
+  char ring_[RING_CAPACITY];
+  size_t ringStart_;
+  size_t ringLength_;
+  uint32_t droppedLineCount_;
+};
+
+#endif
@@ -1,20 +1,264 @@
 #include "mode-base.h"
 
-#include <M5Unified.h>
-
+#include "logger.h"
 #include "register-config.h"
 
+namespace {
+
+// 音ステップ列を起動時にPCMへ合成し、スピーカーのDMA再生で鳴らします。
+constexpr bool ENABLE_PCM_TONE_CLIPS = true;
+// ModeBase::Toneの並びと揃えます。
+// ※ステップ列はヘッダの定数のため翻訳単位ごとに別の実体になります。音はこの表の番号で引きます。
+constexpr const ToneStep* TONE_SOURCES[] = {
+  SCAN_TONE_STEPS,
+  PAYMENT_TONE_STEPS,
+  STARTUP_TONE_STEPS,
+  SHUTTER_TONE_STEPS,
+  ERROR_TONE_STEPS,
+};
+constexpr size_t TONE_COUNT = sizeof(TONE_SOURCES) / sizeof(TONE_SOURCES[0]);
+static_assert(TONE_COUNT <= ToneClipBank::CLIP_CAPACITY, "Every tone must fit in the clip bank");
+static_assert(TONE_COUNT <= 8, "Missed tones are logged with an 8-bit mask");
+
+// モード選択画面に戻るボタンです。押下範囲は指で押しやすいよう周囲へ広げます。
+constexpr int BACK_BUTTON_X = 8;
+constexpr int BACK_BUTTON_Y = 8;
+constexpr int BACK_BUTTON_W = 40;
+constexpr int BACK_BUTTON_H = 38;
+constexpr int BACK_BUTTON_HIT_OUTSET = 8;
+
+}  // namespace
+
 /**
- * 音ステップ列を順番に再生します。
+ * モードから離れる直前の処理を行います。
  */
-void ModeBase::playToneSteps(const ToneStep* steps) {
-  size_t index = 0;
+void ModeBase::exit() {
+}
+
+/**
+ * タッチ処理タスクが認識したタッチ操作を処理します。
+ * ※長押しを扱わないモードでは、押したままでも反応するようタップと同じに扱います。
+ */
+void ModeBase::onTouchEvent(const TouchEvent& event) {
+  if (event.gesture != TouchGesture::SWIPE) {
+    onTouch(event.x, event.y);
+  }
+}
+
+/**
+ * 入力処理タスクで周辺機器の起動処理を1段階進め、完了したかを返します。
+ */
+bool ModeBase::advanceBoot() {
+  return true;
+}
 
-  while (steps[index].durationMs != 0) {
-    M5.Speaker.tone(steps[index].frequencyHz, steps[index].durationMs);
-    if (steps[index].waitMs > 0) {
-      delay(steps[index].waitMs);
+/**
+ * 入力処理タスクで周辺機器を読み取り、入力イベントを発行します。
+ */
+void ModeBase::pollInput(InputPipeline& pipeline) {
+  static_cast<void>(pipeline);
+}
+
+/**
+ * 入力処理タスクから届いた入力イベントを処理します。
+ */
+void ModeBase::onInputEvent(const InputEvent& event) {
+  static_cast<void>(event);
+}
+
+/**
+ * 各モードの音ステップ列をPCMへ合成して登録します。
+ */
+void ModeBase::prepareToneClips() {
+  if (!ENABLE_PCM_TONE_CLIPS) {
+    return;
+  }
+
+  const uint32_t startedAtMs = millis();
+  for (size_t index = 0; index < TONE_COUNT; ++index) {
+    if (!toneClipBank().add(index, TONE_SOURCES[index])) {
+      LOG_WARN(BOOT, "tone clip alloc failed tone=%u", static_cast<unsigned>(index));
     }
-    ++index;
   }
+  LOG_DEBUG(
+    BOOT,
+    "tone clips=%u bytes=%u elapsed=%lums",
+    static_cast<unsigned>(toneClipBank().size()),
+    static_cast<unsigned>(toneClipBank().getTotalBytes()),
+    static_cast<unsigned long>(millis() - startedAtMs)
+  );
+}
+
+/**
+ * モード共通の音再生を進めます。
+ */
+void ModeBase::updateTonePlayer() {
+  tonePlayer().update();
+}
+
+/**
+ * モード共通の音再生が次のステップへ進む期限までの待ち時間を返します。
+ */
+uint32_t ModeBase::getTonePlayerWaitMs(const uint32_t nowMs, const uint32_t maxWaitMs) {
+  return tonePlayer().getWaitMs(nowMs, maxWaitMs);
+}
+
+/**
+ * 描画先の内容を指定した静的な画面として保存します。
+ */
+void ModeBase::cacheScreen(const CachedScreen screen) {
+  if (!frameCompositor().cacheScreen(static_cast<size_t>(screen))) {
+    LOG_DEBUG(BOOT, "screen cache skipped screen=%u", static_cast<unsigned>(screen));
+  }
+}
+
+/**
+ * 保存済みの静的な画面を1回のDMA転送で表示し、表示できたかを返します。
+ */
+bool ModeBase::presentCachedScreen(const CachedScreen screen) {
+  return frameCompositor().presentCachedScreen(static_cast<size_t>(screen));
+}
+
+/**
+ * モード選択画面へ戻る依頼があれば取り消し、依頼があったかを返します。
+ */
+bool ModeBase::takeModeSelectionRequest() {
+  bool& isRequested = modeSelectionRequest();
+  const bool wasRequested = isRequested;
+  isRequested = false;
+  return wasRequested;
+}
+
+/**
+ * モード共通の期限付きジョブ管理を返します。
+ */
+DeadlineScheduler& ModeBase::scheduler() {
+  static DeadlineScheduler deadlineScheduler;
+  return deadlineScheduler;
+}
+
+/**
+ * モード共通の画面合成を返します。
+ */
+FrameCompositor& ModeBase::frameCompositor() {
+  static FrameCompositor compositor;
+  return compositor;
+}
+
+/**
+ * モード共通の入力処理を返します。
+ */
+InputPipeline& ModeBase::inputPipeline() {
+  static InputPipeline pipeline;
+  return pipeline;
+}
+
+/**
+ * 効果音を再生します。
+ * ※合成済みの音がなく矩形波で鳴らした場合は、音ごとに初回だけ記録します。
+ */
+void ModeBase::playTone(const Tone tone) {
+  const size_t index = static_cast<size_t>(tone);
+  if (index >= TONE_COUNT) {
+    return;
+  }
+
+  if (ENABLE_PCM_TONE_CLIPS && toneClipBank().play(index)) {
+    return;
+  }
+
+  static uint8_t loggedMissMask = 0;
+  const uint8_t missBit = static_cast<uint8_t>(1U << index);
+  if (ENABLE_PCM_TONE_CLIPS && (loggedMissMask & missBit) == 0) {
+    loggedMissMask |= missBit;
+    LOG_WARN(BOOT, "tone clip miss tone=%u, playing square wave", static_cast<unsigned>(index));
+  }
+  tonePlayer().play(TONE_SOURCES[index]);
+}
+
+/**
+ * モード共通の合成済みの音を返します。
+ */
+ToneClipBank& ModeBase::toneClipBank() {
+  static ToneClipBank bank;
+  return bank;
+}
+
+/**
+ * モード共通の音再生を返します。
+ */
+TonePlayer& ModeBase::tonePlayer() {
+  static TonePlayer player;
+  return player;
+}
+
+/**
+ * モード共通の描画先を返します。
+ */
+LovyanGFX& ModeBase::surface() {
+  return frameCompositor().surface();
+}
+
+/**
+ * 描画先の内容を画面へ反映します。
+ */
+void ModeBase::presentSurface() {
+  frameCompositor().present();
+}
+
+/**
+ * 描画先の指定行範囲を画面へ反映します。
+ */
+void ModeBase::presentSurfaceRows(const int y, const int h) {
+  frameCompositor().presentRows(y, h);
+}
+
+/**
+ * 保存済みの静的な画面を描画先へ書き戻し、書き戻せたかを返します。
+ */
+bool ModeBase::restoreCachedScreen(const CachedScreen screen) {
+  return frameCompositor().restoreCachedScreen(static_cast<size_t>(screen));
+}
+
+/**
+ * 保存済みの静的な画面のうち指定矩形だけを描画先へ書き戻し、書き戻せたかを返します。
+ */
+bool ModeBase::restoreCachedScreenRect(const CachedScreen screen, const int x, const int y, const int w, const int h) {
+  return frameCompositor().restoreCachedRect(static_cast<size_t>(screen), x, y, w, h);
+}
+
+/**
+ * 現在のモードを終えてモード選択画面へ戻るよう依頼します。
+ */
+void ModeBase::requestModeSelection() {
+  modeSelectionRequest() = true;
+}
+
+/**
+ * 画面左上へモード選択画面に戻るボタンを描画します。
+ */
+void ModeBase::drawBackButton() {
+  const int centerY = BACK_BUTTON_Y + BACK_BUTTON_H / 2;
+  const int tipX = BACK_BUTTON_X + BACK_BUTTON_W / 4;
+  const int baseX = BACK_BUTTON_X + BACK_BUTTON_W - BACK_BUTTON_W / 4;
+  const int halfH = BACK_BUTTON_H / 4;
+
+  surface().fillRoundRect(BACK_BUTTON_X, BACK_BUTTON_Y, BACK_BUTTON_W, BACK_BUTTON_H, 6, TFT_DARKGREY);
+  surface().fillTriangle(tipX, centerY, baseX, centerY - halfH, baseX, centerY + halfH, TFT_WHITE);
+}
+
+/**
+ * 指定座標がモード選択画面に戻るボタンの押下範囲内かを返します。
+ */
+bool ModeBase::isBackButtonTouched(const int touchX, const int touchY) {
+  return touchX < BACK_BUTTON_X + BACK_BUTTON_W + BACK_BUTTON_HIT_OUTSET
+    && touchY < BACK_BUTTON_Y + BACK_BUTTON_H + BACK_BUTTON_HIT_OUTSET;
+}
+
+/**
+ * モード選択画面へ戻る依頼の有無を返します。
+ */
+bool& ModeBase::modeSelectionRequest() {
+  static bool isRequested = false;
+  return isRequested;
 }
@@ -1,11 +1,27 @@
 #ifndef MODE_BASE_H
 #define MODE_BASE_H
 
+#include "deadline-scheduler.h"
+#include "frame-compositor.h"
+#include "input-pipeline.h"
+#include "tone-clip-bank.h"
+#include "tone-player.h"
+
 /**
  * モード共通の契約を定義します。
  */
 class ModeBase {
  public:
+  /**
+   * 一度だけ描いて保存し、以降は保存した内容を転送する静的な画面です。
+   */
+  enum class CachedScreen : uint8_t {
+    MODE_SELECTION,
+    REGISTER_CHROME,
+    THANK_YOU,
+    CAMERA_UNAVAILABLE,
+  };
+
   /**
    * 破棄処理を行います。
    */
@@ -16,21 +32,163 @@ class ModeBase {
    */
   virtual void enter() = 0;
 
+  /**
+   * モードから離れる直前の処理を行います。
+   * ※確保した資源はここで解放するか、次のenterで素早く再開できる状態へ戻します。
+   */
+  virtual void exit();
+
   /**
    * タップ入力を処理します。
    */
   virtual void onTouch(int touchX, int touchY) = 0;
 
   /**
-   * モード固有の更新処理を行います。
+   * タッチ処理タスクが認識したタッチ操作を処理します。
+   * ※既定ではタップと長押しをonTouchへ渡し、スワイプは無視します。
+   */
+  virtual void onTouchEvent(const TouchEvent& event);
+
+  /**
+   * 入力処理タスクで周辺機器の起動処理を1段階進め、完了したかを返します。
+   */
+  virtual bool advanceBoot();
+
+  /**
+   * 入力処理タスクで周辺機器を読み取り、入力イベントを発行します。
+   */
+  virtual void pollInput(InputPipeline& pipeline);
+
+  /**
+   * 入力処理タスクから届いた入力イベントを処理します。
+   */
+  virtual void onInputEvent(const InputEvent& event);
+
+  /**
+   * 各モードの音ステップ列をPCMへ合成して登録します。
+   * ※起動時に1回呼び出します。登録できなかった音はステップごとの矩形波で鳴らします。
+   */
+  static void prepareToneClips();
+
+  /**
+   * モード共通の音再生を進めます。
+   */
+  static void updateTonePlayer();
+
+  /**
+   * モード共通の音再生が次のステップへ進む期限までの待ち時間を返します。
+   */
+  static uint32_t getTonePlayerWaitMs(uint32_t nowMs, uint32_t maxWaitMs);
+
+  /**
+   * 描画先の内容を指定した静的な画面として保存します。
+   * ※保存できない場合は、次回も描画から行います。
+   */
+  static void cacheScreen(CachedScreen screen);
+
+  /**
+   * 保存済みの静的な画面を1回のDMA転送で表示し、表示できたかを返します。
+   */
+  static bool presentCachedScreen(CachedScreen screen);
+
+  /**
+   * モード選択画面へ戻る依頼があれば取り消し、依頼があったかを返します。
+   * ※画面処理タスクで入力イベントを振り分けた後に確認します。
+   */
+  static bool takeModeSelectionRequest();
+
+  /**
+   * モード共通の期限付きジョブ管理を返します。
+   * ※定期処理とタイムアウトはここへ登録し、画面処理タスクのloop()から実行します。
+   */
+  static DeadlineScheduler& scheduler();
+
+  /**
+   * モード共通の画面合成を返します。
    */
-  virtual void update() = 0;
+  static FrameCompositor& frameCompositor();
+
+  /**
+   * モード共通の入力処理を返します。
+   */
+  static InputPipeline& inputPipeline();
 
  protected:
   /**
-   * 音ステップ列を順番に再生します。
+   * モード共通の効果音です。
+   * ※値は合成済みの音の番号を兼ねます。
+   */
+  enum class Tone : uint8_t {
+    SCAN,
+    PAYMENT,
+    STARTUP,
+    SHUTTER,
+    ERROR,
+  };
+
+  /**
+   * 効果音を再生します。
+   * ※PCMへ合成済みの音は専用のチャンネルで鳴らし、別の音と重ねます。未登録の音は再生中の音を中断して鳴らします。
+   */
+  static void playTone(Tone tone);
+
+  /**
+   * モード共通の合成済みの音を返します。
+   */
+  static ToneClipBank& toneClipBank();
+
+  /**
+   * モード共通の音再生を返します。
+   */
+  static TonePlayer& tonePlayer();
+
+  /**
+   * モード共通の描画先を返します。
+   */
+  static LovyanGFX& surface();
+
+  /**
+   * 描画先の内容を画面へ反映します。
+   */
+  static void presentSurface();
+
+  /**
+   * 描画先の指定行範囲を画面へ反映します。
+   */
+  static void presentSurfaceRows(int y, int h);
+
+  /**
+   * 保存済みの静的な画面を描画先へ書き戻し、書き戻せたかを返します。
+   * ※画面へは転送しないため、動的な要素を描き足してから反映します。
+   */
+  static bool restoreCachedScreen(CachedScreen screen);
+
+  /**
+   * 保存済みの静的な画面のうち指定矩形だけを描画先へ書き戻し、書き戻せたかを返します。
+   */
+  static bool restoreCachedScreenRect(CachedScreen screen, int x, int y, int w, int h);
+
+  /**
+   * 現在のモードを終えてモード選択画面へ戻るよう依頼します。
+   * ※切り替えは入力イベントの処理を終えてから行います。
+   */
+  static void requestModeSelection();
+
+  /**
+   * 画面左上へモード選択画面に戻るボタンを描画します。
+   */
+  static void drawBackButton();
+
+  /**
+   * 指定座標がモード選択画面に戻るボタンの押下範囲内かを返します。
+   */
+  static bool isBackButtonTouched(int touchX, int touchY);
+
+ private:
+  /**
+   * モード選択画面へ戻る依頼の有無を返します。
    */
-  static void playToneSteps(const struct ToneStep* steps);
+  static bool& modeSelectionRequest();
 };
 
 #endif
@@ -0,0 +1,113 @@
+#include "perf-stats.h"
+
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+#include "logger.h"
+
+namespace {
+
+constexpr bool ENABLE_PERF_STATS = true;
+constexpr const char* SECTION_NAMES[PerfStats::SECTION_COUNT] = {
+  "loop",
+  "poll_rfid",
+  "render_normal",
+  "flush_dirty",
+  "camera_live",
+  "camera_filter",
+};
+
+}  // namespace
+
+/**
+ * 共有の集計を返します。
+ */
+PerfStats& PerfStats::instance() {
+  static PerfStats stats;
+  return stats;
+}
+
+/**
+ * 集計を初期化します。
+ */
+PerfStats::PerfStats()
+: sections_() {
+}
+
+/**
+ * 区間の所要時間を記録します。
+ */
+void PerfStats::record(const PerfSection section, const uint32_t elapsedUs) {
+  if (!ENABLE_PERF_STATS || section >= PerfSection::COUNT) {
+    return;
+  }
+
+  sections_[static_cast<size_t>(section)].record(elapsedUs);
+}
+
+/**
+ * すべての区間の集計を破棄します。
+ */
+void PerfStats::reset() {
+  for (size_t index = 0; index < SECTION_COUNT; ++index) {
+    sections_[index].reset();
+  }
+}
+
+/**
+ * 区間ごとの集計とヒープの空き状況をログへ書き出します。
+ */
+void PerfStats::dump() const {
+  for (size_t index = 0; index < SECTION_COUNT; ++index) {
+    const LatencyHistogram& stats = sections_[index];
+    if (stats.getCount() == 0) {
+      LOG_INFO(PERF, "%s n=0", SECTION_NAMES[index]);
+      continue;
+    }
+
+    LOG_INFO(
+      PERF,
+      "%s n=%lu min=%luus avg=%luus max=%luus p99<=%luus",
+      SECTION_NAMES[index],
+      static_cast<unsigned long>(stats.getCount()),
+      static_cast<unsigned long>(stats.getMinUs()),
+      static_cast<unsigned long>(stats.getAverageUs()),
+      static_cast<unsigned long>(stats.getMaxUs()),
+      static_cast<unsigned long>(stats.getPercentileUs(99))
+    );
+  }
+
+  LOG_INFO(
+    PERF,
+    "heap internal free=%u largest=%u min=%u",
+    static_cast<unsigned>(heap_caps_get_free_size(MALLOC_CAP_INTERNAL)),
+    static_cast<unsigned>(heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL)),
+    static_cast<unsigned>(heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL))
+  );
+  LOG_INFO(
+    PERF,
+    "heap psram free=%u largest=%u min=%u",
+    static_cast<unsigned>(heap_caps_get_free_size(MALLOC_CAP_SPIRAM)),
+    static_cast<unsigned>(heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM)),
+    static_cast<unsigned>(heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM))
+  );
+}
+
+/**
+ * 計測を開始します。
+ */
+ScopedTimer::ScopedTimer(const PerfSection section)
+: section_(section),
+  startedAtUs_(ENABLE_PERF_STATS ? esp_timer_get_time() : 0) {
+}
+
+/**
+ * 計測を終了して記録します。
+ */
+ScopedTimer::~ScopedTimer() {
+  if (!ENABLE_PERF_STATS) {
+    return;
+  }
+
+  PerfStats::instance().record(section_, static_cast<uint32_t>(esp_timer_get_time() - startedAtUs_));
+}
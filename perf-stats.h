@@ -0,0 +1,81 @@
+#ifndef PERF_STATS_H
+#define PERF_STATS_H
+
+#include <Arduino.h>
+
+#include "latency-histogram.h"
+
+/**
+ * 計測対象の処理区間です。
+ */
+enum class PerfSection : uint8_t {
+  LOOP,
+  POLL_RFID,
+  RENDER_NORMAL,
+  FLUSH_DIRTY,
+  CAMERA_LIVE,
+  CAMERA_FILTER,
+  COUNT,
+};
+
+/**
+ * 処理区間ごとの所要時間を固定長のヒストグラムへ集計します。
+ * ※各区間は1つのタスクからのみ記録する前提で、排他制御は行いません。
+ */
+class PerfStats {
+ public:
+  static constexpr size_t SECTION_COUNT = static_cast<size_t>(PerfSection::COUNT);
+
+  /**
+   * 共有の集計を返します。
+   */
+  static PerfStats& instance();
+
+  /**
+   * 区間の所要時間を記録します。
+   */
+  void record(PerfSection section, uint32_t elapsedUs);
+
+  /**
+   * すべての区間の集計を破棄します。
+   */
+  void reset();
+
+  /**
+   * 区間ごとの集計とヒープの空き状況をログへ書き出します。
+   */
+  void dump() const;
+
+ private:
+  /**
+   * 集計を初期化します。
+   */
+  PerfStats();
+
+  LatencyHistogram sections_[SECTION_COUNT];
+};
+
+/**
+ * 生成から破棄までの所要時間を処理区間へ記録します。
+ */
+class ScopedTimer {
+ public:
+  /**
+   * 計測を開始します。
+   */
+  explicit ScopedTimer(PerfSection section);
+
+  /**
+   * 計測を終了して記録します。
+   */
+  ~ScopedTimer();
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  PerfSection section_;
+  int64_t startedAtUs_;
+};
+
+#endif
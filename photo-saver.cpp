@@ -0,0 +1,328 @@
+#include "photo-saver.h"
+
+#include <SD.h>
+#include <SPI.h>
+#include <esp_heap_caps.h>
+#include <img_converters.h>
+
+#include <algorithm>
+
+#include "logger.h"
+
+namespace {
+
+constexpr uint32_t SAVE_TASK_STACK_SIZE = 8192;
+// 入力処理タスクやカメラ取得タスクより低くし、空き時間だけで符号化します。
+constexpr UBaseType_t SAVE_TASK_PRIORITY = 1;
+constexpr BaseType_t SAVE_TASK_CORE = 0;
+constexpr UBaseType_t SAVE_QUEUE_LENGTH = 2;
+constexpr uint8_t JPEG_QUALITY = 80;
+// セクタ長の倍数で書き込み、FATの中間バッファを経由せずに転送させます。
+constexpr size_t WRITE_CHUNK_BYTES = 4096;
+constexpr uint32_t MOUNT_RETRY_INTERVAL_MS = 5000;
+
+// CoreS3のmicroSDは画面とSPIバスを共有します。
+constexpr int SD_SPI_SCK_PIN = 36;
+constexpr int SD_SPI_MISO_PIN = 35;
+constexpr int SD_SPI_MOSI_PIN = 37;
+constexpr int SD_SPI_CS_PIN = 4;
+constexpr uint32_t SD_SPI_FREQUENCY = 25000000;
+
+constexpr char PHOTO_DIRECTORY[] = "/DCIM";
+constexpr char PHOTO_FILE_FORMAT[] = "/DCIM/IMG_%04lu.JPG";
+constexpr char PHOTO_NAME_FORMAT[] = "IMG_%lu.JPG";
+constexpr size_t PHOTO_PATH_CAPACITY = 32;
+
+}  // namespace
+
+/**
+ * 保存処理を初期化します。
+ */
+PhotoSaver::PhotoSaver()
+: pool_(nullptr),
+  compositor_(nullptr),
+  queue_(nullptr),
+  taskHandle_(nullptr),
+  chunkBuffer_(nullptr),
+  pendingCount_(0),
+  nextFileNumber_(1),
+  lastMountAttemptAtMs_(0),
+  hasMountAttempted_(false),
+  isCardMounted_(false) {
+}
+
+/**
+ * 保存タスクと書き込み用バッファを用意し、使えるかを返します。
+ */
+bool PhotoSaver::begin(StillFramePool& pool, FrameCompositor& compositor) {
+  if (taskHandle_ != nullptr) {
+    return true;
+  }
+
+  pool_ = &pool;
+  compositor_ = &compositor;
+
+  if (chunkBuffer_ == nullptr) {
+    chunkBuffer_ = static_cast<uint8_t*>(
+      heap_caps_malloc(WRITE_CHUNK_BYTES, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL)
+    );
+    if (chunkBuffer_ == nullptr) {
+      return false;
+    }
+  }
+
+  if (queue_ == nullptr) {
+    queue_ = xQueueCreate(SAVE_QUEUE_LENGTH, sizeof(size_t));
+    if (queue_ == nullptr) {
+      return false;
+    }
+  }
+
+  const BaseType_t result = xTaskCreatePinnedToCore(
+    runTask,
+    "photo",
+    SAVE_TASK_STACK_SIZE,
+    this,
+    SAVE_TASK_PRIORITY,
+    &taskHandle_,
+    SAVE_TASK_CORE
+  );
+  if (result != pdPASS) {
+    taskHandle_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 保存タスクを起動済みかを返します。
+ */
+bool PhotoSaver::isStarted() const {
+  return taskHandle_ != nullptr;
+}
+
+/**
+ * 指定スロットの静止画の保存を依頼し、受け付けたかを返します。
+ */
+bool PhotoSaver::enqueue(const size_t slot) {
+  if (taskHandle_ == nullptr) {
+    return false;
+  }
+
+  pool_->pinSlot(slot);
+  pendingCount_.fetch_add(1, std::memory_order_acq_rel);
+  if (xQueueSend(queue_, &slot, 0) == pdTRUE) {
+    return true;
+  }
+
+  pool_->unpinSlot(slot);
+  pendingCount_.fetch_sub(1, std::memory_order_acq_rel);
+  return false;
+}
+
+/**
+ * 保存待ちと保存中の依頼がないかを返します。
+ */
+bool PhotoSaver::isIdle() const {
+  return pendingCount_.load(std::memory_order_acquire) == 0;
+}
+
+/**
+ * 保存待ちと保存中の依頼がなくなるまで待ちます。
+ */
+void PhotoSaver::waitForIdle() const {
+  while (!isIdle()) {
+    vTaskDelay(1);
+  }
+}
+
+/**
+ * 保存タスクの本体です。
+ */
+void PhotoSaver::runTask(void* context) {
+  static_cast<PhotoSaver*>(context)->runSaveLoop();
+}
+
+/**
+ * 保存タスクで依頼を順に処理し続けます。
+ */
+void PhotoSaver::runSaveLoop() {
+  size_t slot = 0;
+
+  while (true) {
+    if (xQueueReceive(queue_, &slot, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    saveSlot(slot);
+    pendingCount_.fetch_sub(1, std::memory_order_acq_rel);
+  }
+}
+
+/**
+ * 指定スロットの静止画を符号化して保存し、保存できたかを返します。
+ */
+bool PhotoSaver::saveSlot(const size_t slot) {
+  StillFrame frame;
+  if (!pool_->getSlot(slot, frame)) {
+    pool_->unpinSlot(slot);
+    return false;
+  }
+
+  const uint32_t startedAtMs = millis();
+  uint8_t* jpeg = nullptr;
+  size_t jpegLength = 0;
+  const bool isEncoded = fmt2jpg(
+    reinterpret_cast<uint8_t*>(const_cast<uint16_t*>(frame.pixels)),
+    static_cast<size_t>(frame.width) * frame.height * sizeof(uint16_t),
+    static_cast<uint16_t>(frame.width),
+    static_cast<uint16_t>(frame.height),
+    PIXFORMAT_RGB565,
+    JPEG_QUALITY,
+    &jpeg,
+    &jpegLength
+  );
+
+  // 符号化を終えれば元の静止画は不要なため、書き込みを待たずに上書きを許します。
+  pool_->unpinSlot(slot);
+  if (!isEncoded) {
+    LOG_WARN(CAM, "jpeg encode failed");
+    return false;
+  }
+
+  const uint32_t encodedAtMs = millis();
+  const bool isWritten = writeFile(jpeg, jpegLength);
+  free(jpeg);
+
+  if (isWritten) {
+    LOG_INFO(
+      CAM,
+      "saved bytes=%u encode=%lums write=%lums",
+      static_cast<unsigned>(jpegLength),
+      static_cast<unsigned long>(encodedAtMs - startedAtMs),
+      static_cast<unsigned long>(millis() - encodedAtMs)
+    );
+  }
+  return isWritten;
+}
+
+/**
+ * microSDを使える状態にし、使えるかを返します。
+ */
+bool PhotoSaver::mountCard() {
+  if (isCardMounted_) {
+    return true;
+  }
+
+  if (hasMountAttempted_ && millis() - lastMountAttemptAtMs_ < MOUNT_RETRY_INTERVAL_MS) {
+    return false;
+  }
+
+  hasMountAttempted_ = true;
+  lastMountAttemptAtMs_ = millis();
+
+  compositor_->lockBus();
+  SPI.begin(SD_SPI_SCK_PIN, SD_SPI_MISO_PIN, SD_SPI_MOSI_PIN, SD_SPI_CS_PIN);
+  isCardMounted_ = SD.begin(SD_SPI_CS_PIN, SPI, SD_SPI_FREQUENCY);
+  if (isCardMounted_ && !SD.exists(PHOTO_DIRECTORY)) {
+    SD.mkdir(PHOTO_DIRECTORY);
+  }
+  if (isCardMounted_) {
+    scanNextFileNumber();
+  }
+  compositor_->unlockBus();
+
+  if (!isCardMounted_) {
+    LOG_WARN(CAM, "sd mount failed");
+    return false;
+  }
+
+  LOG_INFO(CAM, "sd mounted next=%lu", static_cast<unsigned long>(nextFileNumber_));
+  return true;
+}
+
+/**
+ * 保存先ディレクトリから次のファイル番号を求めます。
+ * ※起動後の初回マウント時だけ走査し、以降は番号を数え上げます。
+ */
+void PhotoSaver::scanNextFileNumber() {
+  File directory = SD.open(PHOTO_DIRECTORY);
+  if (!directory || !directory.isDirectory()) {
+    return;
+  }
+
+  File entry = directory.openNextFile();
+  while (entry) {
+    const char* name = entry.name();
+    const char* baseName = strrchr(name, '/');
+    unsigned long number = 0;
+    if (sscanf(baseName == nullptr ? name : baseName + 1, PHOTO_NAME_FORMAT, &number) == 1
+        && number >= nextFileNumber_) {
+      nextFileNumber_ = static_cast<uint32_t>(number) + 1;
+    }
+
+    entry.close();
+    entry = directory.openNextFile();
+  }
+  directory.close();
+}
+
+/**
+ * JPEGデータを新しいファイルへ書き込み、書き込めたかを返します。
+ */
+bool PhotoSaver::writeFile(const uint8_t* data, const size_t length) {
+  if (!mountCard()) {
+    return false;
+  }
+
+  char path[PHOTO_PATH_CAPACITY];
+  snprintf(path, sizeof(path), PHOTO_FILE_FORMAT, static_cast<unsigned long>(nextFileNumber_));
+
+  compositor_->lockBus();
+  File file = SD.open(path, FILE_WRITE);
+  compositor_->unlockBus();
+  if (!file) {
+    // 抜去された可能性があるため、次の保存時にマウントからやり直します。
+    LOG_WARN(CAM, "open failed path=%s", path);
+    isCardMounted_ = false;
+    return false;
+  }
+
+  const bool isWritten = writeChunks(file, data, length);
+  compositor_->lockBus();
+  file.close();
+  compositor_->unlockBus();
+
+  if (!isWritten) {
+    LOG_WARN(CAM, "write failed path=%s", path);
+    isCardMounted_ = false;
+    return false;
+  }
+
+  ++nextFileNumber_;
+  return true;
+}
+
+/**
+ * データを固定長の塊に分けて書き込み、すべて書き込めたかを返します。
+ * ※JPEGはPSRAM上にあるため、DMAで送れる内部RAMの塊へ複写してから書き込みます。
+ */
+bool PhotoSaver::writeChunks(File& file, const uint8_t* data, const size_t length) {
+  size_t offset = 0;
+
+  while (offset < length) {
+    const size_t chunkLength = std::min(WRITE_CHUNK_BYTES, length - offset);
+    memcpy(chunkBuffer_, data + offset, chunkLength);
+
+    compositor_->lockBus();
+    const size_t writtenLength = file.write(chunkBuffer_, chunkLength);
+    compositor_->unlockBus();
+
+    if (writtenLength != chunkLength) {
+      return false;
+    }
+    offset += chunkLength;
+  }
+
+  return true;
+}
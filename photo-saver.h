@@ -0,0 +1,102 @@
+#ifndef PHOTO_SAVER_H
+#define PHOTO_SAVER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include <atomic>
+
+#include "frame-compositor.h"
+#include "still-frame-pool.h"
+
+/**
+ * 静止画をバックグラウンドでJPEGへ符号化し、microSDへ保存します。
+ * ※符号化と書き込みは保存タスクで行い、画面処理タスクは依頼を積むだけで戻ります。
+ */
+class PhotoSaver {
+ public:
+  /**
+   * 保存処理を初期化します。
+   */
+  PhotoSaver();
+
+  /**
+   * 保存タスクと書き込み用バッファを用意し、使えるかを返します。
+   * ※起動済みの場合は何もしません。
+   */
+  bool begin(StillFramePool& pool, FrameCompositor& compositor);
+
+  /**
+   * 保存タスクを起動済みかを返します。
+   */
+  bool isStarted() const;
+
+  /**
+   * 指定スロットの静止画の保存を依頼し、受け付けたかを返します。
+   * ※保存待ちが満杯の場合は受け付けません。受け付けたスロットは符号化を終えるまで固定します。
+   */
+  bool enqueue(size_t slot);
+
+  /**
+   * 保存待ちと保存中の依頼がないかを返します。
+   */
+  bool isIdle() const;
+
+  /**
+   * 保存待ちと保存中の依頼がなくなるまで待ちます。
+   */
+  void waitForIdle() const;
+
+ private:
+  /**
+   * 保存タスクの本体です。
+   */
+  static void runTask(void* context);
+
+  /**
+   * 保存タスクで依頼を順に処理し続けます。
+   */
+  void runSaveLoop();
+
+  /**
+   * 指定スロットの静止画を符号化して保存し、保存できたかを返します。
+   */
+  bool saveSlot(size_t slot);
+
+  /**
+   * microSDを使える状態にし、使えるかを返します。
+   * ※失敗した場合は一定時間再試行しません。
+   */
+  bool mountCard();
+
+  /**
+   * 保存先ディレクトリから次のファイル番号を求めます。
+   */
+  void scanNextFileNumber();
+
+  /**
+   * JPEGデータを新しいファイルへ書き込み、書き込めたかを返します。
+   */
+  bool writeFile(const uint8_t* data, size_t length);
+
+  /**
+   * データを固定長の塊に分けて書き込み、すべて書き込めたかを返します。
+   * ※塊ごとにSPIバスを占有し、間で画面への転送を進められるようにします。
+   */
+  bool writeChunks(File& file, const uint8_t* data, size_t length);
+
+  StillFramePool* pool_;
+  FrameCompositor* compositor_;
+  QueueHandle_t queue_;
+  TaskHandle_t taskHandle_;
+  uint8_t* chunkBuffer_;
+  std::atomic<uint32_t> pendingCount_;
+  uint32_t nextFileNumber_;
+  uint32_t lastMountAttemptAtMs_;
+  bool hasMountAttempted_;
+  bool isCardMounted_;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#include "product-catalog.h"
+
+namespace {
+
+constexpr uint32_t FNV1A32_PRIME = 16777619UL;
+constexpr char NAME_HASH_SALT[] = "|NAME|v1";
+constexpr char PRICE_HASH_SALT[] = "|PRICE|v1";
+
+}  // namespace
+
+/**
+ * 指定した添字の商品名候補を返します。
+ */
+const char* getProductName(const size_t index) {
+  if (PRODUCT_NAME_COUNT == 0) {
+    return PRODUCT_FALLBACK_NAME;
+  }
+
+  return PRODUCT_NAMES[index % PRODUCT_NAME_COUNT];
+}
+
+/**
+ * FNV-1a 32bitハッシュ値へバイト列を畳み込みます。
+ */
+uint32_t fnv1a32Update(uint32_t hash, const char* bytes, const size_t length) {
+  for (size_t index = 0; index < length; ++index) {
+    hash ^= static_cast<uint8_t>(bytes[index]);
+    hash *= FNV1A32_PRIME;
+  }
+
+  return hash;
+}
+
+/**
+ * バーコード文字列から商品情報を決定します。
+ * ※登録カタログは索引を1回引くだけのため、登録件数によらず一定時間で決まります。
+ */
+CartItem resolveItemFromCode(const CatalogIndex& catalog, const char* code, const size_t length) {
+  CatalogEntry entry;
+  if (catalog.find(code, length, entry)) {
+    return CartItem{entry.name, entry.price, CATALOG_NAME_INDEX};
+  }
+
+  if (PRODUCT_NAME_COUNT == 0) {
+    return CartItem{PRODUCT_FALLBACK_NAME, PRICE_MIN, 0};
+  }
+
+  // コード部分は1回だけ畳み込み、連結していた識別子は途中状態から続けて畳み込みます。
+  const uint32_t codeHash = fnv1a32Update(FNV1A32_OFFSET_BASIS, code, length);
+
+  const uint32_t nameHash = fnv1a32Update(codeHash, NAME_HASH_SALT, sizeof(NAME_HASH_SALT) - 1);
+  const size_t nameIndex = nameHash % PRODUCT_NAME_COUNT;
+
+  const uint32_t priceHash = fnv1a32Update(codeHash, PRICE_HASH_SALT, sizeof(PRICE_HASH_SALT) - 1);
+  const int step = static_cast<int>(priceHash % PRICE_LEVELS);
+  const int price = PRICE_MIN + step * PRICE_STEP;
+
+  return CartItem{getProductName(nameIndex), static_cast<uint16_t>(price), static_cast<uint8_t>(nameIndex)};
+}
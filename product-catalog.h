@@ -0,0 +1,57 @@
+#ifndef PRODUCT_CATALOG_H
+#define PRODUCT_CATALOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "catalog-index.h"
+#include "register-cart.h"
+#include "register-config.h"
+
+/**
+ * 商品名候補の件数を終端のnullptrまで数えます。
+ */
+constexpr size_t countProductNames(const size_t index = 0) {
+  return PRODUCT_NAMES[index] == nullptr ? index : countProductNames(index + 1);
+}
+
+/**
+ * 商品名候補の件数です。
+ */
+static constexpr size_t PRODUCT_NAME_COUNT = countProductNames();
+
+/**
+ * 商品名候補が空の場合に使う商品名です。
+ */
+static constexpr const char* PRODUCT_FALLBACK_NAME = "しょうひん";
+
+/**
+ * 価格の下限・刻み幅・段階数です。
+ */
+static constexpr int PRICE_MIN = 50;
+static constexpr int PRICE_STEP = 10;
+static constexpr int PRICE_LEVELS = 46;
+static_assert(PRICE_MIN + (PRICE_LEVELS - 1) * PRICE_STEP <= UINT16_MAX, "CartItem::price must hold every price");
+
+/**
+ * 指定した添字の商品名候補を返します。
+ */
+const char* getProductName(size_t index);
+
+/**
+ * FNV-1a 32bitハッシュの初期値です。
+ */
+static constexpr uint32_t FNV1A32_OFFSET_BASIS = 2166136261UL;
+
+/**
+ * FNV-1a 32bitハッシュ値へバイト列を畳み込みます。
+ */
+uint32_t fnv1a32Update(uint32_t hash, const char* bytes, size_t length);
+
+/**
+ * バーコード文字列から商品情報を決定します。
+ * ※登録カタログにないコードは、コードのハッシュ値から商品名候補と価格を決めます。
+ */
+CartItem resolveItemFromCode(const CatalogIndex& catalog, const char* code, size_t length);
+
+#endif
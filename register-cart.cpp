@@ -0,0 +1,70 @@
+#include "register-cart.h"
+
+/**
+ * 空のカートを初期化します。
+ */
+RegisterCart::RegisterCart()
+: items_(),
+  total_(0) {
+}
+
+/**
+ * 明細を追加して合計金額を更新し、追加できたかを返します。
+ * ※上限件数に達している場合は追加せず、既存の明細と合計金額をそのまま残します。
+ */
+bool RegisterCart::add(const CartItem& item) {
+  if (items_.isFull()) {
+    return false;
+  }
+
+  items_.pushBack(item);
+  total_ += item.price;
+  return true;
+}
+
+/**
+ * 明細をすべて破棄します。
+ */
+void RegisterCart::clear() {
+  items_.clear();
+  total_ = 0;
+}
+
+/**
+ * 明細件数を返します。
+ */
+size_t RegisterCart::size() const {
+  return items_.size();
+}
+
+/**
+ * 合計金額を返します。
+ * ※追加と消去のたびに更新した値を返すため、件数によらず一定時間です。
+ */
+int RegisterCart::getTotal() const {
+  return total_;
+}
+
+/**
+ * 新しい方から数えた位置の明細を取り出し、存在したかを返します。
+ * ※0が最新の明細です。
+ */
+bool RegisterCart::getNewest(const size_t offset, CartItem& itemOut) const {
+  if (offset >= items_.size()) {
+    return false;
+  }
+
+  itemOut = items_[items_.size() - 1 - offset];
+  return true;
+}
+
+/**
+ * 指定行数ずつ表示する場合に、表示位置をずらせる最大行数を返します。
+ */
+size_t RegisterCart::getMaxScrollOffset(const size_t visibleRows) const {
+  if (items_.size() <= visibleRows) {
+    return 0;
+  }
+
+  return items_.size() - visibleRows;
+}
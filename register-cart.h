@@ -0,0 +1,75 @@
+#ifndef REGISTER_CART_H
+#define REGISTER_CART_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ring-buffer.h"
+
+/**
+ * カートの明細1件です。
+ * ※商品名はPRODUCT_NAMESの要素か登録カタログ内の文字列を指し、どちらもフラッシュ上の定義を参照します。
+ *   nameIndexはPRODUCT_NAMESの添字で、登録カタログの商品ではCATALOG_NAME_INDEXです。
+ */
+struct CartItem {
+  const char* name;
+  uint16_t price;
+  uint8_t nameIndex;
+};
+
+/**
+ * 登録カタログの商品を表すnameIndexです。
+ */
+static constexpr uint8_t CATALOG_NAME_INDEX = UINT8_MAX;
+
+/**
+ * 明細と合計金額を保持するカートです。
+ */
+class RegisterCart {
+ public:
+  static constexpr size_t CAPACITY = 256;
+
+  /**
+   * 空のカートを初期化します。
+   */
+  RegisterCart();
+
+  /**
+   * 明細を追加して合計金額を更新し、追加できたかを返します。
+   * ※上限件数に達している場合は追加せず、既存の明細と合計金額をそのまま残します。
+   */
+  bool add(const CartItem& item);
+
+  /**
+   * 明細をすべて破棄します。
+   */
+  void clear();
+
+  /**
+   * 明細件数を返します。
+   */
+  size_t size() const;
+
+  /**
+   * 合計金額を返します。
+   * ※追加と消去のたびに更新した値を返すため、件数によらず一定時間です。
+   */
+  int getTotal() const;
+
+  /**
+   * 新しい方から数えた位置の明細を取り出し、存在したかを返します。
+   * ※0が最新の明細です。
+   */
+  bool getNewest(size_t offset, CartItem& itemOut) const;
+
+  /**
+   * 指定行数ずつ表示する場合に、表示位置をずらせる最大行数を返します。
+   */
+  size_t getMaxScrollOffset(size_t visibleRows) const;
+
+ private:
+  RingBuffer<CartItem, CAPACITY> items_;
+  int total_;
+};
+
+#endif
@@ -12,9 +12,9 @@ struct ToneStep {
 /**
  * 商品名候補の配列です。
  * ※末尾のnullptrは終端判定に使うため必須です。
- * ※nullptrが欠けると件数探索が配列外まで進み不正動作します。
+ * ※nullptrが欠けるとコンパイル時の件数計算が配列外まで進みビルドエラーになります。
  */
-static const char* const PRODUCT_NAMES[] = {
+static constexpr const char* PRODUCT_NAMES[] = {
   "ぶろっこりー", "きゅうり", "とまと", "ぴーまん",
   "りんご", "いちご", "ばなな", "ぱいん",
   "おにぎり",
@@ -65,6 +65,16 @@ static constexpr ToneStep SHUTTER_TONE_STEPS[] = {
   {0, 0, 0},
 };
 
+/**
+ * エラー音のステップ定義です。
+ * ※末尾の{0,0,0}は終端判定に使うため必須です。
+ */
+static constexpr ToneStep ERROR_TONE_STEPS[] = {
+  {440, 120, 60},
+  {330, 200, 0},
+  {0, 0, 0},
+};
+
 /**
  * スピーカー音量です。
  */
@@ -1,39 +1,80 @@
 #include "register-mode.h"
 
 #include <Wire.h>
+#include <time.h>
 
 #include <algorithm>
 
+#include "image-filter.h"
+#include "logger.h"
+#include "perf-stats.h"
+#include "product-catalog.h"
 #include "register-config.h"
 
 namespace {
 
 // バーコードスキャナUART設定
 constexpr long BARCODE_UART_BAUD = 115200;
-constexpr uint32_t BARCODE_FRAME_GAP_MS = 300;
+constexpr uint32_t BARCODE_BITS_PER_CHARACTER = 10;
+constexpr uint8_t BARCODE_RX_TIMEOUT_SYMBOLS = 20;
+constexpr uint32_t BARCODE_FRAME_GAP_CHARACTERS = 16;
+constexpr uint32_t BARCODE_FRAME_GAP_MARGIN_MS = 8;
+// 終端が届かない場合の区切り時間です。文字送出時間から求めます。
+constexpr uint32_t BARCODE_FRAME_GAP_MS =
+  (BARCODE_FRAME_GAP_CHARACTERS * BARCODE_BITS_PER_CHARACTER * 1000 + BARCODE_UART_BAUD - 1) / BARCODE_UART_BAUD
+  + BARCODE_FRAME_GAP_MARGIN_MS;
 constexpr uint32_t BARCODE_COMMAND_GUARD_MS = 120;
 constexpr uint32_t BARCODE_BOOT_STABILIZE_MS = 1500;
 constexpr uint8_t BARCODE_CMD_TRIGGER_MODE_BUTTON[] = {0x21, 0x61, 0x41, 0x00};
 constexpr uint8_t BARCODE_CMD_FILL_LIGHT_OFF[] = {0x21, 0x62, 0x41, 0x00};
 constexpr uint8_t BARCODE_CMD_AIM_LIGHT_ON[] = {0x21, 0x62, 0x42, 0x02};
+// 終端をCRにする設定です。命令がスキャナの説明書で確認できていないため、確認するまで送りません。
+// ※送らない間も、受信の無通信コールバックと通信速度から求めた区切り時間でフレームを区切ります。
+constexpr bool ENABLE_BARCODE_TERMINATOR_COMMAND = false;
+constexpr uint8_t BARCODE_CMD_TERMINATOR_CR[] = {0x21, 0x63, 0x41, 0x01};
+
+/**
+ * 起動時にバーコードスキャナへ送るコマンドです。
+ */
+struct BarcodeCommand {
+  const uint8_t* bytes;
+  size_t length;
+};
+
+constexpr BarcodeCommand BARCODE_BOOT_COMMANDS[] = {
+  {BARCODE_CMD_TRIGGER_MODE_BUTTON, sizeof(BARCODE_CMD_TRIGGER_MODE_BUTTON)},
+  {BARCODE_CMD_FILL_LIGHT_OFF, sizeof(BARCODE_CMD_FILL_LIGHT_OFF)},
+  {BARCODE_CMD_AIM_LIGHT_ON, sizeof(BARCODE_CMD_AIM_LIGHT_ON)},
+  // 未確認の終端設定は末尾に置き、無効な間は送る件数から外します。
+  {BARCODE_CMD_TERMINATOR_CR, sizeof(BARCODE_CMD_TERMINATOR_CR)},
+};
+constexpr size_t BARCODE_BOOT_COMMAND_COUNT =
+  sizeof(BARCODE_BOOT_COMMANDS) / sizeof(BARCODE_BOOT_COMMANDS[0]) - (ENABLE_BARCODE_TERMINATOR_COMMAND ? 0 : 1);
 
 // RFIDリーダI2C設定
 constexpr uint8_t RFID_I2C_ADDRESS = 0x28;
 constexpr uint32_t RFID_I2C_CLOCK = 100000;
+constexpr uint32_t RFID_I2C_FAST_CLOCK = 400000;
+constexpr bool ENABLE_RFID_FAST_I2C = true;
 constexpr int RFID_RESET_DUMMY_PIN = 8;
+
+// RFIDカード検出の問い合わせ間隔
+// ※操作が途切れてから一定時間後は間隔を広げ、読み取り直後は同じカードの再検出を避けます。
+constexpr RfidPollScheduler::Config RFID_POLL_CONFIG = {
+  50,     // activeIntervalMs
+  200,    // idleIntervalMs
+  30000,  // idleAfterMs
+  1000,   // debounceMs
+};
 constexpr uint32_t DEBUG_FRAME_GAP_MS = 0;
 
 // デバッグ設定
-constexpr bool ENABLE_SERIAL_DEBUG = true;
 
 // 画面遷移タイミング
 constexpr uint32_t THANK_YOU_DURATION_MS = 3000;
 
 // 会計ロジック設定
-constexpr int ITEM_VISIBLE_ROWS = 3;
-constexpr int PRICE_MIN = 50;
-constexpr int PRICE_STEP = 10;
-constexpr int PRICE_LEVELS = 46;
+static_assert(PRODUCT_NAME_COUNT <= CATALOG_NAME_INDEX, "Item::nameIndex must hold every product index");
 
 // 画面レイアウト設定
 constexpr int CLEAR_BUTTON_MARGIN_RIGHT = 8;
@@ -41,15 +82,43 @@ constexpr int CLEAR_BUTTON_MARGIN_BOTTOM = 8;
 constexpr int CLEAR_BUTTON_W = 84;
 constexpr int CLEAR_BUTTON_H = 34;
 constexpr int CLEAR_BUTTON_HIT_INSET = 2;
+constexpr int SCROLL_BUTTON_MARGIN_RIGHT = 8;
+constexpr int SCROLL_BUTTON_TOP = 8;
+constexpr int SCROLL_BUTTON_W = 44;
+constexpr int SCROLL_BUTTON_H = 38;
+constexpr int SCROLL_BUTTON_GAP = 6;
+constexpr uint8_t SCROLL_STATE_CAN_SCROLL_UP = 0x01;
+constexpr uint8_t SCROLL_STATE_CAN_SCROLL_DOWN = 0x02;
+constexpr int CAPTION_X = 56;
 constexpr int CAPTION_Y = 6;
 constexpr int LIST_START_Y = 57;
 constexpr int ITEM_ROW_HEIGHT = 36;
 constexpr int ITEM_TEXT_OFFSET_Y = 3;
 constexpr int ITEM_RULE_OFFSET_Y = 30;
 constexpr int SUMMARY_MARGIN_BOTTOM = 4;
-constexpr size_t FRAME_BUFFER_MAX_LENGTH = 128;
-constexpr int MIN_VALID_INPUT_LENGTH = 2;
+constexpr int DIRTY_MERGE_SLACK_PIXELS = 320 * 8;
+constexpr uint32_t BENCH_DEFAULT_COUNT = 100;
+constexpr uint32_t BENCH_DEFAULT_RATE_HZ = 10;
+constexpr uint32_t BENCH_FINISH_CHECK_INTERVAL_MS = 100;
+constexpr uint32_t BENCH_FILTER_DEFAULT_ITERATIONS = 20;
+constexpr int BENCH_FILTER_WIDTH = 320;
+constexpr int BENCH_FILTER_HEIGHT = 240;
 constexpr int BARCODE_MIN_VALID_LENGTH = 6;
+// 登録カタログを書き込むパーティションのラベルです。partitions.csv と揃えます。
+constexpr bool ENABLE_FLASH_CATALOG = true;
+constexpr const char* CATALOG_PARTITION_LABEL = "catalog";
+// 決済ごとの記録を追記するパーティションのラベルです。
+constexpr bool ENABLE_TRANSACTION_JOURNAL = true;
+constexpr const char* JOURNAL_PARTITION_LABEL = "journal";
+constexpr int RTC_MIN_VALID_YEAR = 2024;
+
+constexpr bool ENABLE_ROW_TEXT_PRERENDER = true;
+constexpr int ROW_NAME_SLOT_COUNT = PRODUCT_NAME_COUNT == 0 ? 1 : static_cast<int>(PRODUCT_NAME_COUNT);
+constexpr size_t PRICE_TEXT_CAPACITY = 8;
+static_assert(
+  ROW_NAME_SLOT_COUNT + PRICE_LEVELS <= static_cast<int>(TextSpriteAtlas::SLOT_CAPACITY),
+  "Every product name and price must fit in the row text atlas"
+);
 
 constexpr const lgfx::U8g2font* BODY_FONT = &fonts::lgfxJapanGothic_24;
 constexpr const lgfx::U8g2font* SUMMARY_FONT = &fonts::lgfxJapanGothic_32;
@@ -62,54 +131,114 @@ constexpr const lgfx::U8g2font* BUTTON_FONT = &fonts::lgfxJapanGothic_16;
  */
 RegisterMode::RegisterMode()
 : barcodeSerial_(1),
+  clock_(),
+  barcodeStream_(barcodeSerial_),
+  debugStream_(Serial),
   rfidReader_(RFID_I2C_ADDRESS, RFID_RESET_DUMMY_PIN, &Wire),
+  rfidPollScheduler_(RFID_POLL_CONFIG),
+  cart_(),
+  catalogPartition_(),
+  catalog_(),
+  journal_(),
+  renderedRows_(),
+  dirtyRects_(),
+  dirtyRectCount_(0),
+  renderedTotal_(-1),
+  renderedScrollState_(0),
+  nameFitCache_(),
+  rowTextAtlas_(),
+  pendingScanTrace_(),
+  scanTraceLog_(),
+  loadGenerator_(),
+  scrollOffset_(0),
   appState_(AppState::NORMAL),
-  thankYouStartedAtMs_(0),
-  barcodeLastByteAtMs_(0),
-  debugLastByteAtMs_(0),
+  barcodeReader_(clock_),
+  debugReader_(clock_),
+  hasBarcodeBurstEnded_(false),
+  thankYouJobId_(DeadlineScheduler::INVALID_JOB_ID),
+  benchFinishJobId_(DeadlineScheduler::INVALID_JOB_ID),
   barcodeCommandGuardUntilMs_(0),
   barcodeInputReadyAtMs_(0),
+  barcodeBootStartedAtMs_(0),
+  rfidBootStartedAtMs_(0),
+  barcodeBootStage_(BarcodeBootStage::BEGIN_SERIAL),
+  rfidBootStage_(RfidBootStage::BEGIN_BUS),
+  barcodeBootCommandIndex_(0),
   barcodeRxdPin_(-1),
   barcodeTxdPin_(-1),
+  rfidSdaPin_(-1),
+  rfidSclPin_(-1),
   isRfidReady_(false) {
 }
 
 /**
- * 周辺機器を初期化します。
+ * 周辺機器の起動処理を準備し、登録カタログと決済記録のパーティションを開きます。
+ * ※実際の初期化は入力処理タスクのadvanceBootで段階的に進めます。
  */
 void RegisterMode::initialize(const Pins& pins) {
   barcodeRxdPin_ = pins.barcodeRxdPin;
   barcodeTxdPin_ = pins.barcodeTxdPin;
+  rfidSdaPin_ = pins.rfidSdaPin;
+  rfidSclPin_ = pins.rfidSclPin;
+  barcodeBootStage_ = BarcodeBootStage::BEGIN_SERIAL;
+  rfidBootStage_ = RfidBootStage::BEGIN_BUS;
+  barcodeBootCommandIndex_ = 0;
+  isRfidReady_ = false;
+
+  LOG_DEBUG(BOOT, "portc RXD pin=%d TXD pin=%d", barcodeRxdPin_, barcodeTxdPin_);
+  LOG_DEBUG(BOOT, "barcode BAUD=%ld", BARCODE_UART_BAUD);
+  LOG_DEBUG(BOOT, "barcode frame gap=%lums", static_cast<unsigned long>(BARCODE_FRAME_GAP_MS));
+  LOG_DEBUG(BOOT, "barcode trigger=unit button");
+  LOG_DEBUG(BOOT, "rfid I2C SDA=%d SCL=%d", pins.rfidSdaPin, pins.rfidSclPin);
+  LOG_DEBUG(BOOT, "rfid reset pin=%d", RFID_RESET_DUMMY_PIN);
+
+  if (ENABLE_FLASH_CATALOG && catalogPartition_.begin(CATALOG_PARTITION_LABEL)) {
+    if (catalog_.attach(catalogPartition_.data(), catalogPartition_.size())) {
+      LOG_INFO(
+        BOOT,
+        "catalog entries=%u bytes=%u",
+        static_cast<unsigned>(catalog_.size()),
+        static_cast<unsigned>(catalogPartition_.size())
+      );
+    } else {
+      LOG_WARN(BOOT, "catalog image invalid");
+      catalogPartition_.end();
+    }
+  }
 
-  beginBarcodeSerial(true);
-  applyBarcodeScannerSettings();
-  barcodeInputReadyAtMs_ = millis() + BARCODE_BOOT_STABILIZE_MS;
-  clearBarcodeSerialInput();
-
-  Wire.begin(pins.rfidSdaPin, pins.rfidSclPin, RFID_I2C_CLOCK);
-  if (checkRfidI2cStatus()) {
-    rfidReader_.PCD_Init();
-    logRfidVersion();
-    isRfidReady_ = true;
-  } else {
-    isRfidReady_ = false;
+  if (ENABLE_TRANSACTION_JOURNAL && !journal_.begin(JOURNAL_PARTITION_LABEL)) {
+    LOG_WARN(BOOT, "journal off");
   }
+}
 
-  logDebug("[BOOT] portc RXD pin=" + String(barcodeRxdPin_) + " TXD pin=" + String(barcodeTxdPin_));
-  logDebug("[BOOT] barcode BAUD=" + String(BARCODE_UART_BAUD));
-  logDebug("[BOOT] barcode trigger=unit button");
-  logDebug("[BOOT] rfid I2C SDA=" + String(pins.rfidSdaPin) + " SCL=" + String(pins.rfidSclPin));
-  logDebug("[BOOT] rfid reset pin=" + String(RFID_RESET_DUMMY_PIN));
+/**
+ * 周辺機器の起動処理を1段階ずつ進め、完了したかを返します。
+ */
+bool RegisterMode::advanceBoot() {
+  advanceBarcodeBoot();
+  advanceRfidBoot();
+  return barcodeBootStage_ == BarcodeBootStage::DONE && rfidBootStage_ == RfidBootStage::DONE;
 }
 
 /**
  * モード遷移時に通常画面を表示します。
  */
 void RegisterMode::enter() {
+  prerenderRowTexts();
   appState_ = AppState::NORMAL;
   renderNormalScreen();
 }
 
+/**
+ * モードから離れる際に、ありがとう画面のタイムアウトを取り消します。
+ * ※負荷試験は発行を止め、集計は終了確認ジョブに任せます。
+ */
+void RegisterMode::exit() {
+  scheduler().cancel(thankYouJobId_);
+  loadGenerator_.stop();
+  appState_ = AppState::NORMAL;
+}
+
 /**
  * タップ入力を処理します。
  */
@@ -118,6 +247,21 @@ void RegisterMode::onTouch(const int touchX, const int touchY) {
     return;
   }
 
+  if (isBackButtonTouched(touchX, touchY)) {
+    requestModeSelection();
+    return;
+  }
+
+  if (isPointInsideRect(touchX, touchY, getScrollUpButtonRect())) {
+    scrollCart(-ITEM_VISIBLE_ROWS);
+    return;
+  }
+
+  if (isPointInsideRect(touchX, touchY, getScrollDownButtonRect())) {
+    scrollCart(ITEM_VISIBLE_ROWS);
+    return;
+  }
+
   const Rect clearButtonHitRect = getClearButtonHitRect();
   if (!isPointInsideRect(touchX, touchY, clearButtonHitRect)) {
     return;
@@ -128,45 +272,87 @@ void RegisterMode::onTouch(const int touchX, const int touchY) {
 }
 
 /**
- * モードの定期更新を処理します。
+ * タッチ操作を処理します。
+ * ※指を上へ払うと古い明細へ、下へ払うと新しい明細へ送ります。
  */
-void RegisterMode::update() {
-  pollDebugSerial();
-  pollBarcodeSerial();
-  pollRfidCard();
-  updateThankYouState();
+void RegisterMode::onTouchEvent(const TouchEvent& event) {
+  const bool isVerticalSwipe = event.gesture == TouchGesture::SWIPE
+    && (event.direction == SwipeDirection::UP || event.direction == SwipeDirection::DOWN);
+  if (appState_ != AppState::NORMAL || !isVerticalSwipe) {
+    ModeBase::onTouchEvent(event);
+    return;
+  }
+
+  scrollCart(event.direction == SwipeDirection::UP ? ITEM_VISIBLE_ROWS : -ITEM_VISIBLE_ROWS);
 }
 
 /**
- * モード選択時の起動音を鳴らします。
+ * 入力処理タスクで周辺機器を読み取り、入力イベントを発行します。
  */
-void RegisterMode::playStartupTone() const {
-  playToneSteps(STARTUP_TONE_STEPS);
+void RegisterMode::pollInput(InputPipeline& pipeline) {
+  pollDebugSerial(pipeline);
+
+  if (barcodeBootStage_ == BarcodeBootStage::DONE) {
+    pollBarcodeSerial(pipeline);
+  }
+
+  pollRfidCard(pipeline);
+  loadGenerator_.poll(pipeline);
 }
 
 /**
- * デバッグログをUSBシリアルへ出力します。
+ * 入力処理タスクから届いた入力イベントを処理します。
  */
-void RegisterMode::logDebug(const String& message) const {
-  if (!ENABLE_SERIAL_DEBUG) {
-    return;
+void RegisterMode::onInputEvent(const InputEvent& event) {
+  // 受信側で記録した時刻を引き継ぎ、商品登録まで進んだ場合に段階ごとの時刻を追記します。
+  pendingScanTrace_ = ScanTrace{event.sourceStartedAtUs, event.publishedAtUs, 0, 0, 0, 0};
+
+  switch (event.type) {
+    case InputEventType::BARCODE:
+      handleBarcodeCode(event.text, strlen(event.text));
+      break;
+    case InputEventType::RFID:
+      handleRfidUid(event.text, strlen(event.text), event.isSynthetic);
+      break;
+    case InputEventType::DEBUG_LINE:
+      handleDebugLine(String(event.text));
+      return;
+    default:
+      return;
   }
 
-  Serial.println(message);
+  // 負荷試験中は、発行から処理完了までの時間を集計します。
+  if (loadGenerator_.isActive()) {
+    loadGenerator_.recordHandled(micros() - event.sourceStartedAtUs);
+  }
+}
+
+/**
+ * モード選択時の起動音を鳴らします。
+ */
+void RegisterMode::playStartupTone() const {
+  playTone(Tone::STARTUP);
 }
 
 /**
  * スキャン音を鳴らします。
  */
 void RegisterMode::playScanTone() const {
-  playToneSteps(SCAN_TONE_STEPS);
+  playTone(Tone::SCAN);
 }
 
 /**
  * 決済音を鳴らします。
  */
 void RegisterMode::playPaymentTone() const {
-  playToneSteps(PAYMENT_TONE_STEPS);
+  playTone(Tone::PAYMENT);
+}
+
+/**
+ * エラー音を鳴らします。
+ */
+void RegisterMode::playErrorTone() const {
+  playTone(Tone::ERROR);
 }
 
 /**
@@ -175,12 +361,12 @@ void RegisterMode::playPaymentTone() const {
 void RegisterMode::beginBarcodeSerial(const bool shouldLog) {
   barcodeSerial_.begin(BARCODE_UART_BAUD, SERIAL_8N1, barcodeRxdPin_, barcodeTxdPin_);
 
+  // 受信が途切れた時点で通知を受け、入力処理タスクをすぐに起こします。
+  barcodeSerial_.setRxTimeout(BARCODE_RX_TIMEOUT_SYMBOLS);
+  barcodeSerial_.onReceive([this]() { handleBarcodeReceive(); }, true);
+
   if (shouldLog) {
-    logDebug(
-      "[BC] serial begin RX=" + String(barcodeRxdPin_)
-      + " TX=" + String(barcodeTxdPin_)
-      + " BAUD=" + String(BARCODE_UART_BAUD)
-    );
+    LOG_DEBUG(BC, "serial begin RX=%d TX=%d BAUD=%ld", barcodeRxdPin_, barcodeTxdPin_, BARCODE_UART_BAUD);
   }
 }
 
@@ -192,29 +378,117 @@ void RegisterMode::clearBarcodeSerialInput() {
     static_cast<void>(barcodeSerial_.read());
   }
 
-  barcodeBuffer_ = "";
-  barcodeLastByteAtMs_ = 0;
+  barcodeReader_.clear();
+  hasBarcodeBurstEnded_.store(false, std::memory_order_relaxed);
 }
 
 /**
- * バーコードスキャナへコマンドを送信します。
+ * バーコードスキャナへコマンドを送信し、応答を読み捨てる期限を設定します。
  */
 void RegisterMode::sendBarcodeCommand(const uint8_t* command, const size_t length) {
   clearBarcodeSerialInput();
   barcodeSerial_.write(command, length);
   barcodeSerial_.flush();
-  delay(BARCODE_COMMAND_GUARD_MS);
-  clearBarcodeSerialInput();
   barcodeCommandGuardUntilMs_ = millis() + BARCODE_COMMAND_GUARD_MS;
 }
 
 /**
- * バーコードスキャナの起動時設定を適用します。
+ * バーコードスキャナの起動処理を1段階進めます。
+ */
+void RegisterMode::advanceBarcodeBoot() {
+  switch (barcodeBootStage_) {
+    case BarcodeBootStage::BEGIN_SERIAL:
+      barcodeBootStartedAtMs_ = millis();
+      beginBarcodeSerial(true);
+      barcodeBootStage_ = BarcodeBootStage::SEND_COMMAND;
+      break;
+
+    case BarcodeBootStage::SEND_COMMAND: {
+      const BarcodeCommand& command = BARCODE_BOOT_COMMANDS[barcodeBootCommandIndex_];
+      sendBarcodeCommand(command.bytes, command.length);
+      barcodeBootStage_ = BarcodeBootStage::WAIT_COMMAND_GUARD;
+      break;
+    }
+
+    case BarcodeBootStage::WAIT_COMMAND_GUARD:
+      if (millis() < barcodeCommandGuardUntilMs_) {
+        break;
+      }
+
+      // 応答を読み捨てた後も、遅れて届く応答に備えて同じ期間だけ入力を無視します。
+      clearBarcodeSerialInput();
+      barcodeCommandGuardUntilMs_ = millis() + BARCODE_COMMAND_GUARD_MS;
+      ++barcodeBootCommandIndex_;
+      if (barcodeBootCommandIndex_ < BARCODE_BOOT_COMMAND_COUNT) {
+        barcodeBootStage_ = BarcodeBootStage::SEND_COMMAND;
+        break;
+      }
+
+      barcodeInputReadyAtMs_ = millis() + BARCODE_BOOT_STABILIZE_MS;
+      barcodeBootStage_ = BarcodeBootStage::DONE;
+      LOG_DEBUG(
+        BOOT,
+        "barcode configured took=%lums at=%lums",
+        static_cast<unsigned long>(millis() - barcodeBootStartedAtMs_),
+        static_cast<unsigned long>(millis())
+      );
+      break;
+
+    case BarcodeBootStage::DONE:
+      break;
+  }
+}
+
+/**
+ * RFIDリーダの起動処理を1段階進めます。
  */
-void RegisterMode::applyBarcodeScannerSettings() {
-  sendBarcodeCommand(BARCODE_CMD_TRIGGER_MODE_BUTTON, sizeof(BARCODE_CMD_TRIGGER_MODE_BUTTON));
-  sendBarcodeCommand(BARCODE_CMD_FILL_LIGHT_OFF, sizeof(BARCODE_CMD_FILL_LIGHT_OFF));
-  sendBarcodeCommand(BARCODE_CMD_AIM_LIGHT_ON, sizeof(BARCODE_CMD_AIM_LIGHT_ON));
+void RegisterMode::advanceRfidBoot() {
+  switch (rfidBootStage_) {
+    case RfidBootStage::BEGIN_BUS:
+      rfidBootStartedAtMs_ = millis();
+      Wire.begin(rfidSdaPin_, rfidSclPin_, RFID_I2C_CLOCK);
+      if (!checkRfidI2cStatus()) {
+        isRfidReady_ = false;
+        rfidBootStage_ = RfidBootStage::DONE;
+        LOG_DEBUG(BOOT, "rfid unavailable took=%lums", static_cast<unsigned long>(millis() - rfidBootStartedAtMs_));
+        break;
+      }
+
+      LOG_DEBUG(BOOT, "rfid probe took=%lums", static_cast<unsigned long>(millis() - rfidBootStartedAtMs_));
+      rfidBootStage_ = RfidBootStage::INITIALIZE_READER;
+      break;
+
+    case RfidBootStage::INITIALIZE_READER: {
+      rfidReader_.PCD_Init();
+      const uint8_t version = logRfidVersion();
+      if (ENABLE_RFID_FAST_I2C) {
+        tryRaiseRfidI2cClock(version);
+      }
+
+      rfidPollScheduler_.reset(millis());
+      isRfidReady_ = true;
+      rfidBootStage_ = RfidBootStage::DONE;
+      LOG_DEBUG(
+        BOOT,
+        "rfid ready took=%lums at=%lums",
+        static_cast<unsigned long>(millis() - rfidBootStartedAtMs_),
+        static_cast<unsigned long>(millis())
+      );
+      break;
+    }
+
+    case RfidBootStage::DONE:
+      break;
+  }
+}
+
+/**
+ * バーコードUARTの受信途切れを記録し、入力処理タスクを起こします。
+ * ※UARTのイベントタスクから呼び出されます。
+ */
+void RegisterMode::handleBarcodeReceive() {
+  hasBarcodeBurstEnded_.store(true, std::memory_order_release);
+  inputPipeline().wake();
 }
 
 /**
@@ -225,34 +499,49 @@ bool RegisterMode::checkRfidI2cStatus() const {
   const uint8_t errorCode = Wire.endTransmission();
 
   if (errorCode == 0) {
-    logDebug("[RFID] I2C address 0x28 detected");
+    LOG_DEBUG(RFID, "I2C address 0x%02X detected", RFID_I2C_ADDRESS);
     return true;
   }
 
-  logDebug("[RFID] I2C address 0x28 not found, error=" + String(errorCode));
+  LOG_DEBUG(RFID, "I2C address 0x%02X not found, error=%u", RFID_I2C_ADDRESS, errorCode);
   return false;
 }
 
 /**
- * RFIDリーダのバージョンレジスタ値をログ出力します。
+ * RFIDリーダのバージョンレジスタ値をログ出力し、その値を返します。
+ */
+uint8_t RegisterMode::logRfidVersion() {
+  const uint8_t version = rfidReader_.PCD_ReadRegister(rfidReader_.VersionReg);
+  LOG_DEBUG(RFID, "version=0x%02X", version);
+  return version;
+}
+
+/**
+ * RFIDリーダのI2Cクロックを高速側へ切り替えます。
+ * ※応答がない場合の読み値(0x00/0xFF)では健全か判断できないため、切り替えません。
  */
-void RegisterMode::logRfidVersion() {
+void RegisterMode::tryRaiseRfidI2cClock(const uint8_t expectedVersion) {
+  if (expectedVersion == 0x00 || expectedVersion == 0xFF) {
+    return;
+  }
+
+  Wire.setClock(RFID_I2C_FAST_CLOCK);
   const uint8_t version = rfidReader_.PCD_ReadRegister(rfidReader_.VersionReg);
-  String text = "[RFID] version=0x";
-  if (version < 0x10) {
-    text += "0";
+  if (checkRfidI2cStatus() && version == expectedVersion) {
+    LOG_DEBUG(RFID, "I2C clock=%luHz", static_cast<unsigned long>(RFID_I2C_FAST_CLOCK));
+    return;
   }
-  text += String(version, HEX);
-  text.toUpperCase();
-  logDebug(text);
+
+  Wire.setClock(RFID_I2C_CLOCK);
+  LOG_WARN(RFID, "I2C clock %luHz unstable, version=0x%02X", static_cast<unsigned long>(RFID_I2C_FAST_CLOCK), version);
 }
 
 /**
  * CLEARボタンの表示領域を返します。
  */
 RegisterMode::Rect RegisterMode::getClearButtonRect() const {
-  const int x = M5.Display.width() - CLEAR_BUTTON_W - CLEAR_BUTTON_MARGIN_RIGHT;
-  const int y = M5.Display.height() - CLEAR_BUTTON_H - CLEAR_BUTTON_MARGIN_BOTTOM;
+  const int x = surface().width() - CLEAR_BUTTON_W - CLEAR_BUTTON_MARGIN_RIGHT;
+  const int y = surface().height() - CLEAR_BUTTON_H - CLEAR_BUTTON_MARGIN_BOTTOM;
   return Rect{x, y, CLEAR_BUTTON_W, CLEAR_BUTTON_H};
 }
 
@@ -268,6 +557,23 @@ RegisterMode::Rect RegisterMode::getClearButtonHitRect() const {
   return Rect{x, y, w, h};
 }
 
+/**
+ * 新しい明細側へ送るボタンの表示領域を返します。
+ */
+RegisterMode::Rect RegisterMode::getScrollUpButtonRect() const {
+  const Rect downButtonRect = getScrollDownButtonRect();
+  const int x = downButtonRect.x - SCROLL_BUTTON_GAP - SCROLL_BUTTON_W;
+  return Rect{x, SCROLL_BUTTON_TOP, SCROLL_BUTTON_W, SCROLL_BUTTON_H};
+}
+
+/**
+ * 古い明細側へ送るボタンの表示領域を返します。
+ */
+RegisterMode::Rect RegisterMode::getScrollDownButtonRect() const {
+  const int x = surface().width() - SCROLL_BUTTON_W - SCROLL_BUTTON_MARGIN_RIGHT;
+  return Rect{x, SCROLL_BUTTON_TOP, SCROLL_BUTTON_W, SCROLL_BUTTON_H};
+}
+
 /**
  * 指定座標が矩形内かを返します。
  */
@@ -277,230 +583,296 @@ bool RegisterMode::isPointInsideRect(const int x, const int y, const Rect& rect)
 }
 
 /**
- * 商品名候補数を返します。
+ * カートへ商品を追加して最新の明細を表示する位置へ戻し、追加できたかを返します。
+ * ※カートが上限件数に達している場合は追加せず、表示位置も変えません。
  */
-size_t RegisterMode::getProductNameCount() const {
-  size_t count = 0;
-
-  while (PRODUCT_NAMES[count] != nullptr) {
-    ++count;
+bool RegisterMode::addCartItem(const Item& item) {
+  if (!cart_.add(item)) {
+    return false;
   }
 
-  return count;
+  scrollOffset_ = 0;
+  return true;
 }
 
 /**
- * 指定した添字の商品名候補を返します。
+ * カートを空にし、表示位置を初期化します。
  */
-const char* RegisterMode::getProductName(const size_t index) const {
-  const size_t nameCount = getProductNameCount();
-  if (nameCount == 0) {
-    return "しょうひん";
-  }
-
-  return PRODUCT_NAMES[index % nameCount];
+void RegisterMode::resetCart() {
+  cart_.clear();
+  scrollOffset_ = 0;
 }
 
 /**
- * FNV-1a 32bitハッシュ値を返します。
+ * 明細の表示位置をずらせる最大行数を返します。
  */
-uint32_t RegisterMode::fnv1a32(const String& input) const {
-  uint32_t hash = 2166136261UL;
-  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(input.c_str());
-  const size_t length = input.length();
+size_t RegisterMode::getMaxScrollOffset() const {
+  return cart_.getMaxScrollOffset(ITEM_VISIBLE_ROWS);
+}
 
-  for (size_t index = 0; index < length; ++index) {
-    hash ^= bytes[index];
-    hash *= 16777619UL;
+/**
+ * 明細の表示位置を指定行数だけずらします。
+ * ※正の値で古い明細側へ、負の値で新しい明細側へ移動します。
+ */
+void RegisterMode::scrollCart(const int rowDelta) {
+  const int maxOffset = static_cast<int>(getMaxScrollOffset());
+  const int offset = std::min(std::max(static_cast<int>(scrollOffset_) + rowDelta, 0), maxOffset);
+  if (offset == static_cast<int>(scrollOffset_)) {
+    return;
   }
 
-  return hash;
+  scrollOffset_ = static_cast<size_t>(offset);
+  refreshNormalScreen();
 }
 
 /**
- * バーコード文字列から商品情報を決定します。
+ * 文字列を中央揃えで描画します。
  */
-RegisterMode::Item RegisterMode::resolveItemFromCode(const String& code) const {
-  const size_t nameCount = getProductNameCount();
-
-  if (nameCount == 0) {
-    return Item{"しょうひん", PRICE_MIN};
-  }
+void RegisterMode::drawCenteredText(const String& text, const int y) const {
+  const int x = (surface().width() - surface().textWidth(text)) / 2;
+  surface().setCursor(std::max(x, 0), y);
+  surface().print(text);
+}
 
-  const uint32_t nameHash = fnv1a32(code + "|NAME|v1");
-  const size_t nameIndex = nameHash % nameCount;
+/**
+ * 指定矩形の中央に文字列を描画します。
+ */
+void RegisterMode::drawCenteredTextInRect(const String& text, const Rect& rect) const {
+  const int x = rect.x + (rect.w - surface().textWidth(text)) / 2;
+  const int y = rect.y + (rect.h - surface().fontHeight()) / 2;
+  surface().setCursor(std::max(x, 0), std::max(y, 0));
+  surface().print(text);
+}
 
-  const uint32_t priceHash = fnv1a32(code + "|PRICE|v1");
-  const int step = static_cast<int>(priceHash % PRICE_LEVELS);
-  const int price = PRICE_MIN + step * PRICE_STEP;
+/**
+ * CLEARボタンを描画します。
+ */
+void RegisterMode::drawClearButton(const Rect& clearButtonRect) const {
+  surface().fillRoundRect(
+    clearButtonRect.x,
+    clearButtonRect.y,
+    clearButtonRect.w,
+    clearButtonRect.h,
+    6,
+    TFT_RED
+  );
 
-  return Item{String(getProductName(nameIndex)), price};
+  surface().setFont(BUTTON_FONT);
+  surface().setTextColor(TFT_WHITE, TFT_RED);
+  drawCenteredTextInRect("CLEAR", clearButtonRect);
+  surface().setFont(BODY_FONT);
+  surface().setTextColor(TFT_BLACK, TFT_WHITE);
 }
 
 /**
- * カート内の合計金額を返します。
+ * 明細の罫線を描画します。
  */
-int RegisterMode::calculateTotalSum() const {
-  int total = 0;
-
-  for (const Item& item : cart_) {
-    total += item.price;
+void RegisterMode::drawItemRules(const int displayWidth) const {
+  for (int rowIndex = 0; rowIndex < ITEM_VISIBLE_ROWS; ++rowIndex) {
+    const int ruleY = LIST_START_Y + rowIndex * ITEM_ROW_HEIGHT + ITEM_RULE_OFFSET_Y;
+    surface().drawFastHLine(8, ruleY, displayWidth - 16, TFT_DARKGREY);
   }
-
-  return total;
 }
 
 /**
- * フレームバッファを上限長まで切り詰めます。
+ * カートの内容によらない通常画面の要素を描画します。
  */
-void RegisterMode::trimFrameBuffer(String& buffer) const {
-  if (buffer.length() <= FRAME_BUFFER_MAX_LENGTH) {
-    return;
-  }
+void RegisterMode::drawNormalChrome(const int displayWidth) const {
+  surface().fillScreen(TFT_WHITE);
+  drawBackButton();
+  surface().setCursor(CAPTION_X, CAPTION_Y);
+  surface().print("おうちレジ");
+  drawClearButton(getClearButtonRect());
+  drawItemRules(displayWidth);
+}
 
-  buffer.remove(0, buffer.length() - FRAME_BUFFER_MAX_LENGTH);
+/**
+ * 明細送りボタンを1つ描画します。
+ */
+void RegisterMode::drawScrollButton(const Rect& buttonRect, const bool isUp, const bool isEnabled) const {
+  const int centerX = buttonRect.x + buttonRect.w / 2;
+  const int centerY = buttonRect.y + buttonRect.h / 2;
+  const int halfW = buttonRect.w / 4;
+  const int halfH = buttonRect.h / 5;
+  const int tipY = isUp ? centerY - halfH : centerY + halfH;
+  const int baseY = isUp ? centerY + halfH : centerY - halfH;
+
+  surface().fillRoundRect(
+    buttonRect.x,
+    buttonRect.y,
+    buttonRect.w,
+    buttonRect.h,
+    6,
+    isEnabled ? TFT_NAVY : TFT_LIGHTGREY
+  );
+  surface().fillTriangle(centerX, tipY, centerX - halfW, baseY, centerX + halfW, baseY, TFT_WHITE);
 }
 
 /**
- * 入力文字列を整形し、有効な長さかを返します。
+ * 明細送りボタンを描画します。
  */
-bool RegisterMode::tryNormalizeInput(const String& rawInput, String& normalizedInput) const {
-  normalizedInput = rawInput;
-  normalizedInput.trim();
-  return normalizedInput.length() >= 2;
+void RegisterMode::drawScrollButtons() const {
+  const uint8_t scrollState = getScrollState();
+  drawScrollButton(getScrollUpButtonRect(), true, (scrollState & SCROLL_STATE_CAN_SCROLL_UP) != 0);
+  drawScrollButton(getScrollDownButtonRect(), false, (scrollState & SCROLL_STATE_CAN_SCROLL_DOWN) != 0);
 }
 
 /**
- * バーコードスキャナの制御応答フレームかを判定します。
+ * 明細送りボタンの押下可否を表すビット値を返します。
  */
-bool RegisterMode::isBarcodeControlResponse(const String& frame) const {
-  if (frame == "3u") {
-    return true;
+uint8_t RegisterMode::getScrollState() const {
+  uint8_t scrollState = 0;
+
+  if (scrollOffset_ > 0) {
+    scrollState |= SCROLL_STATE_CAN_SCROLL_UP;
   }
 
-  if (frame.length() <= 4 && (frame.startsWith("\"") || frame.startsWith("$"))) {
-    return true;
+  if (scrollOffset_ < getMaxScrollOffset()) {
+    scrollState |= SCROLL_STATE_CAN_SCROLL_DOWN;
   }
 
-  return false;
+  return scrollState;
 }
 
 /**
- * UTF-8文字列の末尾1文字を除去した文字列を返します。
+ * 指定行に表示する商品情報を返します。
  */
-String RegisterMode::removeLastUtf8Character(const String& text) const {
-  if (text.isEmpty()) {
-    return text;
-  }
-
-  int index = text.length() - 1;
-  while (index > 0) {
-    const uint8_t byte = static_cast<uint8_t>(text[index]);
-    if ((byte & 0xC0) != 0x80) {
-      break;
-    }
-    --index;
+RegisterMode::Item RegisterMode::getVisibleRowItem(const int rowIndex) const {
+  Item item = {nullptr, 0, 0};
+  if (rowIndex >= ITEM_VISIBLE_ROWS || !cart_.getNewest(scrollOffset_ + rowIndex, item)) {
+    return Item{nullptr, 0, 0};
   }
 
-  return text.substring(0, index);
+  return item;
 }
 
 /**
- * 表示幅に収まるように必要時のみ省略記号を付与します。
+ * 明細1行の表示領域を返します。
  */
-String RegisterMode::ellipsizeText(const String& text, const int maxWidth) const {
-  if (M5.Display.textWidth(text) <= maxWidth) {
-    return text;
-  }
-
-  const String ellipsis = "...";
-  const int ellipsisWidth = M5.Display.textWidth(ellipsis);
-  String shortened = text;
+RegisterMode::Rect RegisterMode::getItemRowRect(const int rowIndex, const int displayWidth) const {
+  return Rect{0, LIST_START_Y + rowIndex * ITEM_ROW_HEIGHT, displayWidth, ITEM_RULE_OFFSET_Y};
+}
 
-  while (!shortened.isEmpty() && M5.Display.textWidth(shortened) + ellipsisWidth > maxWidth) {
-    shortened = removeLastUtf8Character(shortened);
-  }
+/**
+ * 合計金額表示の表示領域を返します。
+ */
+RegisterMode::Rect RegisterMode::getTotalSummaryRect(const int displayHeight) const {
+  surface().setFont(SUMMARY_FONT);
+  const int amountY = std::max(displayHeight - surface().fontHeight() - SUMMARY_MARGIN_BOTTOM, 0);
+  surface().setFont(BODY_FONT);
 
-  return shortened + ellipsis;
+  // 右側のCLEARボタンとは重ならない幅に限定します。
+  return Rect{0, amountY, getClearButtonRect().x, displayHeight - amountY};
 }
 
 /**
- * 文字列を中央揃えで描画します。
+ * 矩形同士が重なるかを返します。
  */
-void RegisterMode::drawCenteredText(const String& text, const int y) const {
-  const int x = (M5.Display.width() - M5.Display.textWidth(text)) / 2;
-  M5.Display.setCursor(std::max(x, 0), y);
-  M5.Display.print(text);
+bool RegisterMode::doRectsIntersect(const Rect& a, const Rect& b) const {
+  return a.x < b.x + b.w && b.x < a.x + a.w
+    && a.y < b.y + b.h && b.y < a.y + a.h;
 }
 
 /**
- * 指定矩形の中央に文字列を描画します。
+ * 2つの矩形を包含する矩形を返します。
  */
-void RegisterMode::drawCenteredTextInRect(const String& text, const Rect& rect) const {
-  const int x = rect.x + (rect.w - M5.Display.textWidth(text)) / 2;
-  const int y = rect.y + (rect.h - M5.Display.fontHeight()) / 2;
-  M5.Display.setCursor(std::max(x, 0), std::max(y, 0));
-  M5.Display.print(text);
+RegisterMode::Rect RegisterMode::unionRects(const Rect& a, const Rect& b) const {
+  const int left = std::min(a.x, b.x);
+  const int top = std::min(a.y, b.y);
+  const int right = std::max(a.x + a.w, b.x + b.w);
+  const int bottom = std::max(a.y + a.h, b.y + b.h);
+  return Rect{left, top, right - left, bottom - top};
 }
 
 /**
- * CLEARボタンを描画します。
+ * 商品名と価格の文字列を事前にスプライトへ描画します。
  */
-void RegisterMode::drawClearButton(const Rect& clearButtonRect) const {
-  M5.Display.fillRoundRect(
-    clearButtonRect.x,
-    clearButtonRect.y,
-    clearButtonRect.w,
-    clearButtonRect.h,
-    6,
-    TFT_RED
-  );
+void RegisterMode::prerenderRowTexts() {
+  if (!ENABLE_ROW_TEXT_PRERENDER || rowTextAtlas_.isEnabled()) {
+    return;
+  }
 
-  M5.Display.setFont(BUTTON_FONT);
-  M5.Display.setTextColor(TFT_WHITE, TFT_RED);
-  drawCenteredTextInRect("CLEAR", clearButtonRect);
-  M5.Display.setFont(BODY_FONT);
-  M5.Display.setTextColor(TFT_BLACK, TFT_WHITE);
+  const char* texts[ROW_NAME_SLOT_COUNT + PRICE_LEVELS];
+  char priceTexts[PRICE_LEVELS][PRICE_TEXT_CAPACITY];
+
+  for (int index = 0; index < ROW_NAME_SLOT_COUNT; ++index) {
+    texts[index] = getProductName(index);
+  }
+
+  for (int level = 0; level < PRICE_LEVELS; ++level) {
+    snprintf(priceTexts[level], sizeof(priceTexts[level]), "￥%d", PRICE_MIN + level * PRICE_STEP);
+    texts[ROW_NAME_SLOT_COUNT + level] = priceTexts[level];
+  }
+
+  const uint32_t startedAtMs = millis();
+  const bool isReady = rowTextAtlas_.begin(BODY_FONT, texts, ROW_NAME_SLOT_COUNT + PRICE_LEVELS);
+  LOG_DEBUG(
+    BOOT,
+    "row text sprites=%s elapsed=%lums",
+    isReady ? "ready" : "off",
+    static_cast<unsigned long>(millis() - startedAtMs)
+  );
 }
 
 /**
- * 明細の罫線を描画します。
+ * 価格文字列の事前描画スロットを返します。
+ * ※事前描画の対象外の価格では-1を返します。
  */
-void RegisterMode::drawItemRules(const int displayWidth) const {
-  for (int rowIndex = 0; rowIndex < ITEM_VISIBLE_ROWS; ++rowIndex) {
-    const int ruleY = LIST_START_Y + rowIndex * ITEM_ROW_HEIGHT + ITEM_RULE_OFFSET_Y;
-    M5.Display.drawFastHLine(8, ruleY, displayWidth - 16, TFT_DARKGREY);
+int RegisterMode::getPriceSlot(const int price) const {
+  const int offset = price - PRICE_MIN;
+  if (offset < 0 || offset % PRICE_STEP != 0 || offset / PRICE_STEP >= PRICE_LEVELS) {
+    return -1;
   }
+
+  return ROW_NAME_SLOT_COUNT + offset / PRICE_STEP;
 }
 
 /**
- * 明細の表示対象を最新件数に切り詰めます。
+ * 明細1行を描画します。
  */
-void RegisterMode::trimCartForDisplay() {
-  while (static_cast<int>(cart_.size()) > ITEM_VISIBLE_ROWS) {
-    cart_.erase(cart_.begin());
+void RegisterMode::drawItemRow(const Item& item, const int rowIndex, const int displayWidth) const {
+  if (item.price == 0) {
+    return;
+  }
+
+  const int rowY = LIST_START_Y + rowIndex * ITEM_ROW_HEIGHT;
+  const int priceSlot = getPriceSlot(item.price);
+  const int priceSpriteWidth = priceSlot < 0 ? -1 : rowTextAtlas_.getWidth(priceSlot);
+  if (priceSpriteWidth >= 0) {
+    // 事前描画済みの文字列を転送し、グリフの展開を省きます。
+    const int priceX = std::max(displayWidth - 12 - priceSpriteWidth, 12);
+    const int nameMaxWidth = std::max(priceX - 24, 0);
+    const size_t nameSlot = item.nameIndex % ROW_NAME_SLOT_COUNT;
+    rowTextAtlas_.draw(surface(), priceSlot, priceX, rowY + ITEM_TEXT_OFFSET_Y, displayWidth);
+
+    // 登録カタログの商品名は事前描画の対象外のため、その場で描画します。
+    const bool isCatalogName = item.nameIndex == CATALOG_NAME_INDEX;
+    if (isCatalogName || !rowTextAtlas_.draw(surface(), nameSlot, 12, rowY + ITEM_TEXT_OFFSET_Y, nameMaxWidth)) {
+      GfxTextMetrics metrics(surface());
+      surface().setCursor(12, rowY + ITEM_TEXT_OFFSET_Y);
+      surface().print(nameFitCache_.fit(metrics, item.name, nameMaxWidth));
+    }
+    return;
   }
+
+  const String priceText = "￥" + String(item.price);
+  const int priceX = std::max(displayWidth - 12 - surface().textWidth(priceText), 12);
+  const int nameMaxWidth = std::max(priceX - 24, 0);
+  GfxTextMetrics metrics(surface());
+  const char* nameText = nameFitCache_.fit(metrics, item.name, nameMaxWidth);
+
+  surface().setCursor(12, rowY + ITEM_TEXT_OFFSET_Y);
+  surface().print(nameText);
+  surface().setCursor(priceX, rowY + ITEM_TEXT_OFFSET_Y);
+  surface().print(priceText);
 }
 
 /**
  * 明細一覧を描画します。
  */
 void RegisterMode::drawCartItems(const int displayWidth) const {
-  const int lastIndex = static_cast<int>(cart_.size()) - 1;
-  const int firstIndex = std::max(lastIndex - ITEM_VISIBLE_ROWS + 1, 0);
-
-  int rowY = LIST_START_Y;
-  for (int index = lastIndex; index >= firstIndex; --index) {
-    const String priceText = "￥" + String(cart_[index].price);
-    const int priceX = std::max(displayWidth - 12 - M5.Display.textWidth(priceText), 12);
-    const int nameMaxWidth = std::max(priceX - 24, 0);
-    const String nameText = ellipsizeText(cart_[index].name, nameMaxWidth);
-
-    M5.Display.setCursor(12, rowY + ITEM_TEXT_OFFSET_Y);
-    M5.Display.print(nameText);
-    M5.Display.setCursor(priceX, rowY + ITEM_TEXT_OFFSET_Y);
-    M5.Display.print(priceText);
-    rowY += ITEM_ROW_HEIGHT;
+  for (int rowIndex = 0; rowIndex < ITEM_VISIBLE_ROWS; ++rowIndex) {
+    drawItemRow(getVisibleRowItem(rowIndex), rowIndex, displayWidth);
   }
 }
 
@@ -509,180 +881,349 @@ void RegisterMode::drawCartItems(const int displayWidth) const {
  */
 void RegisterMode::drawTotalSummary(const int displayHeight) const {
   const String labelText = "計";
-  const String amountText = "￥" + String(calculateTotalSum());
+  const String amountText = "￥" + String(cart_.getTotal());
 
-  M5.Display.setFont(SUMMARY_FONT);
-  const int amountY = std::max(displayHeight - M5.Display.fontHeight() - 4, 0);
-  const int amountHeight = M5.Display.fontHeight();
+  surface().setFont(SUMMARY_FONT);
+  const int amountY = std::max(displayHeight - surface().fontHeight() - SUMMARY_MARGIN_BOTTOM, 0);
+  const int amountHeight = surface().fontHeight();
 
-  M5.Display.setFont(BODY_FONT);
-  const int labelHeight = M5.Display.fontHeight();
+  surface().setFont(BODY_FONT);
+  const int labelHeight = surface().fontHeight();
   const int labelY = std::max(amountY + std::max(amountHeight - labelHeight, 0) - 5, 0);
-  M5.Display.setCursor(8, labelY);
-  M5.Display.print(labelText);
-  const int amountX = 8 + M5.Display.textWidth(labelText) + 8;
-
-  M5.Display.setFont(SUMMARY_FONT);
-  M5.Display.setCursor(amountX, amountY);
-  M5.Display.print(amountText);
+  surface().setCursor(8, labelY);
+  surface().print(labelText);
+  const int amountX = 8 + surface().textWidth(labelText) + 8;
+
+  surface().setFont(SUMMARY_FONT);
+  surface().setCursor(amountX, amountY);
+  surface().print(amountText);
+  surface().setFont(BODY_FONT);
 }
 
 /**
  * 通常画面を描画します。
  */
-void RegisterMode::renderNormalScreen() const {
-  M5.Display.setFont(BODY_FONT);
-  M5.Display.setTextColor(TFT_BLACK, TFT_WHITE);
+void RegisterMode::renderNormalScreen() {
+  const ScopedTimer timer(PerfSection::RENDER_NORMAL);
+  surface().setFont(BODY_FONT);
+  surface().setTextColor(TFT_BLACK, TFT_WHITE);
+
+  const int displayWidth = surface().width();
+  const int displayHeight = surface().height();
+
+  // カートの内容によらない要素は初回だけ描いて保存し、以降は書き戻すだけにします。
+  if (!restoreCachedScreen(CachedScreen::REGISTER_CHROME)) {
+    drawNormalChrome(displayWidth);
+    cacheScreen(CachedScreen::REGISTER_CHROME);
+  }
+
+  drawScrollButtons();
+  drawCartItems(displayWidth);
+  drawTotalSummary(displayHeight);
+  presentSurface();
+
+  for (int rowIndex = 0; rowIndex < ITEM_VISIBLE_ROWS; ++rowIndex) {
+    renderedRows_[rowIndex] = getVisibleRowItem(rowIndex);
+  }
+  renderedTotal_ = cart_.getTotal();
+  renderedScrollState_ = getScrollState();
+  dirtyRectCount_ = 0;
+}
+
+/**
+ * 再描画が必要な領域を登録し、近接する領域を統合します。
+ */
+void RegisterMode::markDirty(const Rect& rect) {
+  Rect merged = rect;
+
+  // 統合で増える面積が小さい領域同士はまとめて1回で転送します。
+  size_t index = 0;
+  while (index < dirtyRectCount_) {
+    const Rect& current = dirtyRects_[index];
+    const Rect candidate = unionRects(merged, current);
+    const int separateArea = merged.w * merged.h + current.w * current.h;
+
+    if (candidate.w * candidate.h - separateArea > DIRTY_MERGE_SLACK_PIXELS) {
+      ++index;
+      continue;
+    }
+
+    merged = candidate;
+    dirtyRects_[index] = dirtyRects_[dirtyRectCount_ - 1];
+    --dirtyRectCount_;
+    index = 0;
+  }
+
+  if (dirtyRectCount_ < DIRTY_RECT_CAPACITY) {
+    dirtyRects_[dirtyRectCount_] = merged;
+    ++dirtyRectCount_;
+    return;
+  }
+
+  // 上限に達した場合は最後の領域へ取り込みます。
+  Rect& last = dirtyRects_[DIRTY_RECT_CAPACITY - 1];
+  last = unionRects(merged, last);
+}
+
+/**
+ * 表示内容が変わった明細行と合計金額表示を再描画対象に登録します。
+ */
+void RegisterMode::invalidateChangedRegions() {
+  const int displayWidth = surface().width();
+
+  for (int rowIndex = 0; rowIndex < ITEM_VISIBLE_ROWS; ++rowIndex) {
+    const Item item = getVisibleRowItem(rowIndex);
+    Item& renderedItem = renderedRows_[rowIndex];
+    if (item.price == renderedItem.price && item.name == renderedItem.name) {
+      continue;
+    }
+
+    renderedItem = item;
+    markDirty(getItemRowRect(rowIndex, displayWidth));
+  }
+
+  const int total = cart_.getTotal();
+  if (total != renderedTotal_) {
+    renderedTotal_ = total;
+    markDirty(getTotalSummaryRect(surface().height()));
+  }
+
+  const uint8_t scrollState = getScrollState();
+  if (scrollState != renderedScrollState_) {
+    renderedScrollState_ = scrollState;
+    markDirty(unionRects(getScrollUpButtonRect(), getScrollDownButtonRect()));
+  }
+}
 
-  const int displayWidth = M5.Display.width();
-  const int displayHeight = M5.Display.height();
+/**
+ * 再描画対象の領域だけを描画し直します。
+ */
+void RegisterMode::flushDirtyRegions() {
+  if (dirtyRectCount_ == 0) {
+    return;
+  }
+
+  const ScopedTimer timer(PerfSection::FLUSH_DIRTY);
+
+  const int displayWidth = surface().width();
+  const int displayHeight = surface().height();
   const Rect clearButtonRect = getClearButtonRect();
+  const Rect captionRect{0, 0, displayWidth, LIST_START_Y};
+  const Rect summaryRect = getTotalSummaryRect(displayHeight);
+
+  surface().setFont(BODY_FONT);
+  surface().setTextColor(TFT_BLACK, TFT_WHITE);
+  surface().startWrite();
+
+  for (size_t index = 0; index < dirtyRectCount_; ++index) {
+    const Rect& dirtyRect = dirtyRects_[index];
+    surface().setClipRect(dirtyRect.x, dirtyRect.y, dirtyRect.w, dirtyRect.h);
+
+    // 統合された領域に掛かる静的要素は保存済みの画面から書き戻し、保存がなければ切り抜き範囲内で描き直します。
+    const bool isChromeRestored = restoreCachedScreenRect(
+      CachedScreen::REGISTER_CHROME,
+      dirtyRect.x,
+      dirtyRect.y,
+      dirtyRect.w,
+      dirtyRect.h
+    );
+    if (!isChromeRestored) {
+      surface().fillRect(dirtyRect.x, dirtyRect.y, dirtyRect.w, dirtyRect.h, TFT_WHITE);
 
-  M5.Display.fillScreen(TFT_WHITE);
-  M5.Display.setCursor(8, CAPTION_Y);
-  M5.Display.print("おうちレジ");
+      if (doRectsIntersect(dirtyRect, captionRect)) {
+        drawBackButton();
+        surface().setCursor(CAPTION_X, CAPTION_Y);
+        surface().print("おうちレジ");
+      }
 
-  drawClearButton(clearButtonRect);
-  drawItemRules(displayWidth);
-  drawCartItems(displayWidth);
-  drawTotalSummary(displayHeight);
+      if (doRectsIntersect(dirtyRect, clearButtonRect)) {
+        drawClearButton(clearButtonRect);
+      }
+
+      drawItemRules(displayWidth);
+    }
+
+    if (doRectsIntersect(dirtyRect, captionRect)) {
+      drawScrollButtons();
+    }
+
+    for (int rowIndex = 0; rowIndex < ITEM_VISIBLE_ROWS; ++rowIndex) {
+      if (doRectsIntersect(dirtyRect, getItemRowRect(rowIndex, displayWidth))) {
+        drawItemRow(renderedRows_[rowIndex], rowIndex, displayWidth);
+      }
+    }
+
+    if (doRectsIntersect(dirtyRect, summaryRect)) {
+      drawTotalSummary(displayHeight);
+    }
+  }
+
+  surface().clearClipRect();
+  surface().endWrite();
+
+  for (size_t index = 0; index < dirtyRectCount_; ++index) {
+    presentSurfaceRows(dirtyRects_[index].y, dirtyRects_[index].h);
+  }
+  dirtyRectCount_ = 0;
+}
+
+/**
+ * 通常画面の変化した領域だけを更新します。
+ */
+void RegisterMode::refreshNormalScreen() {
+  invalidateChangedRegions();
+  flushDirtyRegions();
 }
 
 /**
  * 決済完了画面を描画します。
+ * ※2回目以降は保存済みの画面を転送します。
  */
 void RegisterMode::renderThankYouScreen() const {
-  const int centerY = M5.Display.height() / 2;
+  if (presentCachedScreen(CachedScreen::THANK_YOU)) {
+    return;
+  }
+
+  const int centerY = surface().height() / 2;
 
-  M5.Display.fillScreen(TFT_WHITE);
-  M5.Display.setFont(BODY_FONT);
-  M5.Display.setTextColor(TFT_BLACK, TFT_WHITE);
+  surface().fillScreen(TFT_WHITE);
+  surface().setFont(BODY_FONT);
+  surface().setTextColor(TFT_BLACK, TFT_WHITE);
   drawCenteredText("お買いあげ", centerY - 24);
   drawCenteredText("ありがとうございます", centerY + 8);
+  cacheScreen(CachedScreen::THANK_YOU);
+  presentSurface();
 }
 
 /**
  * カートを空にして通常画面を更新します。
  */
 void RegisterMode::clearCart() {
-  cart_.clear();
-  renderNormalScreen();
+  resetCart();
+  refreshNormalScreen();
 }
 
 /**
  * バーコード文字列を処理します。
  */
-void RegisterMode::handleBarcodeCode(const String& rawCode) {
+void RegisterMode::handleBarcodeCode(const char* rawCode, const size_t length) {
   if (appState_ != AppState::NORMAL) {
     return;
   }
 
-  if (isBarcodeControlResponse(rawCode)) {
+  const TextSpan rawSpan = {rawCode, length};
+  if (isBarcodeControlResponse(rawSpan)) {
+    return;
+  }
+
+  TextSpan code;
+  if (!tryNormalizeInput(rawSpan, code)) {
     return;
   }
 
-  String code;
-  if (!tryNormalizeInput(rawCode, code)) {
+  if (code.length < static_cast<size_t>(BARCODE_MIN_VALID_LENGTH)) {
     return;
   }
 
-  if (code.length() < BARCODE_MIN_VALID_LENGTH) {
+  pendingScanTrace_.acceptedAtUs = micros();
+  loadGenerator_.recordScan(code.data, code.length);
+  LOG_DEBUG(BC, "code=%.*s", static_cast<int>(code.length), code.data);
+
+  const Item item = resolveItemFromCode(catalog_, code.data, code.length);
+  pendingScanTrace_.resolvedAtUs = micros();
+  if (!addCartItem(item)) {
+    LOG_WARN(BC, "cart full, item rejected count=%u", static_cast<unsigned>(cart_.size()));
+    playErrorTone();
     return;
   }
 
-  logDebug("[BC] code=" + code);
   playScanTone();
 
-  const Item item = resolveItemFromCode(code);
-  cart_.push_back(item);
-  trimCartForDisplay();
-  renderNormalScreen();
+  pendingScanTrace_.renderStartedAtUs = micros();
+  refreshNormalScreen();
+  pendingScanTrace_.pushedAtUs = micros();
+  scanTraceLog_.record(pendingScanTrace_);
 }
 
 /**
  * RFID UID文字列を処理します。
+ * ※負荷試験の疑似入力では決済の記録を残しません。
  */
-void RegisterMode::handleRfidUid(const String& rawUid) {
+void RegisterMode::handleRfidUid(const char* rawUid, const size_t length, const bool isSynthetic) {
   if (appState_ != AppState::NORMAL) {
     return;
   }
 
-  String uid;
-  if (!tryNormalizeInput(rawUid, uid)) {
+  const TextSpan rawSpan = {rawUid, length};
+  TextSpan uid;
+  if (!tryNormalizeInput(rawSpan, uid)) {
     return;
   }
 
-  logDebug("[RFID] uid=" + uid);
+  LOG_DEBUG(RFID, "uid=%.*s", static_cast<int>(uid.length), uid.data);
 
-  cart_.clear();
+  // 書き込み待ちへ積むだけで戻り、フラッシュへの書き込みは決済完了画面の表示後に記録タスクが行います。
+  if (ENABLE_TRANSACTION_JOURNAL && !isSynthetic) {
+    journal_.append(cart_, uid.data, uid.length, getRtcUnixTime());
+  }
+
+  resetCart();
   appState_ = AppState::THANK_YOU;
-  thankYouStartedAtMs_ = millis();
+  thankYouJobId_ = scheduler().scheduleOnce(millis(), THANK_YOU_DURATION_MS, runThankYouTimeoutJob, this);
   renderThankYouScreen();
 
   playPaymentTone();
 }
 
 /**
- * RFIDカードのUIDを16進文字列へ変換します。
+ * RTCの日時をUNIX時刻で返します。
+ * ※未設定のRTCは2000年付近を返すため、それ以前の日時は使えないものとして扱います。
  */
-String RegisterMode::getRfidUidHex() const {
-  String uid;
+uint32_t RegisterMode::getRtcUnixTime() const {
+  if (!M5.Rtc.isEnabled()) {
+    return 0;
+  }
 
-  for (byte index = 0; index < rfidReader_.uid.size; ++index) {
-    const uint8_t value = rfidReader_.uid.uidByte[index];
-    if (value < 0x10) {
-      uid += "0";
-    }
-    uid += String(value, HEX);
+  // RTCはタッチパネルと同じ内部I2Cバスにあるため、タッチ処理タスクの読み取りと重ならないよう占有します。
+  inputPipeline().lockInternalBus();
+  const m5::rtc_datetime_t now = M5.Rtc.getDateTime();
+  inputPipeline().unlockInternalBus();
+  if (now.date.year < RTC_MIN_VALID_YEAR) {
+    return 0;
   }
 
-  uid.toUpperCase();
-  return uid;
+  struct tm calendar = {};
+  calendar.tm_year = now.date.year - 1900;
+  calendar.tm_mon = now.date.month - 1;
+  calendar.tm_mday = now.date.date;
+  calendar.tm_hour = now.time.hours;
+  calendar.tm_min = now.time.minutes;
+  calendar.tm_sec = now.time.seconds;
+  const time_t unixTime = mktime(&calendar);
+  return unixTime < 0 ? 0 : static_cast<uint32_t>(unixTime);
 }
 
 /**
- * ストリームから1フレームを読み取ります。
+ * RFIDカードのUIDを16進文字列へ変換し、文字数を返します。
  */
-bool RegisterMode::readFrame(
-  Stream& stream,
-  String& buffer,
-  String& lineOut,
-  uint32_t& lastByteAtMs,
-  const uint32_t frameGapMs
-) {
-  while (stream.available() > 0) {
-    const char ch = static_cast<char>(stream.read());
-    lastByteAtMs = millis();
-
-    if (ch == '\r' || ch == '\n') {
-      if (buffer.isEmpty()) {
-        continue;
-      }
-      lineOut = buffer;
-      buffer = "";
-      return true;
-    }
+size_t RegisterMode::getRfidUidHex(char* uidOut, const size_t capacity) const {
+  static constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+  size_t length = 0;
 
-    if (ch >= 0x20 && ch <= 0x7E) {
-      buffer += ch;
-    }
-
-    trimFrameBuffer(buffer);
-  }
-
-  if (frameGapMs > 0 && !buffer.isEmpty() && millis() - lastByteAtMs >= frameGapMs) {
-    lineOut = buffer;
-    buffer = "";
-    return true;
+  for (byte index = 0; index < rfidReader_.uid.size && length + 2 < capacity; ++index) {
+    const uint8_t value = rfidReader_.uid.uidByte[index];
+    uidOut[length++] = HEX_DIGITS[value >> 4];
+    uidOut[length++] = HEX_DIGITS[value & 0x0F];
   }
 
-  return false;
+  uidOut[length] = '\0';
+  return length;
 }
 
 /**
- * UART経由のバーコード入力を処理します。
+ * UART経由のバーコード入力を読み取り、入力イベントを発行します。
  */
-void RegisterMode::pollBarcodeSerial() {
+void RegisterMode::pollBarcodeSerial(InputPipeline& pipeline) {
   if (millis() < barcodeInputReadyAtMs_) {
     clearBarcodeSerialInput();
     return;
@@ -693,30 +1234,45 @@ void RegisterMode::pollBarcodeSerial() {
     return;
   }
 
-  String line;
-  while (readFrame(barcodeSerial_, barcodeBuffer_, line, barcodeLastByteAtMs_, BARCODE_FRAME_GAP_MS)) {
-    handleBarcodeCode(line);
+  // 読み取り前に確認し、途切れ通知より後に届いた分を同じフレームへ含めないようにします。
+  const bool hasBurstEnded = hasBarcodeBurstEnded_.exchange(false, std::memory_order_acq_rel);
+
+  FrameView frame;
+  while (barcodeReader_.read(barcodeStream_, frame, BARCODE_FRAME_GAP_MS)) {
+    pipeline.publishFrame(InputEventType::BARCODE, frame);
+    rfidPollScheduler_.onActivity(millis());
+  }
+
+  if (hasBurstEnded && barcodeReader_.takePendingFrame(frame)) {
+    pipeline.publishFrame(InputEventType::BARCODE, frame);
+    rfidPollScheduler_.onActivity(millis());
   }
 }
 
 /**
- * RFIDカード入力を処理します。
+ * RFIDカード入力を読み取り、入力イベントを発行します。
  */
-void RegisterMode::pollRfidCard() {
+void RegisterMode::pollRfidCard(InputPipeline& pipeline) {
   if (!isRfidReady_) {
     return;
   }
 
-  if (!rfidReader_.PICC_IsNewCardPresent()) {
+  // REQAの送受信はI2C越しで数msかかるため、毎周回ではなく問い合わせ間隔ごとに行います。
+  const uint32_t nowMs = millis();
+  if (!rfidPollScheduler_.shouldPoll(nowMs)) {
     return;
   }
 
-  if (!rfidReader_.PICC_ReadCardSerial()) {
+  const ScopedTimer timer(PerfSection::POLL_RFID);
+  const bool hasReadCard = rfidReader_.PICC_IsNewCardPresent() && rfidReader_.PICC_ReadCardSerial();
+  rfidPollScheduler_.onPolled(nowMs, hasReadCard);
+  if (!hasReadCard) {
     return;
   }
 
-  const String uid = getRfidUidHex();
-  handleRfidUid(uid);
+  char uid[sizeof(rfidReader_.uid.uidByte) * 2 + 1];
+  const size_t uidLength = getRfidUidHex(uid, sizeof(uid));
+  pipeline.publishText(InputEventType::RFID, uid, uidLength);
   rfidReader_.PICC_HaltA();
   rfidReader_.PCD_StopCrypto1();
 }
@@ -729,38 +1285,129 @@ void RegisterMode::handleDebugLine(const String& rawLine) {
   line.trim();
 
   if (line.startsWith("BC:")) {
-    handleBarcodeCode(line.substring(3));
+    handleBarcodeCode(line.c_str() + 3, line.length() - 3);
     return;
   }
 
   if (line.startsWith("RFID:")) {
-    handleRfidUid(line.substring(5));
+    handleRfidUid(line.c_str() + 5, line.length() - 5, false);
+    return;
+  }
+
+  if (line == "STAT") {
+    PerfStats::instance().dump();
+    return;
+  }
+
+  if (line == "STAT:RESET") {
+    PerfStats::instance().reset();
+    return;
+  }
+
+  if (line == "TRACE") {
+    scanTraceLog_.dump();
+    return;
+  }
+
+  if (line == "TRACE:RESET") {
+    scanTraceLog_.clear();
+    return;
+  }
+
+  if (line == "JOURNAL") {
+    journal_.dump(Serial);
+    return;
+  }
+
+  if (line.startsWith("BENCH:")) {
+    handleBenchCommand(line.substring(6));
+    return;
+  }
+}
+
+/**
+ * 負荷試験コマンドを処理します。
+ * ※BC/RFID,count=N,rate=Hz、REPLAY,speed=倍率(%)、STOPを受け付けます。
+ */
+void RegisterMode::handleBenchCommand(const String& arguments) {
+  const int kindEnd = arguments.indexOf(',');
+  const String kind = kindEnd < 0 ? arguments : arguments.substring(0, kindEnd);
+  bool isStarted = false;
+
+  if (kind == "STOP") {
+    loadGenerator_.stop();
+    return;
+  }
+
+  if (kind == "FILTER") {
+    const uint32_t iterations = getBenchOption(arguments, "count", BENCH_FILTER_DEFAULT_ITERATIONS);
+    runImageFilterBenchmark(BENCH_FILTER_WIDTH, BENCH_FILTER_HEIGHT, iterations);
     return;
   }
+
+  if (kind == "BC" || kind == "RFID") {
+    const uint32_t count = getBenchOption(arguments, "count", BENCH_DEFAULT_COUNT);
+    const uint32_t rateHz = getBenchOption(arguments, "rate", BENCH_DEFAULT_RATE_HZ);
+    isStarted = loadGenerator_.startSynthetic(kind == "BC" ? LoadKind::BARCODE : LoadKind::RFID, count, rateHz);
+  } else if (kind == "REPLAY") {
+    isStarted = loadGenerator_.startReplay(getBenchOption(arguments, "speed", 100));
+  }
+
+  if (!isStarted) {
+    LOG_WARN(PERF, "bench rejected args=%s", arguments.c_str());
+    return;
+  }
+
+  if (!scheduler().isScheduled(benchFinishJobId_)) {
+    benchFinishJobId_ = scheduler().schedulePeriodic(millis(), BENCH_FINISH_CHECK_INTERVAL_MS, runBenchFinishJob, this);
+  }
 }
 
 /**
- * USBシリアルからのテスト入力を処理します。
+ * 負荷試験コマンドから指定名の数値オプションを返します。
  */
-void RegisterMode::pollDebugSerial() {
-  String line;
-  while (readFrame(Serial, debugBuffer_, line, debugLastByteAtMs_, DEBUG_FRAME_GAP_MS)) {
-    handleDebugLine(line);
+uint32_t RegisterMode::getBenchOption(const String& arguments, const char* name, const uint32_t defaultValue) const {
+  const String key = String(",") + name + "=";
+  const int keyIndex = arguments.indexOf(key);
+  if (keyIndex < 0) {
+    return defaultValue;
   }
+
+  const long value = arguments.substring(keyIndex + key.length()).toInt();
+  return value > 0 ? static_cast<uint32_t>(value) : defaultValue;
 }
 
 /**
- * ありがとう画面の終了タイマーを処理します。
+ * USBシリアルからのテスト入力を読み取り、入力イベントを発行します。
  */
-void RegisterMode::updateThankYouState() {
-  if (appState_ != AppState::THANK_YOU) {
-    return;
+void RegisterMode::pollDebugSerial(InputPipeline& pipeline) {
+  FrameView frame;
+  while (debugReader_.read(debugStream_, frame, DEBUG_FRAME_GAP_MS)) {
+    pipeline.publishFrame(InputEventType::DEBUG_LINE, frame);
   }
+}
 
-  if (millis() - thankYouStartedAtMs_ < THANK_YOU_DURATION_MS) {
+/**
+ * ありがとう画面を閉じて通常画面へ戻すタイムアウトジョブです。
+ */
+void RegisterMode::runThankYouTimeoutJob(void* context) {
+  RegisterMode* mode = static_cast<RegisterMode*>(context);
+  mode->thankYouJobId_ = DeadlineScheduler::INVALID_JOB_ID;
+  if (mode->appState_ != AppState::THANK_YOU) {
     return;
   }
 
-  appState_ = AppState::NORMAL;
-  renderNormalScreen();
+  mode->appState_ = AppState::NORMAL;
+  mode->renderNormalScreen();
+}
+
+/**
+ * 負荷試験の終了を確認する定期ジョブです。
+ * ※結果を出力したら自身を取り消します。
+ */
+void RegisterMode::runBenchFinishJob(void* context) {
+  RegisterMode* mode = static_cast<RegisterMode*>(context);
+  if (mode->loadGenerator_.tryFinish() || !mode->loadGenerator_.isActive()) {
+    scheduler().cancel(mode->benchFinishJobId_);
+  }
 }
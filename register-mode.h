@@ -4,9 +4,21 @@
 #include <M5Unified.h>
 #include <MFRC522_I2C.h>
 
-#include <vector>
-
+#include <atomic>
+
+#include "arduino-adapters.h"
+#include "catalog-index.h"
+#include "catalog-partition.h"
+#include "frame-reader.h"
+#include "input-text.h"
+#include "load-generator.h"
 #include "mode-base.h"
+#include "register-cart.h"
+#include "rfid-poll-scheduler.h"
+#include "scan-trace-log.h"
+#include "text-fit-cache.h"
+#include "text-sprite-atlas.h"
+#include "transaction-journal.h"
 
 /**
  * おうちレジモードを提供します。
@@ -29,24 +41,47 @@ class RegisterMode : public ModeBase {
   RegisterMode();
 
   /**
-   * 周辺機器を初期化します。
+   * 周辺機器の起動処理を準備し、登録カタログと決済記録のパーティションを開きます。
+   * ※実際の初期化は入力処理タスクのadvanceBootで段階的に進めます。
    */
   void initialize(const Pins& pins);
 
+  /**
+   * 周辺機器の起動処理を1段階ずつ進め、完了したかを返します。
+   */
+  bool advanceBoot() override;
+
   /**
    * モード遷移時に通常画面を表示します。
    */
   void enter() override;
 
+  /**
+   * モードから離れる際に、ありがとう画面のタイムアウトを取り消し、負荷試験を止めます。
+   * ※カートと事前描画した文字列は再入時のために保持します。
+   */
+  void exit() override;
+
   /**
    * タップ入力を処理します。
    */
   void onTouch(int touchX, int touchY) override;
 
   /**
-   * モードの定期更新を処理します。
+   * タッチ操作を処理します。
+   * ※上下のスワイプで明細を送り、それ以外は共通の処理へ渡します。
+   */
+  void onTouchEvent(const TouchEvent& event) override;
+
+  /**
+   * 入力処理タスクでバーコード、RFID、USBシリアルを読み取ります。
+   */
+  void pollInput(InputPipeline& pipeline) override;
+
+  /**
+   * 入力処理タスクから届いた入力イベントを処理します。
    */
-  void update() override;
+  void onInputEvent(const InputEvent& event) override;
 
   /**
    * モード選択時の起動音を鳴らします。
@@ -62,14 +97,33 @@ class RegisterMode : public ModeBase {
     THANK_YOU,
   };
 
+  static constexpr int ITEM_VISIBLE_ROWS = 3;
+  static constexpr size_t DIRTY_RECT_CAPACITY = 4;
+
   /**
-   * 商品情報を保持します。
+   * バーコードスキャナの起動段階を表します。
+   */
+  enum class BarcodeBootStage {
+    BEGIN_SERIAL,
+    SEND_COMMAND,
+    WAIT_COMMAND_GUARD,
+    DONE,
+  };
+
+  /**
+   * RFIDリーダの起動段階を表します。
    */
-  struct Item {
-    String name;
-    int price;
+  enum class RfidBootStage {
+    BEGIN_BUS,
+    INITIALIZE_READER,
+    DONE,
   };
 
+  /**
+   * 商品情報を保持します。
+   */
+  using Item = CartItem;
+
   /**
    * 矩形領域を保持します。
    */
@@ -80,11 +134,6 @@ class RegisterMode : public ModeBase {
     int h;
   };
 
-  /**
-   * デバッグログをUSBシリアルへ出力します。
-   */
-  void logDebug(const String& message) const;
-
   /**
    * スキャン音を鳴らします。
    */
@@ -95,6 +144,11 @@ class RegisterMode : public ModeBase {
    */
   void playPaymentTone() const;
 
+  /**
+   * エラー音を鳴らします。
+   */
+  void playErrorTone() const;
+
   /**
    * バーコードUARTを初期化します。
    */
@@ -106,14 +160,25 @@ class RegisterMode : public ModeBase {
   void clearBarcodeSerialInput();
 
   /**
-   * バーコードスキャナへコマンドを送信します。
+   * バーコードスキャナへコマンドを送信し、応答を読み捨てる期限を設定します。
    */
   void sendBarcodeCommand(const uint8_t* command, size_t length);
 
   /**
-   * バーコードスキャナの起動時設定を適用します。
+   * バーコードスキャナの起動処理を1段階進めます。
+   */
+  void advanceBarcodeBoot();
+
+  /**
+   * RFIDリーダの起動処理を1段階進めます。
+   */
+  void advanceRfidBoot();
+
+  /**
+   * バーコードUARTの受信途切れを記録し、入力処理タスクを起こします。
+   * ※UARTのイベントタスクから呼び出されます。
    */
-  void applyBarcodeScannerSettings();
+  void handleBarcodeReceive();
 
   /**
    * RFIDリーダのI2C接続状態をログ出力します。
@@ -121,9 +186,15 @@ class RegisterMode : public ModeBase {
   bool checkRfidI2cStatus() const;
 
   /**
-   * RFIDリーダのバージョンレジスタ値をログ出力します。
+   * RFIDリーダのバージョンレジスタ値をログ出力し、その値を返します。
+   */
+  uint8_t logRfidVersion();
+
+  /**
+   * RFIDリーダのI2Cクロックを高速側へ切り替えます。
+   * ※切り替え後にバージョンレジスタが同じ値で読めない場合は元のクロックへ戻します。
    */
-  void logRfidVersion();
+  void tryRaiseRfidI2cClock(uint8_t expectedVersion);
 
   /**
    * CLEARボタンの表示領域を返します。
@@ -135,85 +206,124 @@ class RegisterMode : public ModeBase {
    */
   Rect getClearButtonHitRect() const;
 
+  /**
+   * 新しい明細側へ送るボタンの表示領域を返します。
+   */
+  Rect getScrollUpButtonRect() const;
+
+  /**
+   * 古い明細側へ送るボタンの表示領域を返します。
+   */
+  Rect getScrollDownButtonRect() const;
+
   /**
    * 指定座標が矩形内かを返します。
    */
   bool isPointInsideRect(int x, int y, const Rect& rect) const;
 
   /**
-   * 商品名候補数を返します。
+   * カートへ商品を追加して最新の明細を表示する位置へ戻し、追加できたかを返します。
+   * ※カートが上限件数に達している場合は追加せず、表示位置も変えません。
+   */
+  bool addCartItem(const Item& item);
+
+  /**
+   * カートを空にし、表示位置を初期化します。
+   */
+  void resetCart();
+
+  /**
+   * 明細の表示位置をずらせる最大行数を返します。
    */
-  size_t getProductNameCount() const;
+  size_t getMaxScrollOffset() const;
 
   /**
-   * 指定した添字の商品名候補を返します。
+   * 明細の表示位置を指定行数だけずらします。
+   * ※正の値で古い明細側へ、負の値で新しい明細側へ移動します。
    */
-  const char* getProductName(size_t index) const;
+  void scrollCart(int rowDelta);
 
   /**
-   * FNV-1a 32bitハッシュ値を返します。
+   * 文字列を中央揃えで描画します。
    */
-  uint32_t fnv1a32(const String& input) const;
+  void drawCenteredText(const String& text, int y) const;
 
   /**
-   * バーコード文字列から商品情報を決定します。
+   * 指定矩形の中央に文字列を描画します。
    */
-  Item resolveItemFromCode(const String& code) const;
+  void drawCenteredTextInRect(const String& text, const Rect& rect) const;
 
   /**
-   * カート内の合計金額を返します。
+   * CLEARボタンを描画します。
    */
-  int calculateTotalSum() const;
+  void drawClearButton(const Rect& clearButtonRect) const;
 
   /**
-   * フレームバッファを上限長まで切り詰めます。
+   * 明細の罫線を描画します。
    */
-  void trimFrameBuffer(String& buffer) const;
+  void drawItemRules(int displayWidth) const;
 
   /**
-   * 入力文字列を整形し、有効な長さかを返します。
+   * カートの内容によらない通常画面の要素を描画します。
+   * ※描画した内容は静的な画面として保存し、次回からは書き戻して使います。
    */
-  bool tryNormalizeInput(const String& rawInput, String& normalizedInput) const;
+  void drawNormalChrome(int displayWidth) const;
 
   /**
-   * バーコードスキャナの制御応答フレームかを判定します。
+   * 明細送りボタンを1つ描画します。
    */
-  bool isBarcodeControlResponse(const String& frame) const;
+  void drawScrollButton(const Rect& buttonRect, bool isUp, bool isEnabled) const;
 
   /**
-   * UTF-8文字列の末尾1文字を除去した文字列を返します。
+   * 明細送りボタンを描画します。
    */
-  String removeLastUtf8Character(const String& text) const;
+  void drawScrollButtons() const;
 
   /**
-   * 表示幅に収まるように必要時のみ省略記号を付与します。
+   * 明細送りボタンの押下可否を表すビット値を返します。
    */
-  String ellipsizeText(const String& text, int maxWidth) const;
+  uint8_t getScrollState() const;
 
   /**
-   * 文字列を中央揃えで描画します。
+   * 指定行に表示する商品情報を返します。
    */
-  void drawCenteredText(const String& text, int y) const;
+  Item getVisibleRowItem(int rowIndex) const;
 
   /**
-   * 指定矩形の中央に文字列を描画します。
+   * 明細1行の表示領域を返します。
    */
-  void drawCenteredTextInRect(const String& text, const Rect& rect) const;
+  Rect getItemRowRect(int rowIndex, int displayWidth) const;
 
   /**
-   * CLEARボタンを描画します。
+   * 合計金額表示の表示領域を返します。
    */
-  void drawClearButton(const Rect& clearButtonRect) const;
+  Rect getTotalSummaryRect(int displayHeight) const;
 
   /**
-   * 明細の罫線を描画します。
+   * 矩形同士が重なるかを返します。
    */
-  void drawItemRules(int displayWidth) const;
+  bool doRectsIntersect(const Rect& a, const Rect& b) const;
+
+  /**
+   * 2つの矩形を包含する矩形を返します。
+   */
+  Rect unionRects(const Rect& a, const Rect& b) const;
+
+  /**
+   * 商品名と価格の文字列を事前にスプライトへ描画します。
+   */
+  void prerenderRowTexts();
 
   /**
-   * 明細の表示対象を最新件数に切り詰めます。
+   * 価格文字列の事前描画スロットを返します。
+   * ※事前描画の対象外の価格では-1を返します。
    */
-  void trimCartForDisplay();
+  int getPriceSlot(int price) const;
+
+  /**
+   * 明細1行を描画します。
+   */
+  void drawItemRow(const Item& item, int rowIndex, int displayWidth) const;
 
   /**
    * 明細一覧を描画します。
@@ -228,10 +338,31 @@ class RegisterMode : public ModeBase {
   /**
    * 通常画面を描画します。
    */
-  void renderNormalScreen() const;
+  void renderNormalScreen();
+
+  /**
+   * 再描画が必要な領域を登録し、近接する領域を統合します。
+   */
+  void markDirty(const Rect& rect);
+
+  /**
+   * 表示内容が変わった明細行と合計金額表示を再描画対象に登録します。
+   */
+  void invalidateChangedRegions();
+
+  /**
+   * 再描画対象の領域だけを描画し直します。
+   */
+  void flushDirtyRegions();
+
+  /**
+   * 通常画面の変化した領域だけを更新します。
+   */
+  void refreshNormalScreen();
 
   /**
    * 決済完了画面を描画します。
+   * ※2回目以降は保存済みの画面を転送します。
    */
   void renderThankYouScreen() const;
 
@@ -243,38 +374,34 @@ class RegisterMode : public ModeBase {
   /**
    * バーコード文字列を処理します。
    */
-  void handleBarcodeCode(const String& rawCode);
+  void handleBarcodeCode(const char* rawCode, size_t length);
 
   /**
    * RFID UID文字列を処理します。
+   * ※負荷試験の疑似入力では決済の記録を残しません。
    */
-  void handleRfidUid(const String& rawUid);
+  void handleRfidUid(const char* rawUid, size_t length, bool isSynthetic);
 
   /**
-   * RFIDカードのUIDを16進文字列へ変換します。
+   * RTCの日時をUNIX時刻で返します。
+   * ※RTCを使えない場合は0を返します。
    */
-  String getRfidUidHex() const;
+  uint32_t getRtcUnixTime() const;
 
   /**
-   * ストリームから1フレームを読み取ります。
+   * RFIDカードのUIDを16進文字列へ変換し、文字数を返します。
    */
-  bool readFrame(
-    Stream& stream,
-    String& buffer,
-    String& lineOut,
-    uint32_t& lastByteAtMs,
-    uint32_t frameGapMs
-  );
+  size_t getRfidUidHex(char* uidOut, size_t capacity) const;
 
   /**
-   * UART経由のバーコード入力を処理します。
+   * UART経由のバーコード入力を読み取り、入力イベントを発行します。
    */
-  void pollBarcodeSerial();
+  void pollBarcodeSerial(InputPipeline& pipeline);
 
   /**
-   * RFIDカード入力を処理します。
+   * RFIDカード入力を読み取り、入力イベントを発行します。
    */
-  void pollRfidCard();
+  void pollRfidCard(InputPipeline& pipeline);
 
   /**
    * デバッグ入力1行を処理します。
@@ -282,28 +409,69 @@ class RegisterMode : public ModeBase {
   void handleDebugLine(const String& rawLine);
 
   /**
-   * USBシリアルからのテスト入力を処理します。
+   * 負荷試験コマンドを処理します。
+   * ※BC/RFID,count=N,rate=Hz、REPLAY,speed=倍率(%)、FILTER,count=N、STOPを受け付けます。
+   */
+  void handleBenchCommand(const String& arguments);
+
+  /**
+   * 負荷試験コマンドから指定名の数値オプションを返します。
+   */
+  uint32_t getBenchOption(const String& arguments, const char* name, uint32_t defaultValue) const;
+
+  /**
+   * USBシリアルからのテスト入力を読み取り、入力イベントを発行します。
+   */
+  void pollDebugSerial(InputPipeline& pipeline);
+
+  /**
+   * ありがとう画面を閉じて通常画面へ戻すタイムアウトジョブです。
    */
-  void pollDebugSerial();
+  static void runThankYouTimeoutJob(void* context);
 
   /**
-   * ありがとう画面の終了タイマーを処理します。
+   * 負荷試験の終了を確認する定期ジョブです。
    */
-  void updateThankYouState();
+  static void runBenchFinishJob(void* context);
 
   HardwareSerial barcodeSerial_;
+  ArduinoClock clock_;
+  StreamByteStream barcodeStream_;
+  StreamByteStream debugStream_;
   MFRC522_I2C rfidReader_;
-  std::vector<Item> cart_;
+  RfidPollScheduler rfidPollScheduler_;
+  RegisterCart cart_;
+  CatalogPartition catalogPartition_;
+  CatalogIndex catalog_;
+  TransactionJournal journal_;
+  Item renderedRows_[ITEM_VISIBLE_ROWS];
+  Rect dirtyRects_[DIRTY_RECT_CAPACITY];
+  size_t dirtyRectCount_;
+  int renderedTotal_;
+  uint8_t renderedScrollState_;
+  mutable TextFitCache nameFitCache_;
+  mutable TextSpriteAtlas rowTextAtlas_;
+  ScanTrace pendingScanTrace_;
+  ScanTraceLog scanTraceLog_;
+  LoadGenerator loadGenerator_;
+  size_t scrollOffset_;
   AppState appState_;
-  String barcodeBuffer_;
-  String debugBuffer_;
-  uint32_t thankYouStartedAtMs_;
-  uint32_t barcodeLastByteAtMs_;
-  uint32_t debugLastByteAtMs_;
+  FrameReader barcodeReader_;
+  FrameReader debugReader_;
+  std::atomic<bool> hasBarcodeBurstEnded_;
+  uint32_t thankYouJobId_;
+  uint32_t benchFinishJobId_;
   uint32_t barcodeCommandGuardUntilMs_;
   uint32_t barcodeInputReadyAtMs_;
+  uint32_t barcodeBootStartedAtMs_;
+  uint32_t rfidBootStartedAtMs_;
+  BarcodeBootStage barcodeBootStage_;
+  RfidBootStage rfidBootStage_;
+  size_t barcodeBootCommandIndex_;
   int barcodeRxdPin_;
   int barcodeTxdPin_;
+  int rfidSdaPin_;
+  int rfidSclPin_;
   bool isRfidReady_;
 };
 
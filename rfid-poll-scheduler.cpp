@@ -0,0 +1,61 @@
+#include "rfid-poll-scheduler.h"
+
+/**
+ * 指定した設定で初期化します。
+ */
+RfidPollScheduler::RfidPollScheduler(const Config& config)
+: config_(config),
+  nextPollAtMs_(0),
+  lastActivityAtMs_(0),
+  isDebouncing_(false) {
+}
+
+/**
+ * 問い合わせ間隔を短い状態へ戻し、すぐに問い合わせられるようにします。
+ */
+void RfidPollScheduler::reset(const uint32_t nowMs) {
+  nextPollAtMs_ = nowMs;
+  lastActivityAtMs_ = nowMs;
+  isDebouncing_ = false;
+}
+
+/**
+ * 今問い合わせるべきかを返します。
+ * ※millisの桁あふれを跨いでも判定できるよう差分で比較します。
+ */
+bool RfidPollScheduler::shouldPoll(const uint32_t nowMs) const {
+  return static_cast<int32_t>(nowMs - nextPollAtMs_) >= 0;
+}
+
+/**
+ * 問い合わせ結果を記録し、次の問い合わせ時刻を決めます。
+ */
+void RfidPollScheduler::onPolled(const uint32_t nowMs, const bool hasReadCard) {
+  if (hasReadCard) {
+    lastActivityAtMs_ = nowMs;
+    nextPollAtMs_ = nowMs + config_.debounceMs;
+    isDebouncing_ = true;
+    return;
+  }
+
+  isDebouncing_ = false;
+
+  const bool isIdle = nowMs - lastActivityAtMs_ >= config_.idleAfterMs;
+  nextPollAtMs_ = nowMs + (isIdle ? config_.idleIntervalMs : config_.activeIntervalMs);
+}
+
+/**
+ * 他の入力があったことを記録し、問い合わせ間隔を短い状態へ戻します。
+ * ※読み取り直後の待ち時間は短縮しません。
+ */
+void RfidPollScheduler::onActivity(const uint32_t nowMs) {
+  lastActivityAtMs_ = nowMs;
+  if (isDebouncing_) {
+    return;
+  }
+
+  const uint32_t activePollAtMs = nowMs + config_.activeIntervalMs;
+  if (static_cast<int32_t>(nextPollAtMs_ - activePollAtMs) > 0) {
+    nextPollAtMs_ = activePollAtMs;
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef RFID_POLL_SCHEDULER_H
+#define RFID_POLL_SCHEDULER_H
+
+#include <stdint.h>
+
+/**
+ * RFIDカード検出の問い合わせ間隔を決めます。
+ * ※問い合わせのたびにI2C越しのREQA送受信が発生するため、入力がない間は間隔を広げます。
+ */
+class RfidPollScheduler {
+ public:
+  /**
+   * 問い合わせ間隔の設定です。
+   */
+  struct Config {
+    uint32_t activeIntervalMs;
+    uint32_t idleIntervalMs;
+    uint32_t idleAfterMs;
+    uint32_t debounceMs;
+  };
+
+  /**
+   * 指定した設定で初期化します。
+   */
+  explicit RfidPollScheduler(const Config& config);
+
+  /**
+   * 問い合わせ間隔を短い状態へ戻し、すぐに問い合わせられるようにします。
+   */
+  void reset(uint32_t nowMs);
+
+  /**
+   * 今問い合わせるべきかを返します。
+   */
+  bool shouldPoll(uint32_t nowMs) const;
+
+  /**
+   * 問い合わせ結果を記録し、次の問い合わせ時刻を決めます。
+   * ※カードを読み取った直後は同じカードの再検出を避けるため、一定時間問い合わせを止めます。
+   */
+  void onPolled(uint32_t nowMs, bool hasReadCard);
+
+  /**
+   * 他の入力があったことを記録し、問い合わせ間隔を短い状態へ戻します。
+   */
+  void onActivity(uint32_t nowMs);
+
+ private:
+  Config config_;
+  uint32_t nextPollAtMs_;
+  uint32_t lastActivityAtMs_;
+  bool isDebouncing_;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+
+/**
+ * ヒープを使わずに要素を内部配列へ保持する固定長のリングバッファです。
+ * ※添字0が最も古い要素を指します。
+ */
+template <typename T, size_t Capacity>
+class RingBuffer {
+  static_assert(Capacity > 0, "Capacity must be positive");
+
+ public:
+  /**
+   * 空のリングバッファを初期化します。
+   */
+  RingBuffer()
+  : items_(),
+    start_(0),
+    size_(0) {
+  }
+
+  /**
+   * 末尾へ要素を追加します。
+   * ※満杯の場合は最も古い要素を上書きします。
+   */
+  void pushBack(const T& value) {
+    if (size_ < Capacity) {
+      items_[(start_ + size_) % Capacity] = value;
+      ++size_;
+      return;
+    }
+
+    items_[start_] = value;
+    start_ = (start_ + 1) % Capacity;
+  }
+
+  /**
+   * すべての要素を取り除きます。
+   */
+  void clear() {
+    start_ = 0;
+    size_ = 0;
+  }
+
+  /**
+   * 要素数を返します。
+   */
+  size_t size() const {
+    return size_;
+  }
+
+  /**
+   * 要素がないかを返します。
+   */
+  bool isEmpty() const {
+    return size_ == 0;
+  }
+
+  /**
+   * 満杯かを返します。
+   */
+  bool isFull() const {
+    return size_ == Capacity;
+  }
+
+  /**
+   * 最も古い要素を返します。
+   */
+  const T& front() const {
+    return items_[start_];
+  }
+
+  /**
+   * 古い順で数えた添字の要素を返します。
+   */
+  const T& operator[](const size_t index) const {
+    return items_[(start_ + index) % Capacity];
+  }
+
+ private:
+  T items_[Capacity];
+  size_t start_;
+  size_t size_;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "scan-trace-log.h"
+
+#include "logger.h"
+
+/**
+ * 空の記録を初期化します。
+ */
+ScanTraceLog::ScanTraceLog()
+: entries_(),
+  nextSequence_(0) {
+}
+
+/**
+ * 1回分の時刻から段階間の所要時間を求めて記録します。
+ * ※上限件数を超えた場合は最も古い記録を破棄します。
+ */
+void ScanTraceLog::record(const ScanTrace& trace) {
+  entries_.pushBack(Entry{
+    nextSequence_,
+    trace.frameCompletedAtUs - trace.firstByteAtUs,
+    trace.acceptedAtUs - trace.frameCompletedAtUs,
+    trace.resolvedAtUs - trace.acceptedAtUs,
+    trace.renderStartedAtUs - trace.resolvedAtUs,
+    trace.pushedAtUs - trace.renderStartedAtUs,
+  });
+  ++nextSequence_;
+}
+
+/**
+ * 記録をすべて破棄します。
+ */
+void ScanTraceLog::clear() {
+  entries_.clear();
+}
+
+/**
+ * 記録を古い順にCSV形式でログへ書き出します。
+ */
+void ScanTraceLog::dump() const {
+  LOG_INFO(TRACE, "seq,frame_us,queue_us,resolve_us,layout_us,render_us,total_us");
+
+  for (size_t index = 0; index < entries_.size(); ++index) {
+    const Entry& entry = entries_[index];
+    const uint32_t totalUs = entry.frameUs + entry.queueUs + entry.resolveUs + entry.layoutUs + entry.renderUs;
+    LOG_INFO(
+      TRACE,
+      "%lu,%lu,%lu,%lu,%lu,%lu,%lu",
+      static_cast<unsigned long>(entry.sequence),
+      static_cast<unsigned long>(entry.frameUs),
+      static_cast<unsigned long>(entry.queueUs),
+      static_cast<unsigned long>(entry.resolveUs),
+      static_cast<unsigned long>(entry.layoutUs),
+      static_cast<unsigned long>(entry.renderUs),
+      static_cast<unsigned long>(totalUs)
+    );
+  }
+}
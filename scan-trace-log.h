@@ -0,0 +1,62 @@
+#ifndef SCAN_TRACE_LOG_H
+#define SCAN_TRACE_LOG_H
+
+#include <Arduino.h>
+
+#include "ring-buffer.h"
+
+/**
+ * 1回のスキャンについて、受信から画面転送までの各段階の時刻です。
+ */
+struct ScanTrace {
+  uint32_t firstByteAtUs;
+  uint32_t frameCompletedAtUs;
+  uint32_t acceptedAtUs;
+  uint32_t resolvedAtUs;
+  uint32_t renderStartedAtUs;
+  uint32_t pushedAtUs;
+};
+
+/**
+ * スキャンごとの段階間の所要時間を直近分だけ保持し、CSVで書き出します。
+ */
+class ScanTraceLog {
+ public:
+  static constexpr size_t CAPACITY = 64;
+
+  /**
+   * 空の記録を初期化します。
+   */
+  ScanTraceLog();
+
+  /**
+   * 1回分の時刻から段階間の所要時間を求めて記録します。
+   * ※上限件数を超えた場合は最も古い記録を破棄します。
+   */
+  void record(const ScanTrace& trace);
+
+  /**
+   * 記録をすべて破棄します。
+   */
+  void clear();
+
+  /**
+   * 記録を古い順にCSV形式でログへ書き出します。
+   */
+  void dump() const;
+
+ private:
+  struct Entry {
+    uint32_t sequence;
+    uint32_t frameUs;
+    uint32_t queueUs;
+    uint32_t resolveUs;
+    uint32_t layoutUs;
+    uint32_t renderUs;
+  };
+
+  RingBuffer<Entry, CAPACITY> entries_;
+  uint32_t nextSequence_;
+};
+
+#endif
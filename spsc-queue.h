@@ -0,0 +1,69 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+
+#include <atomic>
+
+/**
+ * 単一の書き込み側と単一の読み出し側で共有するロックフリーな固定長キューです。
+ * ※Capacityは2のべき乗である必要があります。
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+ public:
+  /**
+   * 空のキューを初期化します。
+   */
+  SpscQueue()
+  : buffer_(),
+    head_(0),
+    tail_(0) {
+  }
+
+  /**
+   * 末尾へ要素を追加し、追加できたかを返します。
+   * ※書き込み側のタスクからのみ呼び出します。
+   */
+  bool push(const T& value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= Capacity) {
+      return false;
+    }
+
+    buffer_[tail & (Capacity - 1)] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * 先頭の要素を取り出し、取り出せたかを返します。
+   * ※読み出し側のタスクからのみ呼び出します。
+   */
+  bool pop(T& value) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    value = buffer_[head & (Capacity - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * 格納中の要素数を返します。
+   */
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+ private:
+  T buffer_[Capacity];
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+};
+
+#endif
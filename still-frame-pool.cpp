@@ -0,0 +1,166 @@
+#include "still-frame-pool.h"
+
+#include <esp_heap_caps.h>
+#include <string.h>
+
+/**
+ * 未確保のプールを初期化します。
+ */
+StillFramePool::StillFramePool()
+: arena_(nullptr),
+  widths_(),
+  heights_(),
+  head_(0),
+  count_(0),
+  pinnedSlotMask_(0) {
+}
+
+/**
+ * 破棄時に領域を解放します。
+ */
+StillFramePool::~StillFramePool() {
+  end();
+}
+
+/**
+ * 全スロット分の領域をPSRAMへ確保し、使えるかを返します。
+ */
+bool StillFramePool::begin() {
+  if (arena_ != nullptr) {
+    return true;
+  }
+
+  arena_ = static_cast<uint8_t*>(heap_caps_malloc(FRAME_BYTES * SLOT_CAPACITY, MALLOC_CAP_SPIRAM));
+  head_ = 0;
+  count_ = 0;
+  return arena_ != nullptr;
+}
+
+/**
+ * 領域を解放し、保持していた静止画を破棄します。
+ */
+void StillFramePool::end() {
+  if (arena_ != nullptr) {
+    heap_caps_free(arena_);
+    arena_ = nullptr;
+  }
+
+  head_ = 0;
+  count_ = 0;
+  pinnedSlotMask_.store(0, std::memory_order_release);
+}
+
+/**
+ * 領域を確保済みかを返します。
+ */
+bool StillFramePool::isEnabled() const {
+  return arena_ != nullptr;
+}
+
+/**
+ * RGB565の画素列を次のスロットへ複写し、保存できたかを返します。
+ * ※1スロットに収まらない解像度のフレームは保存しません。
+ */
+bool StillFramePool::store(const uint8_t* pixels, const size_t length, const int width, const int height) {
+  const size_t frameBytes = static_cast<size_t>(width) * height * sizeof(uint16_t);
+  if (arena_ == nullptr || pixels == nullptr || width <= 0 || height <= 0) {
+    return false;
+  }
+
+  if (frameBytes > FRAME_BYTES || length < frameBytes) {
+    return false;
+  }
+
+  const size_t slot = (head_ + count_) % SLOT_CAPACITY;
+  if ((pinnedSlotMask_.load(std::memory_order_acquire) & (1UL << slot)) != 0) {
+    return false;
+  }
+
+  memcpy(getSlotPixels(slot), pixels, frameBytes);
+  widths_[slot] = width;
+  heights_[slot] = height;
+
+  if (count_ < SLOT_CAPACITY) {
+    ++count_;
+  } else {
+    head_ = (head_ + 1) % SLOT_CAPACITY;
+  }
+  return true;
+}
+
+/**
+ * 保持している静止画の枚数を返します。
+ */
+size_t StillFramePool::size() const {
+  return count_;
+}
+
+/**
+ * 新しい方から数えた位置の静止画を取り出し、存在したかを返します。
+ */
+bool StillFramePool::getNewest(const size_t offset, StillFrame& frameOut) const {
+  if (offset >= count_) {
+    return false;
+  }
+
+  const size_t slot = (head_ + count_ - 1 - offset) % SLOT_CAPACITY;
+  frameOut.pixels = getSlotPixels(slot);
+  frameOut.width = widths_[slot];
+  frameOut.height = heights_[slot];
+  return true;
+}
+
+/**
+ * 最新の静止画のスロット番号を取り出し、存在したかを返します。
+ */
+bool StillFramePool::getNewestSlot(size_t& slotOut) const {
+  if (count_ == 0) {
+    return false;
+  }
+
+  slotOut = (head_ + count_ - 1) % SLOT_CAPACITY;
+  return true;
+}
+
+/**
+ * 指定スロットの静止画を取り出し、存在したかを返します。
+ * ※固定中のスロットは他タスクからも読み取れます。
+ */
+bool StillFramePool::getSlot(const size_t slot, StillFrame& frameOut) const {
+  if (arena_ == nullptr || slot >= SLOT_CAPACITY) {
+    return false;
+  }
+
+  frameOut.pixels = getSlotPixels(slot);
+  frameOut.width = widths_[slot];
+  frameOut.height = heights_[slot];
+  return true;
+}
+
+/**
+ * 指定スロットを上書きされないよう固定します。
+ */
+void StillFramePool::pinSlot(const size_t slot) {
+  pinnedSlotMask_.fetch_or(1UL << slot, std::memory_order_acq_rel);
+}
+
+/**
+ * スロットの固定を解除します。
+ */
+void StillFramePool::unpinSlot(const size_t slot) {
+  pinnedSlotMask_.fetch_and(~(1UL << slot), std::memory_order_acq_rel);
+}
+
+/**
+ * 固定中のスロットがあるかを返します。
+ */
+bool StillFramePool::hasPinnedSlot() const {
+  return pinnedSlotMask_.load(std::memory_order_acquire) != 0;
+}
+
+/**
+ * 撮影順の位置に対応するスロットの先頭を返します。
+ */
+uint16_t* StillFramePool::getSlotPixels(const size_t slot) const {
+  return reinterpret_cast<uint16_t*>(arena_ + FRAME_BYTES * slot);
+}
@@ -0,0 +1,117 @@
+#ifndef STILL_FRAME_POOL_H
+#define STILL_FRAME_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+/**
+ * 撮影した静止画1枚を参照します。
+ * ※プールへ次の静止画を保存すると、最も古い静止画の画素は上書きされます。
+ */
+struct StillFrame {
+  const uint16_t* pixels;
+  int width;
+  int height;
+};
+
+/**
+ * PSRAM上の固定領域に、直近に撮影した静止画を循環して保持します。
+ * ※領域はbeginで一括確保し、保存のたびには確保しません。
+ */
+class StillFramePool {
+ public:
+  static constexpr size_t SLOT_CAPACITY = 4;
+  static constexpr int FRAME_WIDTH = 320;
+  static constexpr int FRAME_HEIGHT = 240;
+  static constexpr size_t FRAME_BYTES = static_cast<size_t>(FRAME_WIDTH) * FRAME_HEIGHT * sizeof(uint16_t);
+
+  /**
+   * 未確保のプールを初期化します。
+   */
+  StillFramePool();
+
+  /**
+   * 破棄時に領域を解放します。
+   */
+  ~StillFramePool();
+
+  StillFramePool(const StillFramePool&) = delete;
+  StillFramePool& operator=(const StillFramePool&) = delete;
+
+  /**
+   * 全スロット分の領域をPSRAMへ確保し、使えるかを返します。
+   * ※確保済みの場合は何もしません。
+   */
+  bool begin();
+
+  /**
+   * 領域を解放し、保持していた静止画を破棄します。
+   */
+  void end();
+
+  /**
+   * 領域を確保済みかを返します。
+   */
+  bool isEnabled() const;
+
+  /**
+   * RGB565の画素列を次のスロットへ複写し、保存できたかを返します。
+   * ※全スロットが埋まっている場合は最も古い静止画を上書きします。上書き先が固定中の場合は保存しません。
+   */
+  bool store(const uint8_t* pixels, size_t length, int width, int height);
+
+  /**
+   * 保持している静止画の枚数を返します。
+   */
+  size_t size() const;
+
+  /**
+   * 新しい方から数えた位置の静止画を取り出し、存在したかを返します。
+   * ※0が最新の静止画です。
+   */
+  bool getNewest(size_t offset, StillFrame& frameOut) const;
+
+  /**
+   * 最新の静止画のスロット番号を取り出し、存在したかを返します。
+   */
+  bool getNewestSlot(size_t& slotOut) const;
+
+  /**
+   * 指定スロットの静止画を取り出し、存在したかを返します。
+   */
+  bool getSlot(size_t slot, StillFrame& frameOut) const;
+
+  /**
+   * 指定スロットを上書きされないよう固定します。
+   * ※他タスクで読み取る間に使い、読み終えたらunpinSlotで解除します。
+   */
+  void pinSlot(size_t slot);
+
+  /**
+   * スロットの固定を解除します。
+   * ※他タスクから呼び出せます。
+   */
+  void unpinSlot(size_t slot);
+
+  /**
+   * 固定中のスロットがあるかを返します。
+   */
+  bool hasPinnedSlot() const;
+
+ private:
+  /**
+   * 撮影順の位置に対応するスロットの先頭を返します。
+   */
+  uint16_t* getSlotPixels(size_t slot) const;
+
+  uint8_t* arena_;
+  int widths_[SLOT_CAPACITY];
+  int heights_[SLOT_CAPACITY];
+  size_t head_;
+  size_t count_;
+  std::atomic<uint32_t> pinnedSlotMask_;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "text-fit-cache.h"
+
+#include <string.h>
+
+namespace {
+
+constexpr const char* ELLIPSIS = "...";
+constexpr size_t ELLIPSIS_LENGTH = 3;
+constexpr size_t MAX_KEEP_LENGTH = TextFitCache::TEXT_BUFFER_CAPACITY - ELLIPSIS_LENGTH - 1;
+
+}  // namespace
+
+/**
+ * 空のキャッシュを初期化します。
+ */
+TextFitCache::TextFitCache()
+: entries_(),
+  text_() {
+}
+
+/**
+ * 現在のフォントで表示幅に収まる文字列を返します。
+ * ※戻り値は次にfitを呼ぶまで有効です。
+ */
+const char* TextFitCache::fit(TextMetrics& metrics, const char* text, const int maxWidth) {
+  const void* fontKey = metrics.getFontKey();
+  const uintptr_t key = reinterpret_cast<uintptr_t>(text) / 4 + static_cast<uintptr_t>(maxWidth) * 31U;
+  Entry& entry = entries_[key % ENTRY_CAPACITY];
+
+  if (!entry.isValid || entry.fontKey != fontKey || entry.text != text || entry.maxWidth != maxWidth) {
+    bool isEllipsized = false;
+    const uint8_t keepLength = findKeepLength(metrics, text, maxWidth, isEllipsized);
+    entry = Entry{fontKey, text, maxWidth, keepLength, isEllipsized, true};
+  }
+
+  memcpy(text_, text, entry.keepLength);
+  size_t length = entry.keepLength;
+  if (entry.isEllipsized) {
+    memcpy(text_ + length, ELLIPSIS, ELLIPSIS_LENGTH);
+    length += ELLIPSIS_LENGTH;
+  }
+  text_[length] = '\0';
+  return text_;
+}
+
+/**
+ * 保持している計算結果をすべて破棄します。
+ */
+void TextFitCache::clear() {
+  for (size_t index = 0; index < ENTRY_CAPACITY; ++index) {
+    entries_[index].isValid = false;
+  }
+}
+
+/**
+ * 省略記号を付けて収まる先頭部分のバイト数をUTF-8の文字境界上で二分探索します。
+ */
+uint8_t TextFitCache::findKeepLength(
+  TextMetrics& metrics,
+  const char* text,
+  const int maxWidth,
+  bool& isEllipsizedOut
+) {
+  const size_t textLength = strlen(text);
+  if (textLength <= MAX_KEEP_LENGTH && metrics.measureTextWidth(text) <= maxWidth) {
+    isEllipsizedOut = false;
+    return static_cast<uint8_t>(textLength);
+  }
+
+  isEllipsizedOut = true;
+  if (textLength == 0) {
+    return 0;
+  }
+
+  // 継続バイト(10xxxxxx)以外の位置を文字境界として列挙します。
+  uint8_t boundaries[MAX_KEEP_LENGTH + 1];
+  size_t boundaryCount = 0;
+  boundaries[boundaryCount++] = 0;
+  const size_t lastIndex = textLength - 1 < MAX_KEEP_LENGTH ? textLength - 1 : MAX_KEEP_LENGTH;
+  for (size_t index = 1; index <= lastIndex; ++index) {
+    if ((static_cast<uint8_t>(text[index]) & 0xC0) != 0x80) {
+      boundaries[boundaryCount++] = static_cast<uint8_t>(index);
+    }
+  }
+
+  const int ellipsisWidth = metrics.measureTextWidth(ELLIPSIS);
+  size_t low = 0;
+  size_t high = boundaryCount - 1;
+  while (low < high) {
+    const size_t middle = (low + high + 1) / 2;
+    if (measurePrefix(metrics, text, boundaries[middle]) + ellipsisWidth <= maxWidth) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+
+  return boundaries[low];
+}
+
+/**
+ * 文字列の先頭から指定バイト数分の表示幅を返します。
+ */
+int TextFitCache::measurePrefix(TextMetrics& metrics, const char* text, const size_t length) {
+  memcpy(text_, text, length);
+  text_[length] = '\0';
+  return metrics.measureTextWidth(text_);
+}
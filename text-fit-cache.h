@@ -0,0 +1,58 @@
+#ifndef TEXT_FIT_CACHE_H
+#define TEXT_FIT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core-interfaces.h"
+
+/**
+ * 表示幅に収まるよう省略記号を付けた文字列を、フォントと表示幅ごとに再利用します。
+ * ※文字列の同一性はポインタで判定するため、商品名テーブルのように寿命の長い文字列に使います。
+ */
+class TextFitCache {
+ public:
+  static constexpr size_t ENTRY_CAPACITY = 32;
+  static constexpr size_t TEXT_BUFFER_CAPACITY = 96;
+
+  /**
+   * 空のキャッシュを初期化します。
+   */
+  TextFitCache();
+
+  /**
+   * 現在のフォントで表示幅に収まる文字列を返します。
+   * ※戻り値は次にfitを呼ぶまで有効です。
+   */
+  const char* fit(TextMetrics& metrics, const char* text, int maxWidth);
+
+  /**
+   * 保持している計算結果をすべて破棄します。
+   */
+  void clear();
+
+ private:
+  struct Entry {
+    const void* fontKey;
+    const char* text;
+    int maxWidth;
+    uint8_t keepLength;
+    bool isEllipsized;
+    bool isValid;
+  };
+
+  /**
+   * 省略記号を付けて収まる先頭部分のバイト数をUTF-8の文字境界上で二分探索します。
+   */
+  uint8_t findKeepLength(TextMetrics& metrics, const char* text, int maxWidth, bool& isEllipsizedOut);
+
+  /**
+   * 文字列の先頭から指定バイト数分の表示幅を返します。
+   */
+  int measurePrefix(TextMetrics& metrics, const char* text, size_t length);
+
+  Entry entries_[ENTRY_CAPACITY];
+  char text_[TEXT_BUFFER_CAPACITY];
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "text-sprite-atlas.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+constexpr const char* ELLIPSIS = "...";
+constexpr int ATLAS_COLOR_DEPTH = 1;
+constexpr uint32_t BACKGROUND_INDEX = 0;
+constexpr uint32_t FOREGROUND_INDEX = 1;
+
+}  // namespace
+
+/**
+ * 未確保のアトラスを初期化します。
+ */
+TextSpriteAtlas::TextSpriteAtlas()
+: atlas_(),
+  slots_(),
+  text_(),
+  slotCount_(0),
+  ellipsisSlot_(0),
+  slotHeight_(0),
+  isEnabled_(false) {
+}
+
+/**
+ * 指定フォントで文字列群をPSRAM上のスプライトへ描画し、使えるかを返します。
+ * ※texts[i]はスロット番号iで参照します。
+ */
+bool TextSpriteAtlas::begin(const lgfx::IFont* font, const char* const* texts, const size_t textCount) {
+  if (isEnabled_) {
+    return true;
+  }
+
+  if (textCount > SLOT_CAPACITY) {
+    return false;
+  }
+
+  // 幅の計測にもフォント情報が必要なため、先に1x1で確保してから作り直します。
+  atlas_.setColorDepth(ATLAS_COLOR_DEPTH);
+  atlas_.setPsram(true);
+  if (atlas_.createSprite(1, 1) == nullptr) {
+    return false;
+  }
+  atlas_.setFont(font);
+  slotHeight_ = atlas_.fontHeight();
+
+  slotCount_ = textCount;
+  ellipsisSlot_ = textCount;
+  int atlasWidth = 0;
+  for (size_t index = 0; index <= textCount; ++index) {
+    const char* text = index == ellipsisSlot_ ? ELLIPSIS : texts[index];
+    measureSlot(slots_[index], text);
+    atlasWidth = std::max<int>(atlasWidth, slots_[index].width);
+  }
+
+  atlas_.deleteSprite();
+  if (atlas_.createSprite(std::max(atlasWidth, 1), slotHeight_ * static_cast<int>(textCount + 1)) == nullptr) {
+    return false;
+  }
+
+  atlas_.setPaletteColor(BACKGROUND_INDEX, TFT_WHITE);
+  atlas_.setPaletteColor(FOREGROUND_INDEX, TFT_BLACK);
+  atlas_.fillSprite(BACKGROUND_INDEX);
+  atlas_.setFont(font);
+  atlas_.setTextColor(FOREGROUND_INDEX);
+  atlas_.setTextDatum(lgfx::top_left);
+  for (size_t index = 0; index <= textCount; ++index) {
+    const char* text = index == ellipsisSlot_ ? ELLIPSIS : texts[index];
+    atlas_.drawString(text, 0, slotHeight_ * static_cast<int>(index));
+  }
+
+  isEnabled_ = true;
+  return true;
+}
+
+/**
+ * 事前描画済みの文字列を使えるかを返します。
+ */
+bool TextSpriteAtlas::isEnabled() const {
+  return isEnabled_;
+}
+
+/**
+ * スロットの文字列の表示幅を返します。
+ * ※未描画のスロットでは-1を返します。
+ */
+int TextSpriteAtlas::getWidth(const size_t slot) const {
+  if (!isEnabled_ || slot >= slotCount_) {
+    return -1;
+  }
+
+  return slots_[slot].width;
+}
+
+/**
+ * スロットの文字列を描画し、描画できたかを返します。
+ * ※maxWidthを超える場合は文字境界で切り詰めて省略記号を付けます。
+ */
+bool TextSpriteAtlas::draw(LovyanGFX& gfx, const size_t slot, const int x, const int y, const int maxWidth) {
+  if (!isEnabled_ || slot >= slotCount_) {
+    return false;
+  }
+
+  const Slot& entry = slots_[slot];
+  if (entry.width <= maxWidth) {
+    blit(gfx, slot, x, y, entry.width);
+    return true;
+  }
+
+  // 文字境界を測りきれなかった長い文字列は呼び出し側の通常描画に任せます。
+  if (entry.boundaryCount == 0) {
+    return false;
+  }
+
+  const int ellipsisWidth = slots_[ellipsisSlot_].width;
+  int keepWidth = 0;
+  for (size_t index = 0; index < entry.boundaryCount; ++index) {
+    if (entry.boundaryWidths[index] + ellipsisWidth > maxWidth) {
+      break;
+    }
+    keepWidth = entry.boundaryWidths[index];
+  }
+
+  blit(gfx, slot, x, y, keepWidth);
+  blit(gfx, ellipsisSlot_, x + keepWidth, y, ellipsisWidth);
+  return true;
+}
+
+/**
+ * スロットの文字列幅と文字境界ごとの先頭部分の幅を測ります。
+ */
+void TextSpriteAtlas::measureSlot(Slot& slot, const char* text) {
+  slot.width = static_cast<int16_t>(atlas_.textWidth(text));
+  slot.boundaryCount = 0;
+
+  const size_t textLength = strlen(text);
+  if (textLength >= TEXT_BUFFER_CAPACITY) {
+    return;
+  }
+
+  // 継続バイト(10xxxxxx)以外の位置を文字境界とし、そこまでの幅を記録します。
+  size_t boundaryCount = 0;
+  for (size_t index = 1; index < textLength; ++index) {
+    if ((static_cast<uint8_t>(text[index]) & 0xC0) == 0x80) {
+      continue;
+    }
+
+    if (boundaryCount >= BOUNDARY_CAPACITY) {
+      return;
+    }
+
+    memcpy(text_, text, index);
+    text_[index] = '\0';
+    slot.boundaryWidths[boundaryCount++] = static_cast<int16_t>(atlas_.textWidth(text_));
+  }
+
+  // 1文字だけの文字列も省略対象にできるよう、境界0件は先頭幅0として扱います。
+  if (boundaryCount == 0) {
+    slot.boundaryWidths[boundaryCount++] = 0;
+  }
+  slot.boundaryCount = static_cast<uint8_t>(boundaryCount);
+}
+
+/**
+ * アトラスの指定スロットを左から指定幅だけ転送します。
+ */
+void TextSpriteAtlas::blit(LovyanGFX& gfx, const size_t slot, const int x, const int y, const int w) {
+  int32_t clipX = 0;
+  int32_t clipY = 0;
+  int32_t clipW = 0;
+  int32_t clipH = 0;
+  gfx.getClipRect(&clipX, &clipY, &clipW, &clipH);
+
+  const int left = std::max<int>(x, clipX);
+  const int top = std::max<int>(y, clipY);
+  const int right = std::min<int>(x + w, clipX + clipW);
+  const int bottom = std::min<int>(y + slotHeight_, clipY + clipH);
+  if (right <= left || bottom <= top) {
+    return;
+  }
+
+  // 描画先の切り抜き範囲で1スロット分だけを残し、背景色は透過させて重ねます。
+  gfx.setClipRect(left, top, right - left, bottom - top);
+  atlas_.pushSprite(&gfx, x, y - slotHeight_ * static_cast<int>(slot), BACKGROUND_INDEX);
+  gfx.setClipRect(clipX, clipY, clipW, clipH);
+}
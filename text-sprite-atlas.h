@@ -0,0 +1,70 @@
+#ifndef TEXT_SPRITE_ATLAS_H
+#define TEXT_SPRITE_ATLAS_H
+
+#include <M5Unified.h>
+
+/**
+ * 固定の文字列群を1bitスプライトへ事前に描画し、行ごとに切り出して転送します。
+ * ※グリフの展開を起動時に済ませ、再描画時は転送だけで済ませるために使います。
+ */
+class TextSpriteAtlas {
+ public:
+  static constexpr size_t SLOT_CAPACITY = 80;
+  static constexpr size_t BOUNDARY_CAPACITY = 16;
+  static constexpr size_t TEXT_BUFFER_CAPACITY = 64;
+
+  /**
+   * 未確保のアトラスを初期化します。
+   */
+  TextSpriteAtlas();
+
+  /**
+   * 指定フォントで文字列群をPSRAM上のスプライトへ描画し、使えるかを返します。
+   * ※texts[i]はスロット番号iで参照します。
+   */
+  bool begin(const lgfx::IFont* font, const char* const* texts, size_t textCount);
+
+  /**
+   * 事前描画済みの文字列を使えるかを返します。
+   */
+  bool isEnabled() const;
+
+  /**
+   * スロットの文字列の表示幅を返します。
+   * ※未描画のスロットでは-1を返します。
+   */
+  int getWidth(size_t slot) const;
+
+  /**
+   * スロットの文字列を描画し、描画できたかを返します。
+   * ※maxWidthを超える場合は文字境界で切り詰めて省略記号を付けます。
+   */
+  bool draw(LovyanGFX& gfx, size_t slot, int x, int y, int maxWidth);
+
+ private:
+  struct Slot {
+    int16_t width;
+    uint8_t boundaryCount;
+    int16_t boundaryWidths[BOUNDARY_CAPACITY];
+  };
+
+  /**
+   * スロットの文字列幅と文字境界ごとの先頭部分の幅を測ります。
+   */
+  void measureSlot(Slot& slot, const char* text);
+
+  /**
+   * アトラスの指定スロットを左から指定幅だけ転送します。
+   */
+  void blit(LovyanGFX& gfx, size_t slot, int x, int y, int w);
+
+  M5Canvas atlas_;
+  Slot slots_[SLOT_CAPACITY + 1];
+  char text_[TEXT_BUFFER_CAPACITY];
+  size_t slotCount_;
+  size_t ellipsisSlot_;
+  int slotHeight_;
+  bool isEnabled_;
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "tone-clip-bank.h"
+
+#include <M5Unified.h>
+#include <esp_heap_caps.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "register-config.h"
+
+namespace {
+
+// 重なったステップを加算しても振り切れないよう、1音あたりの振幅を抑えます。
+constexpr float VOICE_AMPLITUDE = 0.4f * 32767.0f;
+// 基音に3倍・5倍音を少し重ね、矩形波より角の取れた音色にします。
+constexpr float THIRD_HARMONIC_GAIN = 1.0f / 3.0f;
+constexpr float FIFTH_HARMONIC_GAIN = 1.0f / 5.0f;
+constexpr float HARMONIC_NORMALIZE = 1.0f / (1.0f + THIRD_HARMONIC_GAIN + FIFTH_HARMONIC_GAIN);
+// 立ち上がりと減衰です。鳴っている間は緩やかに弱め、終端は短く絞ってクリックを防ぎます。
+constexpr uint32_t ATTACK_MS = 3;
+constexpr uint32_t RELEASE_MS = 12;
+constexpr float SUSTAIN_END_LEVEL = 0.6f;
+constexpr float TWO_PI = 6.28318530718f;
+
+/**
+ * ミリ秒をサンプル数へ変換します。
+ */
+size_t msToSamples(const uint32_t ms) {
+  return static_cast<size_t>(static_cast<uint64_t>(ms) * ToneClipBank::SAMPLE_RATE / 1000);
+}
+
+}  // namespace
+
+/**
+ * 音を保持していない状態で初期化します。
+ */
+ToneClipBank::ToneClipBank()
+: clips_(),
+  clipCount_(0) {
+}
+
+/**
+ * ステップ列をPCMへ合成して指定番号の音として登録し、登録できたかを返します。
+ * ※波形はPSRAMに置き、確保できない場合は内部RAMに置きます。
+ */
+bool ToneClipBank::add(const size_t clipId, const ToneStep* steps) {
+  if (clipId >= CLIP_CAPACITY || steps == nullptr || steps[0].durationMs == 0) {
+    return false;
+  }
+
+  if (clips_[clipId].samples != nullptr) {
+    return true;
+  }
+
+  const size_t sampleCount = countSamples(steps);
+  const size_t bytes = sampleCount * sizeof(int16_t);
+  int16_t* samples = static_cast<int16_t*>(heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM));
+  if (samples == nullptr) {
+    samples = static_cast<int16_t*>(heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  }
+  if (samples == nullptr) {
+    return false;
+  }
+
+  memset(samples, 0, bytes);
+  uint32_t startMs = 0;
+  for (size_t index = 0; steps[index].durationMs != 0; ++index) {
+    if (steps[index].frequencyHz > 0) {
+      mixStep(samples, sampleCount, msToSamples(startMs), steps[index]);
+    }
+    startMs += steps[index].waitMs;
+  }
+
+  clips_[clipId] = Clip{samples, sampleCount};
+  ++clipCount_;
+  return true;
+}
+
+/**
+ * 指定番号の音を鳴らし、鳴らせたかを返します。
+ * ※音ごとに番号と同じチャンネルを使い、別の音の再生は止めません。
+ */
+bool ToneClipBank::play(const size_t clipId) const {
+  if (clipId >= CLIP_CAPACITY || clips_[clipId].samples == nullptr) {
+    return false;
+  }
+
+  const Clip& clip = clips_[clipId];
+  return M5.Speaker.playRaw(clip.samples, clip.sampleCount, SAMPLE_RATE, false, 1, static_cast<int>(clipId), true);
+}
+
+/**
+ * 登録した音が鳴っているチャンネルをすべて止めます。
+ */
+void ToneClipBank::stopAll() const {
+  for (size_t index = 0; index < CLIP_CAPACITY; ++index) {
+    if (clips_[index].samples != nullptr) {
+      M5.Speaker.stop(static_cast<uint8_t>(index));
+    }
+  }
+}
+
+/**
+ * 登録済みの音の数を返します。
+ */
+size_t ToneClipBank::size() const {
+  return clipCount_;
+}
+
+/**
+ * 登録済みの音が使うバイト数を返します。
+ */
+size_t ToneClipBank::getTotalBytes() const {
+  size_t bytes = 0;
+  for (size_t index = 0; index < CLIP_CAPACITY; ++index) {
+    bytes += clips_[index].sampleCount * sizeof(int16_t);
+  }
+  return bytes;
+}
+
+/**
+ * ステップ列を鳴らし終えるまでのサンプル数を返します。
+ * ※待ち時間より長いステップは次のステップと重ねて鳴らすため、最も遅く鳴り終わる位置までとします。
+ */
+size_t ToneClipBank::countSamples(const ToneStep* steps) {
+  uint32_t startMs = 0;
+  uint32_t endMs = 0;
+  for (size_t index = 0; steps[index].durationMs != 0; ++index) {
+    endMs = std::max<uint32_t>(endMs, startMs + steps[index].durationMs);
+    startMs += steps[index].waitMs;
+  }
+  return msToSamples(endMs);
+}
+
+/**
+ * 1ステップ分の音を、開始位置から合成済みの波形へ加算します。
+ */
+void ToneClipBank::mixStep(
+  int16_t* samples,
+  const size_t sampleCount,
+  const size_t startSample,
+  const ToneStep& step
+) {
+  const size_t length = std::min(msToSamples(step.durationMs), sampleCount - std::min(startSample, sampleCount));
+  const size_t attackSamples = std::max<size_t>(msToSamples(ATTACK_MS), 1);
+  const size_t releaseSamples = std::max<size_t>(msToSamples(RELEASE_MS), 1);
+  const float phaseStep = static_cast<float>(step.frequencyHz) / SAMPLE_RATE;
+  float phase = 0.0f;
+
+  for (size_t index = 0; index < length; ++index) {
+    float envelope = 1.0f - (1.0f - SUSTAIN_END_LEVEL) * index / length;
+    if (index < attackSamples) {
+      envelope *= static_cast<float>(index) / attackSamples;
+    }
+    const size_t remaining = length - index;
+    if (remaining < releaseSamples) {
+      envelope *= static_cast<float>(remaining) / releaseSamples;
+    }
+
+    const float angle = TWO_PI * phase;
+    const float wave = sinf(angle) + THIRD_HARMONIC_GAIN * sinf(3.0f * angle) + FIFTH_HARMONIC_GAIN * sinf(5.0f * angle);
+    const int32_t mixed = samples[startSample + index] +
+      static_cast<int32_t>(wave * HARMONIC_NORMALIZE * envelope * VOICE_AMPLITUDE);
+    samples[startSample + index] = static_cast<int16_t>(std::max<int32_t>(-32768, std::min<int32_t>(32767, mixed)));
+
+    phase += phaseStep;
+    if (phase >= 1.0f) {
+      phase -= 1.0f;
+    }
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef TONE_CLIP_BANK_H
+#define TONE_CLIP_BANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ToneStep;
+
+/**
+ * 音ステップ列を起動時にPCMへ合成して保持し、スピーカーのDMA再生へ渡します。
+ * ※合成した音ごとに専用のチャンネルで鳴らすため、別の音と重ねて鳴らせます。
+ */
+class ToneClipBank {
+ public:
+  static constexpr size_t CLIP_CAPACITY = 8;
+  static constexpr uint32_t SAMPLE_RATE = 24000;
+
+  /**
+   * 音を保持していない状態で初期化します。
+   */
+  ToneClipBank();
+
+  /**
+   * ステップ列をPCMへ合成して指定番号の音として登録し、登録できたかを返します。
+   * ※番号はCLIP_CAPACITY未満とし、登録済みの番号は何もせずtrueを返します。
+   */
+  bool add(size_t clipId, const ToneStep* steps);
+
+  /**
+   * 指定番号の音を鳴らし、鳴らせたかを返します。
+   * ※同じ音が鳴っている場合は先頭から鳴らし直します。再生の完了は待ちません。
+   */
+  bool play(size_t clipId) const;
+
+  /**
+   * 登録した音が鳴っているチャンネルをすべて止めます。
+   */
+  void stopAll() const;
+
+  /**
+   * 登録済みの音の数を返します。
+   */
+  size_t size() const;
+
+  /**
+   * 登録済みの音が使うバイト数を返します。
+   */
+  size_t getTotalBytes() const;
+
+ private:
+  /**
+   * 登録済みの音1件です。
+   */
+  struct Clip {
+    int16_t* samples;
+    size_t sampleCount;
+  };
+
+  /**
+   * ステップ列を鳴らし終えるまでのサンプル数を返します。
+   */
+  static size_t countSamples(const ToneStep* steps);
+
+  /**
+   * 1ステップ分の音を、開始位置から合成済みの波形へ加算します。
+   */
+  static void mixStep(int16_t* samples, size_t sampleCount, size_t startSample, const ToneStep& step);
+
+  Clip clips_[CLIP_CAPACITY];
+  size_t clipCount_;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "tone-player.h"
+
+#include <M5Unified.h>
+
+#include <algorithm>
+
+#include "register-config.h"
+
+/**
+ * 音再生を初期化します。
+ */
+TonePlayer::TonePlayer()
+: queue_(),
+  queueHead_(0),
+  queueCount_(0),
+  steps_(nullptr),
+  stepIndex_(0),
+  stepStartedAtMs_(0),
+  sequenceEndsAfterMs_(0),
+  hasFinished_(false) {
+}
+
+/**
+ * 再生中の音と予約を中断し、ステップ列を即時再生します。
+ */
+void TonePlayer::play(const ToneStep* steps) {
+  cancel();
+  enqueue(steps);
+}
+
+/**
+ * 再生中の音の後にステップ列を予約し、予約できたかを返します。
+ */
+bool TonePlayer::enqueue(const ToneStep* steps) {
+  if (steps == nullptr || steps[0].durationMs == 0) {
+    return false;
+  }
+
+  if (queueCount_ >= QUEUE_CAPACITY) {
+    return false;
+  }
+
+  queue_[(queueHead_ + queueCount_) % QUEUE_CAPACITY] = steps;
+  ++queueCount_;
+
+  if (steps_ == nullptr) {
+    startNextSequence(millis());
+  }
+
+  return true;
+}
+
+/**
+ * 再生中の音と予約をすべて破棄します。
+ */
+void TonePlayer::cancel() {
+  if (steps_ != nullptr) {
+    M5.Speaker.stop();
+  }
+
+  steps_ = nullptr;
+  stepIndex_ = 0;
+  queueHead_ = 0;
+  queueCount_ = 0;
+}
+
+/**
+ * 期限に達したステップを進めます。
+ */
+void TonePlayer::update() {
+  if (steps_ == nullptr) {
+    return;
+  }
+
+  const uint32_t nowMs = millis();
+
+  // 待ち時間0のステップは同じ呼び出し内で続けて鳴らします。
+  while (steps_[stepIndex_].durationMs != 0) {
+    if (nowMs - stepStartedAtMs_ < steps_[stepIndex_].waitMs) {
+      return;
+    }
+
+    sequenceEndsAfterMs_ -= std::min<uint32_t>(sequenceEndsAfterMs_, nowMs - stepStartedAtMs_);
+    ++stepIndex_;
+    if (steps_[stepIndex_].durationMs != 0) {
+      startCurrentStep(nowMs);
+    } else {
+      stepStartedAtMs_ = nowMs;
+    }
+  }
+
+  if (nowMs - stepStartedAtMs_ < sequenceEndsAfterMs_) {
+    return;
+  }
+
+  steps_ = nullptr;
+  hasFinished_ = true;
+  startNextSequence(nowMs);
+}
+
+/**
+ * 次のステップへ進む期限までの待ち時間を返します。
+ * ※updateと同じく、終端に達した後は鳴り終わるまでを期限とします。
+ */
+uint32_t TonePlayer::getWaitMs(const uint32_t nowMs, const uint32_t maxWaitMs) const {
+  if (steps_ == nullptr) {
+    return maxWaitMs;
+  }
+
+  const ToneStep& step = steps_[stepIndex_];
+  const uint32_t deadlineMs = step.durationMs != 0 ? step.waitMs : sequenceEndsAfterMs_;
+  const uint32_t elapsedMs = nowMs - stepStartedAtMs_;
+  if (elapsedMs >= deadlineMs) {
+    return 0;
+  }
+
+  return std::min(deadlineMs - elapsedMs, maxWaitMs);
+}
+
+/**
+ * ステップ列を再生中かを返します。
+ */
+bool TonePlayer::isPlaying() const {
+  return steps_ != nullptr;
+}
+
+/**
+ * 前回呼び出し以降にステップ列の再生が完了したかを返します。
+ */
+bool TonePlayer::consumeFinished() {
+  const bool hasFinished = hasFinished_;
+  hasFinished_ = false;
+  return hasFinished;
+}
+
+/**
+ * 予約列の先頭から次のステップ列を開始します。
+ */
+void TonePlayer::startNextSequence(const uint32_t nowMs) {
+  if (queueCount_ == 0) {
+    return;
+  }
+
+  steps_ = queue_[queueHead_];
+  queueHead_ = (queueHead_ + 1) % QUEUE_CAPACITY;
+  --queueCount_;
+  stepIndex_ = 0;
+  sequenceEndsAfterMs_ = 0;
+  startCurrentStep(nowMs);
+}
+
+/**
+ * 現在のステップを鳴らします。
+ */
+void TonePlayer::startCurrentStep(const uint32_t nowMs) {
+  const ToneStep& step = steps_[stepIndex_];
+
+  if (step.frequencyHz > 0) {
+    M5.Speaker.tone(step.frequencyHz, step.durationMs);
+  }
+
+  stepStartedAtMs_ = nowMs;
+  sequenceEndsAfterMs_ = std::max<uint32_t>(sequenceEndsAfterMs_, step.durationMs);
+}
@@ -0,0 +1,78 @@
+#ifndef TONE_PLAYER_H
+#define TONE_PLAYER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ToneStep;
+
+/**
+ * 音ステップ列をmillis()の期限で非同期に再生します。
+ */
+class TonePlayer {
+ public:
+  /**
+   * 音再生を初期化します。
+   */
+  TonePlayer();
+
+  /**
+   * 再生中の音と予約を中断し、ステップ列を即時再生します。
+   */
+  void play(const ToneStep* steps);
+
+  /**
+   * 再生中の音の後にステップ列を予約し、予約できたかを返します。
+   */
+  bool enqueue(const ToneStep* steps);
+
+  /**
+   * 再生中の音と予約をすべて破棄します。
+   */
+  void cancel();
+
+  /**
+   * 期限に達したステップを進めます。
+   */
+  void update();
+
+  /**
+   * 次のステップへ進む期限までの待ち時間を返します。
+   * ※再生中でない場合や期限が遠い場合はmaxWaitMsを返します。
+   */
+  uint32_t getWaitMs(uint32_t nowMs, uint32_t maxWaitMs) const;
+
+  /**
+   * ステップ列を再生中かを返します。
+   */
+  bool isPlaying() const;
+
+  /**
+   * 前回呼び出し以降にステップ列の再生が完了したかを返します。
+   */
+  bool consumeFinished();
+
+ private:
+  /**
+   * 予約列の先頭から次のステップ列を開始します。
+   */
+  void startNextSequence(uint32_t nowMs);
+
+  /**
+   * 現在のステップを鳴らします。
+   */
+  void startCurrentStep(uint32_t nowMs);
+
+  static constexpr size_t QUEUE_CAPACITY = 4;
+
+  const ToneStep* queue_[QUEUE_CAPACITY];
+  size_t queueHead_;
+  size_t queueCount_;
+  const ToneStep* steps_;
+  size_t stepIndex_;
+  uint32_t stepStartedAtMs_;
+  uint32_t sequenceEndsAfterMs_;
+  bool hasFinished_;
+};
+
+#endif
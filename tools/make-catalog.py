@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""登録カタログのCSVから、catalog パーティションへ書き込むイメージを作ります。
+
+CSVは1行に `コード,商品名,価格` を並べます（UTF-8、先頭行が `code` で始まる場合は見出しとして読み飛ばします）。
+形式は catalog-index.h / catalog-index.cpp と揃えます。
+
+    python3 tools/make-catalog.py catalog.csv catalog.bin
+    python3 -m esptool --chip esp32s3 write_flash 0xe00000 catalog.bin
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+MAGIC = 0x5443524B
+VERSION = 1
+HEADER_FORMAT = "<IHHIIIIII"
+HEADER_BYTES = 32
+SLOT_FORMAT = "<II"
+SLOT_BYTES = 8
+EMPTY_SLOT_OFFSET = 0xFFFFFFFF
+RECORD_HEADER_FORMAT = "<HBB"
+MAX_FIELD_BYTES = 255
+MAX_PRICE = 0xFFFF
+# 索引の使用率をこの値以下に抑え、探査回数を短く保ちます。
+MAX_LOAD_FACTOR = 0.5
+# partitions.csv の catalog パーティションの大きさです。
+DEFAULT_PARTITION_BYTES = 0x1F0000
+
+
+def fnv1a32(data):
+    value = 2166136261
+    for byte in data:
+        value ^= byte
+        value = (value * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def read_entries(path):
+    entries = {}
+    with open(path, newline="", encoding="utf-8-sig") as source:
+        for line_number, row in enumerate(csv.reader(source), start=1):
+            if not row or row[0].strip().startswith("#"):
+                continue
+            if line_number == 1 and row[0].strip().lower() == "code":
+                continue
+            if len(row) < 3:
+                raise ValueError(f"{path}:{line_number}: expected code,name,price")
+
+            code = row[0].strip().encode("ascii")
+            name = row[1].strip().encode("utf-8")
+            price = int(row[2])
+            if not 0 < len(code) <= MAX_FIELD_BYTES or len(name) > MAX_FIELD_BYTES:
+                raise ValueError(f"{path}:{line_number}: code or name too long")
+            if not 0 < price <= MAX_PRICE:
+                raise ValueError(f"{path}:{line_number}: price must be 1..{MAX_PRICE}")
+            if code in entries:
+                print(f"{path}:{line_number}: duplicate code {code.decode()} overrides", file=sys.stderr)
+            entries[code] = (name, price)
+    return entries
+
+
+def build_image(entries):
+    slot_count = 1
+    while slot_count * MAX_LOAD_FACTOR < max(len(entries), 1):
+        slot_count *= 2
+
+    records = bytearray()
+    slots = [(0, EMPTY_SLOT_OFFSET)] * slot_count
+    max_probe_count = 1
+    for code, (name, price) in entries.items():
+        code_hash = fnv1a32(code)
+        probe = 0
+        while slots[(code_hash + probe) & (slot_count - 1)][1] != EMPTY_SLOT_OFFSET:
+            probe += 1
+        slots[(code_hash + probe) & (slot_count - 1)] = (code_hash, len(records))
+        max_probe_count = max(max_probe_count, probe + 1)
+        records += struct.pack(RECORD_HEADER_FORMAT, price, len(code), len(name)) + code + name + b"\0"
+
+    slots_offset = HEADER_BYTES
+    records_offset = slots_offset + slot_count * SLOT_BYTES
+    image_bytes = records_offset + len(records)
+    header = struct.pack(
+        HEADER_FORMAT,
+        MAGIC,
+        VERSION,
+        HEADER_BYTES,
+        len(entries),
+        slot_count,
+        slots_offset,
+        records_offset,
+        image_bytes,
+        max_probe_count,
+    )
+    body = b"".join(struct.pack(SLOT_FORMAT, code_hash, offset) for code_hash, offset in slots)
+    return header + body + bytes(records), slot_count, max_probe_count
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build the flash catalog image.")
+    parser.add_argument("source", help="CSV file of code,name,price")
+    parser.add_argument("output", help="catalog image to write")
+    parser.add_argument("--partition-bytes", type=lambda text: int(text, 0), default=DEFAULT_PARTITION_BYTES)
+    args = parser.parse_args()
+
+    entries = read_entries(args.source)
+    image, slot_count, max_probe_count = build_image(entries)
+    if len(image) > args.partition_bytes:
+        sys.exit(f"image {len(image)} bytes exceeds partition {args.partition_bytes} bytes")
+
+    with open(args.output, "wb") as output:
+        output.write(image)
+    print(f"entries={len(entries)} slots={slot_count} max_probe={max_probe_count} bytes={len(image)}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,107 @@
+#include "touch-gesture.h"
+
+#include <stdlib.h>
+
+/**
+ * 指定した条件で初期化します。
+ */
+TouchGestureRecognizer::TouchGestureRecognizer(const Config& config)
+: config_(config),
+  pressX_(0),
+  pressY_(0),
+  lastX_(0),
+  lastY_(0),
+  pressedAtMs_(0),
+  isPressed_(false),
+  hasMoved_(false),
+  isConsumed_(false) {
+}
+
+/**
+ * 読み取り1回分の状態を渡し、操作を認識したかを返します。
+ * ※長押しは押したまま条件を満たした時点で認識し、その後に離しても何も認識しません。
+ */
+bool TouchGestureRecognizer::update(
+  const bool isTouching,
+  const int32_t x,
+  const int32_t y,
+  const uint32_t nowMs,
+  TouchEvent& eventOut
+) {
+  if (!isPressed_) {
+    if (isTouching) {
+      isPressed_ = true;
+      hasMoved_ = false;
+      isConsumed_ = false;
+      pressX_ = x;
+      pressY_ = y;
+      lastX_ = x;
+      lastY_ = y;
+      pressedAtMs_ = nowMs;
+    }
+    return false;
+  }
+
+  if (isTouching) {
+    lastX_ = x;
+    lastY_ = y;
+
+    // 一度でも大きく動いた押下は、指が戻っても長押しにしません。
+    hasMoved_ = hasMoved_ || hasMovedBeyondSlop(x, y);
+    if (isConsumed_ || hasMoved_ || nowMs - pressedAtMs_ < config_.longPressMs) {
+      return false;
+    }
+
+    isConsumed_ = true;
+    buildEvent(TouchGesture::LONG_PRESS, nowMs, eventOut);
+    return true;
+  }
+
+  // 離したときの座標は読み取れないため、スワイプは最後に読み取った座標で判定します。
+  isPressed_ = false;
+  if (isConsumed_) {
+    return false;
+  }
+
+  if (!hasMoved_) {
+    buildEvent(TouchGesture::TAP, nowMs, eventOut);
+    return true;
+  }
+
+  // スワイプに届かない移動は、指がずれたタップとして押し始めの位置で扱います。
+  const int32_t dx = lastX_ - pressX_;
+  const int32_t dy = lastY_ - pressY_;
+  if (abs(dx) < config_.swipeMinPixels && abs(dy) < config_.swipeMinPixels) {
+    buildEvent(TouchGesture::TAP, nowMs, eventOut);
+    return true;
+  }
+
+  buildEvent(TouchGesture::SWIPE, nowMs, eventOut);
+  if (abs(dx) >= abs(dy)) {
+    eventOut.direction = dx < 0 ? SwipeDirection::LEFT : SwipeDirection::RIGHT;
+  } else {
+    eventOut.direction = dy < 0 ? SwipeDirection::UP : SwipeDirection::DOWN;
+  }
+  return true;
+}
+
+/**
+ * 押し始めからの移動量が、タップとみなせる範囲を超えたかを返します。
+ */
+bool TouchGestureRecognizer::hasMovedBeyondSlop(const int32_t x, const int32_t y) const {
+  return abs(x - pressX_) > config_.tapSlopPixels || abs(y - pressY_) > config_.tapSlopPixels;
+}
+
+/**
+ * 認識した操作を組み立てます。
+ */
+void TouchGestureRecognizer::buildEvent(const TouchGesture gesture, const uint32_t nowMs, TouchEvent& eventOut) const {
+  eventOut.gesture = gesture;
+  eventOut.direction = SwipeDirection::NONE;
+  eventOut.x = pressX_;
+  eventOut.y = pressY_;
+  eventOut.endX = lastX_;
+  eventOut.endY = lastY_;
+  eventOut.pressedAtMs = pressedAtMs_;
+  eventOut.timestampMs = nowMs;
+}
@@ -0,0 +1,97 @@
+#ifndef TOUCH_GESTURE_H
+#define TOUCH_GESTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spsc-queue.h"
+
+/**
+ * 認識したタッチ操作の種類を表します。
+ */
+enum class TouchGesture : uint8_t {
+  TAP,
+  LONG_PRESS,
+  SWIPE,
+};
+
+/**
+ * スワイプで指が動いた向きを表します。
+ */
+enum class SwipeDirection : uint8_t {
+  NONE,
+  LEFT,
+  RIGHT,
+  UP,
+  DOWN,
+};
+
+/**
+ * タッチ処理タスクから画面処理タスクへ渡すタッチ操作です。
+ * ※座標は押し始めの位置です。スワイプでは離した位置も持ちます。
+ */
+struct TouchEvent {
+  TouchGesture gesture;
+  SwipeDirection direction;
+  int32_t x;
+  int32_t y;
+  int32_t endX;
+  int32_t endY;
+  uint32_t pressedAtMs;
+  uint32_t timestampMs;
+};
+
+/**
+ * タッチ操作を受け渡すキューです。
+ */
+using TouchEventQueue = SpscQueue<TouchEvent, 32>;
+
+/**
+ * 一定間隔で読み取ったタッチの有無と座標から、タップ・長押し・スワイプを認識します。
+ * ※タップは離した時点で認識します。スワイプの距離に届かない移動もタップとして扱います。
+ */
+class TouchGestureRecognizer {
+ public:
+  /**
+   * 認識の判定条件です。
+   */
+  struct Config {
+    uint32_t longPressMs;
+    int32_t tapSlopPixels;
+    int32_t swipeMinPixels;
+  };
+
+  /**
+   * 指定した条件で初期化します。
+   */
+  explicit TouchGestureRecognizer(const Config& config);
+
+  /**
+   * 読み取り1回分の状態を渡し、操作を認識したかを返します。
+   * ※1回の読み取りで認識する操作は最大1件です。
+   */
+  bool update(bool isTouching, int32_t x, int32_t y, uint32_t nowMs, TouchEvent& eventOut);
+
+ private:
+  /**
+   * 押し始めからの移動量が、タップとみなせる範囲を超えたかを返します。
+   */
+  bool hasMovedBeyondSlop(int32_t x, int32_t y) const;
+
+  /**
+   * 認識した操作を組み立てます。
+   */
+  void buildEvent(TouchGesture gesture, uint32_t nowMs, TouchEvent& eventOut) const;
+
+  Config config_;
+  int32_t pressX_;
+  int32_t pressY_;
+  int32_t lastX_;
+  int32_t lastY_;
+  uint32_t pressedAtMs_;
+  bool isPressed_;
+  bool hasMoved_;
+  bool isConsumed_;
+};
+
+#endif
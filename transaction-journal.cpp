@@ -0,0 +1,564 @@
+#include "transaction-journal.h"
+
+#include <esp_heap_caps.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "logger.h"
+
+namespace {
+
+constexpr uint32_t WRITE_TASK_STACK_SIZE = 4096;
+// 保存タスクと同じく入力処理タスクより低くし、空き時間だけで書き込みます。
+constexpr UBaseType_t WRITE_TASK_PRIORITY = 1;
+constexpr BaseType_t WRITE_TASK_CORE = 0;
+constexpr size_t SECTOR_BYTES = 4096;
+constexpr size_t SECTORS_PER_SEGMENT = 4;
+constexpr size_t SEGMENT_BYTES = SECTOR_BYTES * SECTORS_PER_SEGMENT;
+constexpr size_t SEGMENT_HEADER_BYTES = 16;
+// セグメント先頭の識別子 "KRJS" です。
+constexpr uint32_t SEGMENT_MAGIC = 0x534A524BUL;
+constexpr size_t PENDING_BUFFER_BYTES = 4096;
+// セクタが埋まらなくても、この時間が経てば途中まで書き込みます。決済完了画面の表示中は書き込みません。
+constexpr uint32_t FLUSH_DELAY_MS = 5000;
+constexpr uint32_t DUMP_FLUSH_TIMEOUT_MS = 2000;
+constexpr size_t DUMP_LINE_CAPACITY = 128;
+constexpr size_t DUMP_ITEM_TEXT_CAPACITY = 16;
+static_assert(CHECKOUT_RECORD_MAX_BYTES <= SECTOR_BYTES - SEGMENT_HEADER_BYTES, "A record must fit in one sector");
+static_assert(CHECKOUT_RECORD_MAX_BYTES <= PENDING_BUFFER_BYTES, "A record must fit in the pending buffer");
+
+/**
+ * 出力中の状態です。
+ */
+struct DumpContext {
+  Print* output;
+  size_t recordCount;
+};
+
+/**
+ * リトルエンディアンの32bit値を読み書きします。
+ */
+uint32_t loadU32(const uint8_t* bytes) {
+  return static_cast<uint32_t>(bytes[0]) |
+    (static_cast<uint32_t>(bytes[1]) << 8) |
+    (static_cast<uint32_t>(bytes[2]) << 16) |
+    (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+void storeU32(uint8_t* bytes, const uint32_t value) {
+  bytes[0] = static_cast<uint8_t>(value);
+  bytes[1] = static_cast<uint8_t>(value >> 8);
+  bytes[2] = static_cast<uint8_t>(value >> 16);
+  bytes[3] = static_cast<uint8_t>(value >> 24);
+}
+
+/**
+ * 書き込み用のバッファを内部RAMに確保します。
+ */
+uint8_t* allocateBuffer(const size_t length) {
+  return static_cast<uint8_t*>(heap_caps_malloc(length, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+}
+
+}  // namespace
+
+/**
+ * 記録処理を初期化します。
+ */
+TransactionJournal::TransactionJournal()
+: partition_(nullptr),
+  taskHandle_(nullptr),
+  pendingMutex_(nullptr),
+  flashMutex_(nullptr),
+  pendingBuffer_(nullptr),
+  drainBuffer_(nullptr),
+  stagingBuffer_(nullptr),
+  pendingBytes_(0),
+  stagedBytes_(0),
+  segmentCount_(0),
+  segmentIndex_(0),
+  sectorIndex_(0),
+  sectorOffset_(SEGMENT_HEADER_BYTES),
+  nextSequence_(1),
+  stagedSinceMs_(0),
+  unwrittenBytes_(0),
+  droppedRecordCount_(0),
+  isFlushRequested_(false),
+  hasSegment_(false),
+  isSectorWritable_(false) {
+}
+
+/**
+ * 指定ラベルのパーティションから追記位置を復元し、書き込みタスクを起動して使えるかを返します。
+ */
+bool TransactionJournal::begin(const char* label) {
+  if (taskHandle_ != nullptr) {
+    return true;
+  }
+
+  partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if (partition_ == nullptr) {
+    LOG_INFO(JOURNAL, "partition=%s missing", label);
+    return false;
+  }
+
+  segmentCount_ = partition_->size / SEGMENT_BYTES;
+  if (segmentCount_ < 2) {
+    LOG_WARN(JOURNAL, "partition=%s too small", label);
+    return false;
+  }
+
+  if (pendingMutex_ == nullptr) {
+    pendingMutex_ = xSemaphoreCreateMutex();
+  }
+  if (flashMutex_ == nullptr) {
+    flashMutex_ = xSemaphoreCreateMutex();
+  }
+  if (pendingBuffer_ == nullptr) {
+    pendingBuffer_ = allocateBuffer(PENDING_BUFFER_BYTES);
+  }
+  if (drainBuffer_ == nullptr) {
+    drainBuffer_ = allocateBuffer(SECTOR_BYTES);
+  }
+  if (stagingBuffer_ == nullptr) {
+    stagingBuffer_ = allocateBuffer(SECTOR_BYTES);
+  }
+  if (
+    pendingMutex_ == nullptr ||
+    flashMutex_ == nullptr ||
+    pendingBuffer_ == nullptr ||
+    drainBuffer_ == nullptr ||
+    stagingBuffer_ == nullptr
+  ) {
+    LOG_WARN(JOURNAL, "alloc failed");
+    return false;
+  }
+
+  recoverPosition();
+
+  const BaseType_t result = xTaskCreatePinnedToCore(
+    runTask,
+    "journal",
+    WRITE_TASK_STACK_SIZE,
+    this,
+    WRITE_TASK_PRIORITY,
+    &taskHandle_,
+    WRITE_TASK_CORE
+  );
+  if (result != pdPASS) {
+    taskHandle_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 決済1件をカートの明細ごと書き込み待ちへ積み、受け付けたかを返します。
+ * ※記録はその場で書き込み待ちのバッファへ直接組み立て、排他区間をコピー1回分に留めます。
+ */
+bool TransactionJournal::append(
+  const RegisterCart& cart,
+  const char* uid,
+  const size_t uidLength,
+  const uint32_t unixTime
+) {
+  if (taskHandle_ == nullptr) {
+    return false;
+  }
+
+  xSemaphoreTake(pendingMutex_, portMAX_DELAY);
+  const CheckoutSummary summary = {nextSequence_, unixTime, millis(), uid, uidLength};
+  const size_t recordBytes = encodeCheckoutRecord(
+    summary,
+    cart,
+    pendingBuffer_ + pendingBytes_,
+    PENDING_BUFFER_BYTES - pendingBytes_
+  );
+  if (recordBytes != 0) {
+    pendingBytes_ += recordBytes;
+    ++nextSequence_;
+    unwrittenBytes_.fetch_add(recordBytes, std::memory_order_acq_rel);
+  }
+  xSemaphoreGive(pendingMutex_);
+
+  if (recordBytes == 0) {
+    droppedRecordCount_.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARN(JOURNAL, "pending full, dropped seq=%lu", static_cast<unsigned long>(summary.sequence));
+    return false;
+  }
+
+  xTaskNotifyGive(taskHandle_);
+  return true;
+}
+
+/**
+ * 書き込み待ちの記録をすぐに書き込むよう依頼し、書き終えたかを返します。
+ */
+bool TransactionJournal::flush(const uint32_t timeoutMs) {
+  if (taskHandle_ == nullptr) {
+    return false;
+  }
+
+  const uint32_t startedAtMs = millis();
+  while (unwrittenBytes_.load(std::memory_order_acquire) != 0) {
+    if (millis() - startedAtMs >= timeoutMs) {
+      return false;
+    }
+
+    isFlushRequested_.store(true, std::memory_order_release);
+    xTaskNotifyGive(taskHandle_);
+    vTaskDelay(1);
+  }
+  return true;
+}
+
+/**
+ * 記録を古い順にCSV形式で出力します。
+ * ※セグメントは追記した順に巡回しているため、現在のセグメントの次から1周読めば古い順になります。
+ */
+void TransactionJournal::dump(Print& output) {
+  if (taskHandle_ == nullptr) {
+    output.println("[JOURNAL] off");
+    return;
+  }
+
+  if (!flush(DUMP_FLUSH_TIMEOUT_MS)) {
+    LOG_WARN(JOURNAL, "flush timeout before dump");
+  }
+
+  const uint32_t startedAtMs = millis();
+  DumpContext context = {&output, 0};
+  output.println("[JOURNAL] seq,unix,uptime_ms,uid,total,items");
+
+  xSemaphoreTake(flashMutex_, portMAX_DELAY);
+  for (size_t step = 1; step <= segmentCount_; ++step) {
+    const size_t segment = (segmentIndex_ + step) % segmentCount_;
+    uint32_t firstSequence = 0;
+    if (!readSegmentHeader(segment, firstSequence)) {
+      continue;
+    }
+
+    ScanResult result;
+    scanSegment(segment, firstSequence, printRecord, &context, result);
+  }
+  xSemaphoreGive(flashMutex_);
+
+  output.printf(
+    "[JOURNAL] records=%u dropped=%lu elapsed=%lums\n",
+    static_cast<unsigned>(context.recordCount),
+    static_cast<unsigned long>(droppedRecordCount_.load(std::memory_order_relaxed)),
+    static_cast<unsigned long>(millis() - startedAtMs)
+  );
+}
+
+/**
+ * 書き込みタスクの本体です。
+ */
+void TransactionJournal::runTask(void* context) {
+  static_cast<TransactionJournal*>(context)->runWriteLoop();
+}
+
+/**
+ * 書き込みタスクで書き込み待ちの記録を書き込み続けます。
+ * ※セクタが埋まった時点で1セクタ分をまとめて書き込み、埋まらない分は一定時間後か依頼時に書き込みます。
+ */
+void TransactionJournal::runWriteLoop() {
+  while (true) {
+    TickType_t waitTicks = portMAX_DELAY;
+    if (stagedBytes_ != 0) {
+      const uint32_t elapsedMs = millis() - stagedSinceMs_;
+      waitTicks = elapsedMs >= FLUSH_DELAY_MS ? 0 : pdMS_TO_TICKS(FLUSH_DELAY_MS - elapsedMs);
+    }
+    ulTaskNotifyTake(pdTRUE, waitTicks);
+
+    xSemaphoreTake(flashMutex_, portMAX_DELAY);
+    drainPending();
+    const bool isFlushRequested = isFlushRequested_.exchange(false, std::memory_order_acq_rel);
+    if (stagedBytes_ != 0 && (isFlushRequested || millis() - stagedSinceMs_ >= FLUSH_DELAY_MS)) {
+      writeStaged();
+    }
+    xSemaphoreGive(flashMutex_);
+  }
+}
+
+/**
+ * セグメントの先頭を読み、使用中であれば最初の記録の通し番号を返します。
+ */
+bool TransactionJournal::readSegmentHeader(const size_t segment, uint32_t& firstSequenceOut) {
+  uint8_t header[SEGMENT_HEADER_BYTES];
+  if (esp_partition_read(partition_, getSectorAddress(segment, 0), header, sizeof(header)) != ESP_OK) {
+    return false;
+  }
+
+  const uint32_t firstSequence = loadU32(header + 4);
+  if (loadU32(header) != SEGMENT_MAGIC || loadU32(header + 8) != ~firstSequence) {
+    return false;
+  }
+
+  firstSequenceOut = firstSequence;
+  return true;
+}
+
+/**
+ * セグメント内の記録を古い順に読み、最後の記録の位置を返します。
+ * ※記録が壊れていた場合はそのセクタの残りを読み飛ばし、次のセクタから読み続けます。
+ */
+void TransactionJournal::scanSegment(
+  const size_t segment,
+  const uint32_t firstSequence,
+  RecordVisitor visitor,
+  void* context,
+  ScanResult& resultOut
+) {
+  resultOut = ScanResult{firstSequence - 1, 0, 0, SEGMENT_HEADER_BYTES, false};
+
+  for (size_t sector = 0; sector < SECTORS_PER_SEGMENT; ++sector) {
+    if (esp_partition_read(partition_, getSectorAddress(segment, sector), drainBuffer_, SECTOR_BYTES) != ESP_OK) {
+      return;
+    }
+
+    size_t offset = sector == 0 ? SEGMENT_HEADER_BYTES : 0;
+    while (offset < SECTOR_BYTES) {
+      const bool isEndPosition = sector == resultOut.endSector && offset == resultOut.endOffset;
+      const uint8_t* bytes = drainBuffer_ + offset;
+      const size_t available = SECTOR_BYTES - offset;
+      if (isErasedCheckoutRecord(bytes, available)) {
+        resultOut.isEndErased = resultOut.isEndErased || isEndPosition;
+        break;
+      }
+
+      CheckoutRecordView record;
+      if (!decodeCheckoutRecord(bytes, available, record)) {
+        break;
+      }
+
+      if (record.sequence <= resultOut.lastSequence) {
+        return;
+      }
+
+      offset += record.recordBytes;
+      resultOut.lastSequence = record.sequence;
+      ++resultOut.recordCount;
+      resultOut.endSector = sector;
+      resultOut.endOffset = offset;
+      resultOut.isEndErased = false;
+      if (visitor != nullptr) {
+        visitor(context, record);
+      }
+    }
+  }
+}
+
+/**
+ * 最後に書き込んだセグメントを探し、追記位置と次の通し番号を復元します。
+ */
+void TransactionJournal::recoverPosition() {
+  bool hasFound = false;
+  size_t latestSegment = 0;
+  uint32_t latestFirstSequence = 0;
+  for (size_t segment = 0; segment < segmentCount_; ++segment) {
+    uint32_t firstSequence = 0;
+    if (readSegmentHeader(segment, firstSequence) && (!hasFound || firstSequence > latestFirstSequence)) {
+      hasFound = true;
+      latestSegment = segment;
+      latestFirstSequence = firstSequence;
+    }
+  }
+
+  if (!hasFound) {
+    segmentIndex_ = 0;
+    hasSegment_ = false;
+    nextSequence_ = 1;
+    LOG_INFO(JOURNAL, "empty segments=%u", static_cast<unsigned>(segmentCount_));
+    return;
+  }
+
+  ScanResult result;
+  scanSegment(latestSegment, latestFirstSequence, nullptr, nullptr, result);
+  segmentIndex_ = latestSegment;
+  sectorIndex_ = result.endSector;
+  sectorOffset_ = result.endOffset;
+  isSectorWritable_ = result.isEndErased;
+  hasSegment_ = true;
+  nextSequence_ = result.lastSequence + 1;
+  LOG_INFO(
+    JOURNAL,
+    "resume segment=%u/%u sector=%u offset=%u next_seq=%lu",
+    static_cast<unsigned>(segmentIndex_),
+    static_cast<unsigned>(segmentCount_),
+    static_cast<unsigned>(sectorIndex_),
+    static_cast<unsigned>(sectorOffset_),
+    static_cast<unsigned long>(nextSequence_)
+  );
+}
+
+/**
+ * 書き込み待ちの記録を取り出し、セクタ単位の書き込み用バッファへ並べます。
+ */
+void TransactionJournal::drainPending() {
+  xSemaphoreTake(pendingMutex_, portMAX_DELAY);
+  const size_t drainedBytes = pendingBytes_;
+  memcpy(drainBuffer_, pendingBuffer_, drainedBytes);
+  pendingBytes_ = 0;
+  xSemaphoreGive(pendingMutex_);
+
+  size_t offset = 0;
+  while (offset < drainedBytes) {
+    CheckoutRecordView record;
+    if (!decodeCheckoutRecord(drainBuffer_ + offset, drainedBytes - offset, record)) {
+      LOG_ERROR(JOURNAL, "pending record corrupt");
+      unwrittenBytes_.fetch_sub(drainedBytes - offset, std::memory_order_acq_rel);
+      return;
+    }
+
+    placeRecord(drainBuffer_ + offset, record.recordBytes, record.sequence);
+    offset += record.recordBytes;
+  }
+}
+
+/**
+ * 記録1件を書き込み用バッファへ置きます。
+ */
+void TransactionJournal::placeRecord(const uint8_t* record, const size_t recordBytes, const uint32_t sequence) {
+  if (!hasSegment_) {
+    startSegment(segmentIndex_, sequence);
+  } else if (!isSectorWritable_ || sectorOffset_ + stagedBytes_ + recordBytes > SECTOR_BYTES) {
+    writeStaged();
+    advanceSector(sequence);
+  }
+
+  if (stagedBytes_ == 0) {
+    stagedSinceMs_ = millis();
+  }
+  memcpy(stagingBuffer_ + stagedBytes_, record, recordBytes);
+  stagedBytes_ += recordBytes;
+
+  // 残りに記録が入らないセクタは待たずに書き込みます。
+  if (SECTOR_BYTES - sectorOffset_ - stagedBytes_ < CHECKOUT_RECORD_HEADER_BYTES) {
+    writeStaged();
+  }
+}
+
+/**
+ * 書き込み用バッファの内容を現在のセクタへ書き込みます。
+ * ※書き込み先は消去後に未使用のままの範囲だけで、同じ位置へ2度書き込みません。
+ */
+void TransactionJournal::writeStaged() {
+  if (stagedBytes_ == 0) {
+    return;
+  }
+
+  const size_t address = getSectorAddress(segmentIndex_, sectorIndex_) + sectorOffset_;
+  const esp_err_t result = isSectorWritable_
+    ? esp_partition_write(partition_, address, stagingBuffer_, stagedBytes_)
+    : ESP_ERR_INVALID_STATE;
+  if (result != ESP_OK) {
+    LOG_ERROR(JOURNAL, "write failed address=0x%x err=%d", static_cast<unsigned>(address), static_cast<int>(result));
+    isSectorWritable_ = false;
+  } else {
+    LOG_DEBUG(
+      JOURNAL,
+      "write segment=%u sector=%u offset=%u bytes=%u",
+      static_cast<unsigned>(segmentIndex_),
+      static_cast<unsigned>(sectorIndex_),
+      static_cast<unsigned>(sectorOffset_),
+      static_cast<unsigned>(stagedBytes_)
+    );
+  }
+
+  sectorOffset_ += stagedBytes_;
+  unwrittenBytes_.fetch_sub(stagedBytes_, std::memory_order_acq_rel);
+  stagedBytes_ = 0;
+}
+
+/**
+ * 次のセクタを消去して追記位置を移します。
+ */
+void TransactionJournal::advanceSector(const uint32_t nextSequence) {
+  if (sectorIndex_ + 1 >= SECTORS_PER_SEGMENT) {
+    startSegment((segmentIndex_ + 1) % segmentCount_, nextSequence);
+    return;
+  }
+
+  ++sectorIndex_;
+  sectorOffset_ = 0;
+  isSectorWritable_ =
+    esp_partition_erase_range(partition_, getSectorAddress(segmentIndex_, sectorIndex_), SECTOR_BYTES) == ESP_OK;
+}
+
+/**
+ * 指定セグメントの先頭セクタを消去し、先頭に最初の記録の通し番号を書き込みます。
+ * ※残りのセクタは使い始める直前に1つずつ消去し、消去で止まる時間を分散します。
+ */
+void TransactionJournal::startSegment(const size_t segment, const uint32_t firstSequence) {
+  segmentIndex_ = segment;
+  sectorIndex_ = 0;
+  sectorOffset_ = SEGMENT_HEADER_BYTES;
+  hasSegment_ = true;
+
+  uint8_t header[SEGMENT_HEADER_BYTES];
+  memset(header, 0xFF, sizeof(header));
+  storeU32(header, SEGMENT_MAGIC);
+  storeU32(header + 4, firstSequence);
+  storeU32(header + 8, ~firstSequence);
+
+  const size_t address = getSectorAddress(segment, 0);
+  isSectorWritable_ =
+    esp_partition_erase_range(partition_, address, SECTOR_BYTES) == ESP_OK &&
+    esp_partition_write(partition_, address, header, sizeof(header)) == ESP_OK;
+  LOG_INFO(
+    JOURNAL,
+    "segment=%u first_seq=%lu ready=%d",
+    static_cast<unsigned>(segment),
+    static_cast<unsigned long>(firstSequence),
+    isSectorWritable_ ? 1 : 0
+  );
+}
+
+/**
+ * 指定セグメント内のセクタの先頭位置を返します。
+ */
+size_t TransactionJournal::getSectorAddress(const size_t segment, const size_t sector) const {
+  return segment * SEGMENT_BYTES + sector * SECTOR_BYTES;
+}
+
+/**
+ * 出力用に記録1件をCSVの1行として書き出します。
+ * ※明細は nameIndex:価格 を空白区切りで並べます。登録カタログの商品のnameIndexはCATALOG_NAME_INDEXです。
+ */
+void TransactionJournal::printRecord(void* context, const CheckoutRecordView& record) {
+  DumpContext* dump = static_cast<DumpContext*>(context);
+  char line[DUMP_LINE_CAPACITY];
+  int length = snprintf(
+    line,
+    sizeof(line),
+    "[JOURNAL] %lu,%lu,%lu,%.*s,%lu,",
+    static_cast<unsigned long>(record.sequence),
+    static_cast<unsigned long>(record.unixTime),
+    static_cast<unsigned long>(record.uptimeMs),
+    static_cast<int>(record.uidLength),
+    record.uid,
+    static_cast<unsigned long>(record.total)
+  );
+  size_t lineLength = length < 0 ? 0 : std::min(static_cast<size_t>(length), sizeof(line) - 1);
+
+  for (size_t index = 0; index < record.itemCount; ++index) {
+    uint8_t nameIndex = 0;
+    uint16_t price = 0;
+    getCheckoutItem(record, index, nameIndex, price);
+
+    char itemText[DUMP_ITEM_TEXT_CAPACITY];
+    length = snprintf(itemText, sizeof(itemText), index == 0 ? "%u:%u" : " %u:%u", nameIndex, price);
+    const size_t itemLength = length < 0 ? 0 : static_cast<size_t>(length);
+    if (lineLength + itemLength > sizeof(line)) {
+      dump->output->write(reinterpret_cast<const uint8_t*>(line), lineLength);
+      lineLength = 0;
+    }
+    memcpy(line + lineLength, itemText, itemLength);
+    lineLength += itemLength;
+  }
+
+  dump->output->write(reinterpret_cast<const uint8_t*>(line), lineLength);
+  dump->output->write('\n');
+  ++dump->recordCount;
+}
@@ -0,0 +1,153 @@
+#ifndef TRANSACTION_JOURNAL_H
+#define TRANSACTION_JOURNAL_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <atomic>
+
+#include "checkout-record.h"
+#include "register-cart.h"
+
+/**
+ * 決済の記録をフラッシュのパーティションへ追記し続けます。
+ * ※記録はRAMに溜めて書き込みタスクでまとめて書き込み、画面処理タスクはフラッシュを待ちません。
+ *   パーティションは固定長のセグメントに分け、満杯になるたびに次のセグメントへ移って消去を分散します。
+ */
+class TransactionJournal {
+ public:
+  /**
+   * 記録処理を初期化します。
+   */
+  TransactionJournal();
+
+  /**
+   * 指定ラベルのパーティションから追記位置を復元し、書き込みタスクを起動して使えるかを返します。
+   * ※起動済みの場合は何もしません。
+   */
+  bool begin(const char* label);
+
+  /**
+   * 決済1件をカートの明細ごと書き込み待ちへ積み、受け付けたかを返します。
+   * ※書き込み待ちが満杯の場合は受け付けず、破棄した件数を数えます。
+   */
+  bool append(const RegisterCart& cart, const char* uid, size_t uidLength, uint32_t unixTime);
+
+  /**
+   * 書き込み待ちの記録をすぐに書き込むよう依頼し、書き終えたかを返します。
+   * ※指定時間内に書き終わらない場合はfalseを返します。
+   */
+  bool flush(uint32_t timeoutMs);
+
+  /**
+   * 記録を古い順にCSV形式で出力します。
+   * ※書き込み待ちの記録を先に書き込み、出力中は書き込みタスクを止めます。
+   */
+  void dump(Print& output);
+
+ private:
+  /**
+   * セグメントを読み進めた結果です。
+   */
+  struct ScanResult {
+    uint32_t lastSequence;
+    size_t recordCount;
+    size_t endSector;
+    size_t endOffset;
+    bool isEndErased;
+  };
+
+  /**
+   * 読み出した記録1件を受け取る関数です。
+   */
+  using RecordVisitor = void (*)(void* context, const CheckoutRecordView& record);
+
+  /**
+   * 書き込みタスクの本体です。
+   */
+  static void runTask(void* context);
+
+  /**
+   * 書き込みタスクで書き込み待ちの記録を書き込み続けます。
+   */
+  void runWriteLoop();
+
+  /**
+   * セグメントの先頭を読み、使用中であれば最初の記録の通し番号を返します。
+   */
+  bool readSegmentHeader(size_t segment, uint32_t& firstSequenceOut);
+
+  /**
+   * セグメント内の記録を古い順に読み、最後の記録の位置を返します。
+   * ※通し番号が戻った記録は以前の周回の残りとみなし、そこで読むのをやめます。
+   */
+  void scanSegment(size_t segment, uint32_t firstSequence, RecordVisitor visitor, void* context, ScanResult& resultOut);
+
+  /**
+   * 最後に書き込んだセグメントを探し、追記位置と次の通し番号を復元します。
+   */
+  void recoverPosition();
+
+  /**
+   * 書き込み待ちの記録を取り出し、セクタ単位の書き込み用バッファへ並べます。
+   */
+  void drainPending();
+
+  /**
+   * 記録1件を書き込み用バッファへ置きます。
+   * ※記録はセクタをまたがないよう、収まらない場合は現在のセクタを書き込んで次のセクタへ移ります。
+   */
+  void placeRecord(const uint8_t* record, size_t recordBytes, uint32_t sequence);
+
+  /**
+   * 書き込み用バッファの内容を現在のセクタへ書き込みます。
+   */
+  void writeStaged();
+
+  /**
+   * 次のセクタを消去して追記位置を移します。
+   * ※セグメントの末尾では次のセグメントへ移ります。
+   */
+  void advanceSector(uint32_t nextSequence);
+
+  /**
+   * 指定セグメントの先頭セクタを消去し、先頭に最初の記録の通し番号を書き込みます。
+   */
+  void startSegment(size_t segment, uint32_t firstSequence);
+
+  /**
+   * 指定セグメント内のセクタの先頭位置を返します。
+   */
+  size_t getSectorAddress(size_t segment, size_t sector) const;
+
+  /**
+   * 出力用に記録1件をCSVの1行として書き出します。
+   */
+  static void printRecord(void* context, const CheckoutRecordView& record);
+
+  const esp_partition_t* partition_;
+  TaskHandle_t taskHandle_;
+  SemaphoreHandle_t pendingMutex_;
+  SemaphoreHandle_t flashMutex_;
+  uint8_t* pendingBuffer_;
+  uint8_t* drainBuffer_;
+  uint8_t* stagingBuffer_;
+  size_t pendingBytes_;
+  size_t stagedBytes_;
+  size_t segmentCount_;
+  size_t segmentIndex_;
+  size_t sectorIndex_;
+  size_t sectorOffset_;
+  uint32_t nextSequence_;
+  uint32_t stagedSinceMs_;
+  std::atomic<uint32_t> unwrittenBytes_;
+  std::atomic<uint32_t> droppedRecordCount_;
+  std::atomic<bool> isFlushRequested_;
+  bool hasSegment_;
+  bool isSectorWritable_;
+};
+
+#endif